@@ -2,9 +2,11 @@
 //       An interactive test program for the IntSet data type.
 
 #include "IntSet.h"
+#include "IntSetChecks.h"
 #include <iostream>
 #include <iomanip>
 #include <cstdlib>
+#include <string>
 using namespace std;
 
 // PROTOTYPES for functions used by this test program:
@@ -49,6 +51,10 @@ int main(int argc, char* argv[])
        givenValue;         // holder for a user supplied value
    char choice;            // command character entered by the user
 
+   //"a2 check" runs the automatic checks only (see IntSetChecks.h)
+   if (argc > 1 && string(argv[1]) == "check")
+      return runAllChecks(cout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
    cout << "3 IntSet objects (is1 is2 is3) have been created." << endl;
 
    do
@@ -443,6 +449,9 @@ int main(int argc, char* argv[])
             cout << "   is3 has " << is3.size() << " items" << endl;
          }
          break;
+      case 'x': case 'X':
+         runAllChecks(cout);
+         break;
       case 'q': case 'Q':
          cout << "Quit option selected...bye" << endl;
          break;
@@ -474,6 +483,7 @@ void print_menu()
    cout << "  r  Reset (make empty) 1 or more of is1, is2 and is3" << endl;
    cout << "  s  Subtract 1 of is1, is2 or is3 from is1, is2 or is3" << endl;
    cout << "  u  Union 1 of is1, is2 or is3 with is1, is2 or is3" << endl;
+   cout << "  x  Run the automatic checks of the IntSet extensions" << endl;
    cout << "  z  Query # of items in 1 or more of is1, is2 and is3" << endl;
    cout << "  q  Quit this test program" << endl;
 }
@@ -0,0 +1,260 @@
+// FILE: AtomicBitSet.cpp
+//       Implementation file for the AtomicBitSet class
+//       (See AtomicBitSet.h for documentation.)
+// INVARIANT for the AtomicBitSet class:
+// (1) The value v (0 <= v < universe) is an element exactly when bit
+//     (v % 64) of words[v / 64] is set; words has numWords entries
+//     and the bits past universe in the last word are always clear.
+// (2) The sum of stripes[i].count over all i equals the number of
+//     set bits once all in-flight mutations have finished; a stripe
+//     on its own may be negative.
+// (3) A stripe's count is only ever changed by the thread whose add,
+//     remove or reset actually flipped the corresponding bits, so the
+//     count of each flip is recorded exactly once.
+// (4) Every add, remove or reset of an in-range value increments its
+//     stripe's started before it touches words and finished after, so
+//     the summed started minus the summed finished is the number of
+//     writes in progress. stripes points at the first 64-byte
+//     boundary in stripeSpace.
+
+#include "AtomicBitSet.h"
+#include <new>
+#include <thread>
+#include <vector>
+using namespace std;
+
+namespace
+{
+   //popcount of a 64-bit word (GCC/Clang builtin)
+   inline int bitCount(uint64_t w)
+   {
+      return __builtin_popcountll(w);
+   }
+
+   //each thread picks a stripe once, round robin
+   atomic<int> nextStripe(0);
+
+   //failed snapshot attempts after which a reader yields between tries
+   const int SNAPSHOT_SPINS = 64;
+
+   //counts one write on a stripe while it is alive
+   template <class Stripe>
+   class WriteScope
+   {
+   public:
+      WriteScope(Stripe& s) : stripe(s) { stripe.started.fetch_add(1); }
+      ~WriteScope() { stripe.finished.fetch_add(1); }
+
+   private:
+      Stripe& stripe;
+   };
+}
+
+AtomicBitSet::AtomicBitSet(int universe_size) : universe(universe_size)
+{
+   //operator new does not honour alignas beyond the default alignment
+   //(before C++17), so the stripes are aligned by hand
+   stripeSpace = new char[(COUNTER_STRIPES + 1) * sizeof(Stripe)];
+   uintptr_t at = reinterpret_cast<uintptr_t>(stripeSpace);
+   at = (at + alignof(Stripe) - 1) & ~uintptr_t(alignof(Stripe) - 1);
+   stripes = reinterpret_cast<Stripe*>(at);
+   for (int i = 0; i < COUNTER_STRIPES; ++i)
+      new (&stripes[i]) Stripe();
+
+   if (universe < 1)
+      universe = 1;
+   numWords = int((static_cast<long long>(universe) + 63) / 64);
+
+   words = new atomic<uint64_t>[numWords];
+   for (int i = 0; i < numWords; ++i)
+      words[i].store(0, memory_order_relaxed);
+   for (int i = 0; i < COUNTER_STRIPES; ++i)
+   {
+      stripes[i].count.store(0, memory_order_relaxed);
+      stripes[i].started.store(0);
+      stripes[i].finished.store(0);
+   }
+}
+
+AtomicBitSet::~AtomicBitSet()
+{
+   delete [] words;
+   for (int i = 0; i < COUNTER_STRIPES; ++i)
+      stripes[i].~Stripe();
+   delete [] stripeSpace;
+}
+
+AtomicBitSet::Stripe& AtomicBitSet::myStripe()
+{
+   static thread_local int mine =
+      nextStripe.fetch_add(1, memory_order_relaxed) % COUNTER_STRIPES;
+   return stripes[mine];
+}
+
+int AtomicBitSet::universeSize() const
+{
+   return universe;
+}
+
+int AtomicBitSet::size() const
+{
+   //sum the stripes; each one is independent so relaxed loads suffice
+   int total = 0;
+   for (int i = 0; i < COUNTER_STRIPES; ++i)
+      total += stripes[i].count.load(memory_order_relaxed);
+   return total < 0 ? 0 : total;
+}
+
+bool AtomicBitSet::isEmpty() const
+{
+   return size() == 0;
+}
+
+bool AtomicBitSet::contains(int anInt) const
+{
+   if (anInt < 0 || anInt >= universe)
+      return false;
+   uint64_t bit = uint64_t(1) << (anInt & 63);
+   return (words[anInt >> 6].load(memory_order_acquire) & bit) != 0;
+}
+
+bool AtomicBitSet::add(int anInt)
+{
+   if (anInt < 0 || anInt >= universe)
+      return false;
+
+   //only the thread whose fetch_or flips the bit counts it
+   Stripe& stripe = myStripe();
+   WriteScope<Stripe> writing(stripe);
+   uint64_t bit = uint64_t(1) << (anInt & 63);
+   uint64_t prev = words[anInt >> 6].fetch_or(bit);
+   if (prev & bit)
+      return false;
+   stripe.count.fetch_add(1, memory_order_relaxed);
+   return true;
+}
+
+bool AtomicBitSet::remove(int anInt)
+{
+   if (anInt < 0 || anInt >= universe)
+      return false;
+
+   Stripe& stripe = myStripe();
+   WriteScope<Stripe> writing(stripe);
+   uint64_t bit = uint64_t(1) << (anInt & 63);
+   uint64_t prev = words[anInt >> 6].fetch_and(~bit);
+   if (!(prev & bit))
+      return false;
+   stripe.count.fetch_sub(1, memory_order_relaxed);
+   return true;
+}
+
+void AtomicBitSet::reset()
+{
+   //clear word by word, uncounting exactly the bits that were set
+   Stripe& stripe = myStripe();
+   WriteScope<Stripe> writing(stripe);
+   int removed = 0;
+   for (int i = 0; i < numWords; ++i)
+      removed += bitCount(words[i].exchange(0));
+   if (removed > 0)
+      stripe.count.fetch_sub(removed, memory_order_relaxed);
+}
+
+void AtomicBitSet::copyWords(uint64_t* dest) const
+{
+   for (int i = 0; i < numWords; ++i)
+      dest[i] = words[i].load();
+}
+
+unsigned long long AtomicBitSet::startedWrites() const
+{
+   unsigned long long total = 0;
+   for (int i = 0; i < COUNTER_STRIPES; ++i)
+      total += stripes[i].started.load();
+   return total;
+}
+
+unsigned long long AtomicBitSet::finishedWrites() const
+{
+   unsigned long long total = 0;
+   for (int i = 0; i < COUNTER_STRIPES; ++i)
+      total += stripes[i].finished.load();
+   return total;
+}
+
+void AtomicBitSet::snapshot(const AtomicBitSet& a, uint64_t* toA,
+                            const AtomicBitSet* b, uint64_t* toB)
+{
+   //the counts only grow and started >= finished on every stripe, so
+   //finished sums read before started sums that match them mean no
+   //write was in progress between the two; started sums unchanged
+   //after the copy then mean none began during it
+   for (int attempt = 0; ; ++attempt)
+   {
+      unsigned long long done = a.finishedWrites() + (b ? b->finishedWrites() : 0);
+      unsigned long long begun = a.startedWrites() + (b ? b->startedWrites() : 0);
+      if (done == begun)
+      {
+         a.copyWords(toA);
+         if (b)
+            b->copyWords(toB);
+         if (a.startedWrites() + (b ? b->startedWrites() : 0) == begun)
+            return;
+      }
+      if (attempt >= SNAPSHOT_SPINS)
+         this_thread::yield();
+   }
+}
+
+IntSet AtomicBitSet::fromWords(const uint64_t* bits, int numWords)
+{
+   //size the result exactly, then fill it in ascending order; the
+   //values are distinct by construction so no contains() is needed
+   int count = 0;
+   for (int i = 0; i < numWords; ++i)
+      count += bitCount(bits[i]);
+
+   IntSet result(count);
+   for (int i = 0; i < numWords; ++i)
+   {
+      uint64_t w = bits[i];
+      while (w)
+      {
+         result.append(i * 64 + __builtin_ctzll(w));
+         w &= w - 1;
+      }
+   }
+   return result;
+}
+
+IntSet AtomicBitSet::toIntSet() const
+{
+   vector<uint64_t> copy(numWords);
+   snapshot(*this, &copy[0], 0, 0);
+   return fromWords(&copy[0], numWords);
+}
+
+IntSet AtomicBitSet::unionWith(const AtomicBitSet& other) const
+{
+   //snapshot both sides over the larger word range
+   int n = numWords > other.numWords ? numWords : other.numWords;
+   vector<uint64_t> mine(n, 0), theirs(n, 0);
+   snapshot(*this, &mine[0], &other, &theirs[0]);
+
+   for (int i = 0; i < n; ++i)
+      mine[i] |= theirs[i];
+   return fromWords(&mine[0], n);
+}
+
+IntSet AtomicBitSet::intersect(const AtomicBitSet& other) const
+{
+   //only the common word range can hold common elements
+   int n = numWords < other.numWords ? numWords : other.numWords;
+   vector<uint64_t> mine(numWords), theirs(other.numWords);
+   snapshot(*this, &mine[0], &other, &theirs[0]);
+
+   for (int i = 0; i < n; ++i)
+      mine[i] &= theirs[i];
+   return fromWords(&mine[0], n);
+}
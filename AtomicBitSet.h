@@ -0,0 +1,130 @@
+// FILE: AtomicBitSet.h - header file for AtomicBitSet class
+// CLASS PROVIDED: AtomicBitSet (a concurrent container class for a
+//                 set of int values drawn from a bounded universe)
+//
+// An AtomicBitSet stores the int values 0 through universeSize() - 1
+// as bits in an array of std::atomic<uint64_t> words, so add, remove
+// and contains are each a single fetch_or, fetch_and or load on one
+// word and are wait-free. Any number of threads may call any member
+// function at the same time. The element count is kept in a striped
+// counter (one cache line per stripe) so concurrent writers do not
+// contend on a single shared count.
+//
+// Each stripe also counts the writes (add, remove, reset) its threads
+// have started and finished. toIntSet, unionWith and intersect copy
+// the words only while no write is in progress on the sets involved
+// (the summed started and finished counts agree before the copy, and
+// no write has started when it is done), so what they return is the
+// contents at one instant. They retry until they find such a moment:
+// writers never wait for readers, but a reader may wait while writes
+// keep coming without a gap.
+//
+// CONSTANT
+//   static const int COUNTER_STRIPES = ____
+//     AtomicBitSet::COUNTER_STRIPES is the number of independent
+//     counters size() is summed from.
+//
+// CONSTRUCTOR
+//   AtomicBitSet(int universe_size)
+//     Post: The invoking AtomicBitSet is initialized to an empty set
+//           that can hold the int values 0 through universe_size - 1;
+//           a universe_size < 1 is treated as 1. Any int up to
+//           INT_MAX is valid (the bits take universe_size / 8 bytes).
+//
+// CONSTANT MEMBER FUNCTIONS (ACCESSORS)
+//   int universeSize() const
+//     Post: The number of distinct values the invoking AtomicBitSet
+//           can hold (one more than the largest legal value) is
+//           returned.
+//   int size() const
+//     Post: Number of elements in the invoking AtomicBitSet is
+//           returned.
+//     Note: While other threads are mutating the set the value
+//           returned is a point on the way between the counts before
+//           and after the concurrent operations; it is exact once
+//           the writers are quiescent.
+//   bool isEmpty() const
+//     Post: True is returned if size() is 0, otherwise false.
+//   bool contains(int anInt) const
+//     Post: true is returned if anInt is an element of the invoking
+//           AtomicBitSet, otherwise false is returned (values outside
+//           0 .. universeSize() - 1 are never elements).
+//   IntSet toIntSet() const
+//     Post: An IntSet holding the elements of the invoking
+//           AtomicBitSet at one instant, in ascending order, is
+//           returned.
+//   IntSet unionWith(const AtomicBitSet& other) const
+//   IntSet intersect(const AtomicBitSet& other) const
+//     Post: An IntSet representing the union (intersection) of the
+//           invoking AtomicBitSet and other as they both were at one
+//           instant, in ascending order, is returned.
+//
+// MODIFICATION MEMBER FUNCTIONS (MUTATORS)
+//   bool add(int anInt)
+//     Post: If anInt is in range and was not an element, it has been
+//           added and true is returned, otherwise the invoking
+//           AtomicBitSet is unchanged and false is returned.
+//   bool remove(int anInt)
+//     Post: If anInt was an element, it has been removed and true is
+//           returned, otherwise the invoking AtomicBitSet is
+//           unchanged and false is returned.
+//   void reset()
+//     Post: Every element present when reset() examined its word has
+//           been removed.
+//
+// VALUE SEMANTICS
+//   AtomicBitSet objects may not be copied or assigned; use
+//   toIntSet() to take a copy of the contents.
+
+#ifndef ATOMIC_BIT_SET_H
+#define ATOMIC_BIT_SET_H
+
+#include "IntSet.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class AtomicBitSet
+{
+public:
+   static const int COUNTER_STRIPES = 16;
+   AtomicBitSet(int universe_size);
+   ~AtomicBitSet();
+   int universeSize() const;
+   int size() const;
+   bool isEmpty() const;
+   bool contains(int anInt) const;
+   IntSet toIntSet() const;
+   IntSet unionWith(const AtomicBitSet& other) const;
+   IntSet intersect(const AtomicBitSet& other) const;
+   bool add(int anInt);
+   bool remove(int anInt);
+   void reset();
+
+private:
+   //one cache line each (see stripes)
+   struct alignas(64) Stripe
+   {
+      std::atomic<int> count;
+      std::atomic<unsigned long long> started;   // writes begun
+      std::atomic<unsigned long long> finished;  // writes completed
+   };
+
+   std::atomic<uint64_t>* words;
+   int     numWords;
+   int     universe;
+   char*   stripeSpace;   // what stripes is carved from
+   Stripe* stripes;       // COUNTER_STRIPES, 64-byte aligned
+
+   AtomicBitSet(const AtomicBitSet&);
+   AtomicBitSet& operator=(const AtomicBitSet&);
+   void copyWords(uint64_t* dest) const;
+   unsigned long long startedWrites() const;
+   unsigned long long finishedWrites() const;
+   static void snapshot(const AtomicBitSet& a, uint64_t* toA,
+                        const AtomicBitSet* b, uint64_t* toB);
+   Stripe& myStripe();
+   static IntSet fromWords(const uint64_t* bits, int numWords);
+};
+
+#endif
@@ -0,0 +1,79 @@
+// FILE: CompressedIntSet.cpp
+//       Implementation file for the CompressedIntSet class
+//       (See CompressedIntSet.h for documentation.)
+// INVARIANT for the CompressedIntSet class:
+// (1) words is a valid PackedInts encoding of count strictly
+//     ascending values, which are the elements.
+// (2) words is never empty (an empty set is encoded as one word, 0).
+
+#include "CompressedIntSet.h"
+#include <algorithm>
+#include <memory>
+using namespace std;
+
+CompressedIntSet::CompressedIntSet() : words(1, 0), count(0)
+{
+}
+
+CompressedIntSet::CompressedIntSet(const IntSet& set) : count(set.size())
+{
+   vector<int> sorted(set.begin(), set.end());
+   sort(sorted.begin(), sorted.end());
+   packSortedInts(sorted.empty() ? 0 : &sorted[0], count, words);
+}
+
+int CompressedIntSet::size() const
+{
+   return count;
+}
+
+bool CompressedIntSet::isEmpty() const
+{
+   return count == 0;
+}
+
+bool CompressedIntSet::contains(int anInt) const
+{
+   //the last block whose first value is <= anInt is the only one
+   //that can hold it
+   int lo = 0, hi = packedBlockCount(count);
+   while (lo < hi)
+   {
+      int mid = lo + (hi - lo) / 2;
+      if (packedBlockFirst(&words[0], mid) <= anInt)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   if (lo == 0)
+      return false;
+
+   int block[PACKED_BLOCK_SIZE];
+   int n = unpackBlock(&words[0], count, lo - 1, block);
+   return binary_search(block, block + n, anInt);
+}
+
+IntSet CompressedIntSet::toIntSet() const
+{
+   //decode every block straight into the array the IntSet adopts
+   int room = count > 0 ? count : 1;
+   unique_ptr<int[]> buffer(new int[room]);
+   for (int b = 0, at = 0, blocks = packedBlockCount(count); b < blocks; ++b)
+      at += unpackBlock(&words[0], count, b, buffer.get() + at);
+   return IntSet::adopt(std::move(buffer), count, room);
+}
+
+const vector<uint32_t>& CompressedIntSet::encoded() const
+{
+   return words;
+}
+
+bool CompressedIntSet::assignEncoded(const uint32_t* words, size_t numWords,
+                                     int count)
+{
+   if (!checkPackedInts(words, numWords, count))
+      return false;
+   this->words.assign(words, words + numWords);
+   this->count = count;
+   return true;
+}
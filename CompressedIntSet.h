@@ -0,0 +1,86 @@
+// FILE: CompressedIntSet.h - header file for CompressedIntSet class
+// CLASS PROVIDED: CompressedIntSet (a read-only set of int values held
+//                 bit-packed in memory and decoded block by block)
+//
+// A CompressedIntSet keeps its elements sorted and encoded as in
+// PackedInts.h: blocks of PACKED_BLOCK_SIZE values, each stored as a
+// first value plus gaps packed at the block's own bit width. Sorted
+// ID lists with small gaps take a few bits per element instead of 32.
+// contains() binary-searches the block directory and decodes the one
+// block that can hold the value; iteration decodes one block at a
+// time into a small buffer, so the set is never expanded as a whole.
+//
+// CONSTRUCTORS
+//   CompressedIntSet()
+//     Post: The invoking CompressedIntSet is empty.
+//   explicit CompressedIntSet(const IntSet& set)
+//     Post: The invoking CompressedIntSet holds the elements of set.
+//
+// CONSTANT MEMBER FUNCTIONS (ACCESSORS)
+//   int size() const
+//   bool isEmpty() const
+//   bool contains(int anInt) const
+//     Post: As for IntSet.
+//   template <class F> void forEach(F f) const
+//     Post: f(x) has been called for every element x, in ascending
+//           order (insertion order is not kept).
+//   IntSet toIntSet() const
+//     Post: An IntSet holding the elements in ascending order is
+//           returned.
+//   const std::vector<std::uint32_t>& encoded() const
+//     Post: The encoding (see PackedInts.h) is returned; its size
+//           times 4 is the memory the elements take.
+//
+// MODIFICATION MEMBER FUNCTIONS
+//   bool assignEncoded(const std::uint32_t* words,
+//                      std::size_t numWords, int count)
+//     Post: If words[0..numWords) passes checkPackedInts for count
+//           values, the invoking CompressedIntSet holds a copy of
+//           that encoding and true is returned; otherwise it is
+//           unchanged and false is returned.
+//
+// VALUE SEMANTICS
+//   Assignment and the copy constructor may be used with
+//   CompressedIntSet objects.
+
+#ifndef COMPRESSED_INT_SET_H
+#define COMPRESSED_INT_SET_H
+
+#include "IntSet.h"
+#include "PackedInts.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CompressedIntSet
+{
+public:
+   CompressedIntSet();
+   explicit CompressedIntSet(const IntSet& set);
+   int size() const;
+   bool isEmpty() const;
+   bool contains(int anInt) const;
+   template <class F> void forEach(F f) const;
+   IntSet toIntSet() const;
+   const std::vector<std::uint32_t>& encoded() const;
+   bool assignEncoded(const std::uint32_t* words, std::size_t numWords,
+                      int count);
+
+private:
+   std::vector<std::uint32_t> words;
+   int count;
+};
+
+template <class F>
+void CompressedIntSet::forEach(F f) const
+{
+   int block[PACKED_BLOCK_SIZE];
+   for (int b = 0, blocks = packedBlockCount(count); b < blocks; ++b)
+   {
+      int n = unpackBlock(&words[0], count, b, block);
+      for (int i = 0; i < n; ++i)
+         f(block[i]);
+   }
+}
+
+#endif
@@ -0,0 +1,729 @@
+// FILE: DurableIntSet.cpp
+//       Implementation file for the DurableIntSet class
+//       (See DurableIntSet.h for documentation.)
+// INVARIANT for the DurableIntSet class:
+// (1) When open, fd is the log <base>.wal, positioned at its end; the
+//     log's header matches <base>.snap (or the empty set if there is
+//     none), and the snapshot followed by the records in the log,
+//     then those in writing and then those in pending, gives set.
+// (2) synced <= written <= appended; the records numbered past
+//     written are the ones in writing (while syncing) and pending.
+// (3) Only the thread that set syncing (the leader) writes to fd or
+//     touches writing, and it does so without holding lock.
+// (4) When closed, fd is -1, set is empty and no maintenance thread
+//     is running.
+// (5) While child > 0, a child process forked when the log held
+//     forkRecords records (and set forkCount elements) is writing
+//     <base>.snap.tmp and reporting through progress; otherwise child
+//     is -1 and progress is 0.
+
+#include "DurableIntSet.h"
+#include "IntSetFile.h"
+#include "SetKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace std;
+
+namespace
+{
+   const char WAL_MAGIC[4] = { 'I', 'W', 'A', 'L' };
+   const uint16_t WAL_VERSION = 1;
+   const size_t WAL_RECORD_BYTES = 8;
+
+   struct WalHeader
+   {
+      char     magic[4];
+      uint32_t byteOrder;
+      uint16_t version;
+      uint16_t reserved16;
+      uint32_t baseCount;
+      uint64_t baseChecksum;
+      uint64_t reserved;
+   };
+
+   static_assert(sizeof(WalHeader) == 32, "log header layout changed");
+
+   //what a log header records about the snapshot it follows: the
+   //snapshot's count and payload checksum (the payload is the
+   //elements in insertion order, as saveIntSet writes them)
+   void identify(const IntSet& set, uint32_t& count, uint64_t& checksum)
+   {
+      count = uint32_t(set.size());
+      checksum = intSetChecksum(set.begin(), set.size() * sizeof(int32_t));
+   }
+
+   //16-bit check of a record; a zero-filled (torn) record fails it
+   //because op 0 is not valid
+   uint16_t recordCheck(int value, unsigned char op)
+   {
+      unsigned char bytes[5];
+      memcpy(bytes, &value, 4);
+      bytes[4] = op;
+      uint64_t h = intSetChecksum(bytes, sizeof bytes);
+      return uint16_t(h ^ (h >> 16) ^ (h >> 32) ^ (h >> 48));
+   }
+
+   bool writeAll(int fd, const char* bytes, size_t length)
+   {
+      while (length > 0)
+      {
+         ssize_t done = write(fd, bytes, length);
+         if (done < 0)
+         {
+            if (errno == EINTR)
+               continue;
+            return false;
+         }
+         bytes += done;
+         length -= size_t(done);
+      }
+      return true;
+   }
+
+   //writes a synced log at path: a header for the snapshot (count,
+   //checksum) followed by the bytes records holds; the open descriptor
+   //(at the end of the file) or -1 is returned
+   int writeLog(const string& path, uint32_t count, uint64_t checksum,
+                const vector<char>& records)
+   {
+      WalHeader h;
+      memset(&h, 0, sizeof h);
+      memcpy(h.magic, WAL_MAGIC, sizeof WAL_MAGIC);
+      h.byteOrder = INTSET_FILE_BYTE_ORDER;
+      h.version = WAL_VERSION;
+      h.baseCount = count;
+      h.baseChecksum = checksum;
+
+      int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+         return -1;
+      if (!writeAll(fd, reinterpret_cast<const char*>(&h), sizeof h)
+          || (!records.empty() && !writeAll(fd, &records[0], records.size()))
+          || fsync(fd) != 0)
+      {
+         close(fd);
+         unlink(path.c_str());
+         return -1;
+      }
+      return fd;
+   }
+
+   //creates <base>.wal holding just a header for the snapshot
+   //(count, checksum), aside and then renamed into place; the open
+   //descriptor or -1 is returned
+   int createLog(const string& base, uint32_t count, uint64_t checksum)
+   {
+      string path = base + ".wal";
+      string aside = path + ".tmp";
+      int fd = writeLog(aside, count, checksum, vector<char>());
+      if (fd < 0)
+         return -1;
+      if (rename(aside.c_str(), path.c_str()) != 0 || !syncParent(path.c_str()))
+      {
+         close(fd);
+         unlink(aside.c_str());
+         return -1;
+      }
+      return fd;
+   }
+
+   //applies the records of the log at fd (which must follow the
+   //snapshot (count, checksum)) to set, cuts off a torn or damaged
+   //tail and leaves fd at the end; the number of records applied is
+   //returned, or -1 if the header does not match and -2 if reading or
+   //cutting the log failed (set is then partly replayed)
+   long long replayLog(int fd, uint32_t count, uint64_t checksum,
+                       IntSet& set)
+   {
+      WalHeader h;
+      if (read(fd, &h, sizeof h) != ssize_t(sizeof h)
+          || memcmp(h.magic, WAL_MAGIC, sizeof WAL_MAGIC) != 0
+          || h.byteOrder != INTSET_FILE_BYTE_ORDER
+          || h.version != WAL_VERSION
+          || h.baseCount != count || h.baseChecksum != checksum)
+         return -1;
+
+      vector<char> buffer(DurableIntSet::WAL_BUFFER_BYTES);
+      size_t filled = 0;
+      off_t good = sizeof h;
+      long long records = 0;
+      bool damaged = false;
+      while (!damaged)
+      {
+         ssize_t got = read(fd, &buffer[filled], buffer.size() - filled);
+         if (got < 0 && errno == EINTR)
+            continue;
+         if (got < 0)
+            return -2;
+         if (got == 0)
+            break;
+         filled += size_t(got);
+
+         size_t at = 0;
+         for (; at + WAL_RECORD_BYTES <= filled; at += WAL_RECORD_BYTES)
+         {
+            int value;
+            uint16_t check;
+            memcpy(&value, &buffer[at], 4);
+            unsigned char op = static_cast<unsigned char>(buffer[at + 4]);
+            memcpy(&check, &buffer[at + 6], 2);
+            if (op < 1 || op > 3 || buffer[at + 5] != 0
+                || check != recordCheck(value, op))
+            {
+               damaged = true;
+               break;
+            }
+            if (op == 1)
+               set.add(value);
+            else if (op == 2)
+               set.remove(value);
+            else
+               set.reset();
+            ++records;
+            good += WAL_RECORD_BYTES;
+         }
+
+         //keep a partial record for the next read
+         memmove(&buffer[0], &buffer[at], filled - at);
+         filled -= at;
+      }
+
+      //whatever follows the last good record is a crash's leftovers
+      struct stat st;
+      if (fstat(fd, &st) == 0 && st.st_size > good)
+      {
+         if (ftruncate(fd, good) != 0 || fsync(fd) != 0)
+            return -2;
+      }
+      if (lseek(fd, good, SEEK_SET) != good)
+         return -2;
+      return records;
+   }
+
+   double secondsSince(chrono::steady_clock::time_point start)
+   {
+      return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+   }
+}
+
+struct DurableIntSet::ChildProgress
+{
+   atomic<long long> written;
+   long long total;
+   unsigned long long checksum;
+};
+
+DurableIntSet::DurableIntSet()
+   : fd(-1), appended(0), written(0), synced(0), records(0),
+     syncing(false), broken(false), stopping(false), child(-1),
+     progress(0), forkRecords(0), forkCount(0)
+{
+   memset(&last, 0, sizeof last);
+}
+
+DurableIntSet::~DurableIntSet()
+{
+   close();
+}
+
+bool DurableIntSet::isOpen() const
+{
+   lock_guard<mutex> held(lock);
+   return fd >= 0;
+}
+
+bool DurableIntSet::failed() const
+{
+   lock_guard<mutex> held(lock);
+   return broken;
+}
+
+int DurableIntSet::size() const
+{
+   lock_guard<mutex> held(lock);
+   return set.size();
+}
+
+bool DurableIntSet::isEmpty() const
+{
+   lock_guard<mutex> held(lock);
+   return set.isEmpty();
+}
+
+bool DurableIntSet::contains(int anInt) const
+{
+   lock_guard<mutex> held(lock);
+   return set.contains(anInt);
+}
+
+IntSet DurableIntSet::toIntSet() const
+{
+   lock_guard<mutex> held(lock);
+   return set;
+}
+
+long long DurableIntSet::logRecords() const
+{
+   lock_guard<mutex> held(lock);
+   return records;
+}
+
+bool DurableIntSet::open(const char* basePath, const DurableOptions& opts)
+{
+   close();
+
+   //recover: the snapshot, if any, then the log that follows it
+   string path = basePath;
+   string snap = path + ".snap";
+   IntSet recovered;
+   if (access(snap.c_str(), F_OK) == 0 && !loadIntSet(snap.c_str(), recovered))
+      return false;
+   uint32_t count;
+   uint64_t checksum;
+   identify(recovered, count, checksum);
+
+   //<base>.wal.next follows the snapshot if a crash came between
+   //installing a background snapshot and renaming its log into place
+   long long replayed = -1;
+   int logFd = -1;
+   int used = -1;
+   string wal = path + ".wal";
+   string next = wal + ".next";
+   for (int candidate = 0; candidate < 2 && logFd < 0; ++candidate)
+   {
+      const string& name = candidate == 0 ? wal : next;
+      logFd = ::open(name.c_str(), O_RDWR);
+      if (logFd < 0)
+         continue;
+      IntSet replay(recovered);
+      replayed = replayLog(logFd, count, checksum, replay);
+      if (replayed >= 0)
+      {
+         recovered.swap(replay);
+         used = candidate;
+      }
+      else
+      {
+         ::close(logFd);
+         logFd = -1;
+         if (replayed == -2)
+            return false;
+      }
+   }
+
+   //finish the interrupted rename; a <base>.wal.next that was not
+   //replayed is from an install that never got its snapshot into
+   //place, and renaming it later would replace the log in use
+   if (used == 1)
+   {
+      if (rename(next.c_str(), wal.c_str()) == 0)
+         syncParent(wal.c_str());
+   }
+   else if (access(next.c_str(), F_OK) == 0 && unlink(next.c_str()) == 0)
+      syncParent(next.c_str());
+   if (logFd < 0)
+   {
+      //no log, or one from before the snapshot: start afresh
+      logFd = createLog(path, count, checksum);
+      if (logFd < 0)
+         return false;
+      replayed = 0;
+   }
+
+   lock_guard<mutex> held(lock);
+   base = path;
+   options = opts;
+   set.swap(recovered);
+   fd = logFd;
+   appended = written = synced = 0;
+   records = replayed;
+   syncing = broken = stopping = false;
+   memset(&last, 0, sizeof last);
+   if (options.syncMode == WAL_SYNC_PERIODIC || options.checkpointRecords > 0)
+      maintainer = thread(&DurableIntSet::maintain, this);
+   return true;
+}
+
+void DurableIntSet::close()
+{
+   unique_lock<mutex> held(lock);
+   if (fd < 0)
+      return;
+   stopping = true;
+   wake.notify_all();
+   if (maintainer.joinable())
+   {
+      held.unlock();
+      maintainer.join();
+      held.lock();
+   }
+
+   finishChild(held, true);
+   flush(held, true);
+   while (syncing)
+      idle.wait(held);
+   ::close(fd);
+   fd = -1;
+   pending.clear();
+   set.reset();
+}
+
+bool DurableIntSet::add(int anInt)
+{
+   unique_lock<mutex> held(lock);
+   if (broken || !set.add(anInt))
+      return false;
+   return log(held, WAL_ADD, anInt);
+}
+
+bool DurableIntSet::remove(int anInt)
+{
+   unique_lock<mutex> held(lock);
+   if (broken || !set.remove(anInt))
+      return false;
+   return log(held, WAL_REMOVE, anInt);
+}
+
+void DurableIntSet::reset()
+{
+   unique_lock<mutex> held(lock);
+   if (broken)
+      return;
+   set.reset();
+   log(held, WAL_RESET, 0);
+}
+
+bool DurableIntSet::sync()
+{
+   unique_lock<mutex> held(lock);
+   return flush(held, true);
+}
+
+bool DurableIntSet::checkpoint()
+{
+   unique_lock<mutex> held(lock);
+   return checkpointLocked(held);
+}
+
+bool DurableIntSet::startBackgroundCheckpoint()
+{
+   unique_lock<mutex> held(lock);
+   return startChild(held);
+}
+
+CheckpointProgress DurableIntSet::checkpointProgress()
+{
+   unique_lock<mutex> held(lock);
+   finishChild(held, false);
+   if (child < 0)
+      return last;
+
+   CheckpointProgress p;
+   p.running = true;
+   p.bytesWritten = progress->written.load();
+   p.bytesTotal = progress->total;
+   p.seconds = secondsSince(forkTime);
+   p.succeeded = last.succeeded;
+   return p;
+}
+
+bool DurableIntSet::waitForCheckpoint()
+{
+   unique_lock<mutex> held(lock);
+   bool waited = child > 0;
+   finishChild(held, true);
+   return !waited || last.succeeded;
+}
+
+bool DurableIntSet::log(unique_lock<mutex>& held, WalOp op, int value)
+{
+   char record[WAL_RECORD_BYTES];
+   unsigned char code = static_cast<unsigned char>(op);
+   uint16_t check = recordCheck(value, code);
+   memcpy(record, &value, 4);
+   record[4] = char(code);
+   record[5] = 0;
+   memcpy(record + 6, &check, 2);
+   pending.insert(pending.end(), record, record + WAL_RECORD_BYTES);
+   ++appended;
+   ++records;
+
+   if (options.syncMode == WAL_SYNC_ALWAYS)
+      return flush(held, true);
+   if (pending.size() >= WAL_BUFFER_BYTES)
+      return flush(held, false);
+   return true;
+}
+
+bool DurableIntSet::flush(unique_lock<mutex>& held, bool durable)
+{
+   //group commit: whoever finds no leader becomes one and writes every
+   //record queued so far; the others wait for it and re-check, since
+   //one write usually covers them too
+   unsigned long long target = appended;
+   while (!broken && (durable ? synced : written) < target)
+   {
+      if (syncing)
+      {
+         idle.wait(held);
+         continue;
+      }
+      syncing = true;
+      writing.clear();
+      writing.swap(pending);
+      unsigned long long upTo = appended;
+
+      held.unlock();
+      bool ok = (writing.empty() || writeAll(fd, &writing[0], writing.size()))
+                && (!durable || fdatasync(fd) == 0);
+      held.lock();
+
+      syncing = false;
+      if (ok)
+      {
+         written = upTo;
+         if (durable)
+            synced = upTo;
+      }
+      else
+         broken = true;
+      idle.notify_all();
+   }
+   return !broken;
+}
+
+bool DurableIntSet::checkpointLocked(unique_lock<mutex>& held)
+{
+   //with no child, the log synced and no leader running, nothing
+   //touches the files until lock is released
+   finishChild(held, true);
+   if (!flush(held, true))
+      return false;
+   while (syncing)
+      idle.wait(held);
+
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   last.running = false;
+   last.bytesWritten = 0;
+   last.bytesTotal = (long long)set.size() * sizeof(int32_t);
+   last.succeeded = false;
+
+   string snap = base + ".snap";
+   string aside = snap + ".tmp";
+   if (!saveIntSet(set, aside.c_str()) || !syncPath(aside.c_str())
+       || rename(aside.c_str(), snap.c_str()) != 0 || !syncParent(snap.c_str()))
+   {
+      unlink(aside.c_str());
+      last.seconds = secondsSince(start);
+      return false;
+   }
+
+   //the old log no longer matches the snapshot; without a new one
+   //later changes could not be recovered
+   uint32_t count;
+   uint64_t checksum;
+   identify(set, count, checksum);
+   int logFd = createLog(base, count, checksum);
+   if (logFd < 0)
+   {
+      broken = true;
+      return false;
+   }
+   ::close(fd);
+   fd = logFd;
+   records = 0;
+   last.bytesWritten = last.bytesTotal;
+   last.seconds = secondsSince(start);
+   last.succeeded = true;
+   return true;
+}
+
+bool DurableIntSet::startChild(unique_lock<mutex>& held)
+{
+   if (child > 0 || broken)
+      return false;
+
+   //records not yet written need no flush: they reach the log after
+   //the first forkRecords ones whenever they are written
+   void* m = mmap(0, sizeof(ChildProgress), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   if (m == MAP_FAILED)
+      return false;
+   ChildProgress* shared = new (m) ChildProgress;
+   shared->written.store(0);
+   shared->total = (long long)set.size() * sizeof(int32_t);
+   shared->checksum = 0;
+
+   string aside = base + ".snap.tmp";
+   pid_t pid = fork();
+   if (pid == 0)
+      _exit(writeSnapshot(set, aside.c_str(), shared));
+   if (pid < 0)
+   {
+      munmap(m, sizeof(ChildProgress));
+      return false;
+   }
+
+   child = pid;
+   progress = shared;
+   forkRecords = records;
+   forkCount = set.size();
+   forkTime = chrono::steady_clock::now();
+   return true;
+}
+
+void DurableIntSet::finishChild(unique_lock<mutex>& held, bool wait)
+{
+   //poll rather than block in waitpid, so lock is never held while
+   //waiting and another thread may reap the child first
+   while (child > 0)
+   {
+      int status;
+      pid_t done = waitpid(child, &status, WNOHANG);
+      if (done == 0)
+      {
+         if (!wait)
+            return;
+         held.unlock();
+         this_thread::sleep_for(chrono::milliseconds(1));
+         held.lock();
+         continue;
+      }
+
+      bool ok = done == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      last.running = false;
+      last.bytesWritten = progress->written.load();
+      last.bytesTotal = progress->total;
+      last.succeeded = ok && installChild(held);
+      last.seconds = secondsSince(forkTime);
+      if (!last.succeeded)
+         unlink((base + ".snap.tmp").c_str());
+      munmap(progress, sizeof(ChildProgress));
+      progress = 0;
+      child = -1;
+   }
+}
+
+bool DurableIntSet::installChild(unique_lock<mutex>& held)
+{
+   if (!flush(held, true))
+      return false;
+   while (syncing)
+      idle.wait(held);
+
+   //the records logged since the fork follow the new snapshot
+   off_t from = off_t(sizeof(WalHeader) + forkRecords * WAL_RECORD_BYTES);
+   vector<char> tail(size_t(records - forkRecords) * WAL_RECORD_BYTES);
+   size_t got = 0;
+   while (got < tail.size())
+   {
+      ssize_t n = pread(fd, &tail[got], tail.size() - got, from + off_t(got));
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n <= 0)
+         return false;
+      got += size_t(n);
+   }
+
+   //log first, then snapshot, then rename the log: a crash at any
+   //point leaves a snapshot and a log that matches it (see open())
+   string snap = base + ".snap";
+   string wal = base + ".wal";
+   string next = wal + ".next";
+   int logFd = writeLog(next, uint32_t(forkCount), progress->checksum, tail);
+   if (logFd < 0)
+      return false;
+   if (rename((snap + ".tmp").c_str(), snap.c_str()) != 0 || !syncParent(snap.c_str()))
+   {
+      ::close(logFd);
+      unlink(next.c_str());
+      return false;
+   }
+   //if this rename fails the log keeps its .next name, which open()
+   //also looks for
+   if (rename(next.c_str(), wal.c_str()) == 0)
+      syncParent(wal.c_str());
+   ::close(fd);
+   fd = logFd;
+   records -= forkRecords;
+   return true;
+}
+
+int DurableIntSet::writeSnapshot(const IntSet& set, const char* path,
+                                 ChildProgress* progress)
+{
+   //runs in the forked child of a threaded process, where another
+   //thread may have held the allocator's lock at the fork: only system
+   //calls and plain computation from here on, no allocation
+   int out = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (out < 0)
+      return 1;
+   int n = set.size();
+   int lo = 0, hi = 0;
+   if (n > 0)
+      valueRange(set.begin(), n, lo, hi);
+   unsigned flags = INTSET_FILE_CHECKSUM;
+   if (adjacent_find(set.begin(), set.end(), greater_equal<int>()) == set.end())
+      flags |= INTSET_FILE_ASCENDING;
+   IntSetFileHeader h;
+   fillIntSetHeader(h, flags, n, lo, hi, uint64_t(n) * sizeof(int32_t));
+
+   //the payload first, the header (with the checksum) last
+   const char* bytes = reinterpret_cast<const char*>(set.begin());
+   size_t total = size_t(h.payloadBytes);
+   size_t done = 0;
+   unsigned long long sum = INTSET_CHECKSUM_SEED;
+   bool ok = lseek(out, sizeof h, SEEK_SET) == off_t(sizeof h);
+   while (ok && done < total)
+   {
+      size_t step = total - done < SNAPSHOT_CHUNK_BYTES ? total - done
+                    : SNAPSHOT_CHUNK_BYTES;
+      sum = intSetChecksum(bytes + done, step, sum);
+      ok = writeAll(out, bytes + done, step);
+      done += step;
+      progress->written.store((long long)done);
+   }
+   h.checksum = sum;
+   ok = ok && pwrite(out, &h, sizeof h, 0) == ssize_t(sizeof h)
+        && fsync(out) == 0;
+   ok = ::close(out) == 0 && ok;
+   progress->checksum = sum;
+   return ok ? 0 : 1;
+}
+
+void DurableIntSet::maintain()
+{
+   unique_lock<mutex> held(lock);
+   chrono::milliseconds period(options.syncIntervalMs > 0 ? options.syncIntervalMs : 1);
+   while (!stopping)
+   {
+      wake.wait_for(held, period, [this]() { return stopping; });
+      if (stopping)
+         break;
+      if (options.syncMode == WAL_SYNC_PERIODIC)
+         flush(held, true);
+      finishChild(held, false);
+
+      //a running child's snapshot will shorten the log when installed
+      if (options.checkpointRecords > 0 && child < 0
+          && records >= options.checkpointRecords && !broken)
+      {
+         if (options.backgroundCheckpoints)
+            startChild(held);
+         else
+            checkpointLocked(held);
+      }
+   }
+}
@@ -0,0 +1,266 @@
+// FILE: DurableIntSet.h - header file for DurableIntSet class
+// CLASS PROVIDED: DurableIntSet (an IntSet kept in memory whose
+//                 changes survive a restart, through a write-ahead log
+//                 and periodic snapshots)
+//
+// A DurableIntSet opened on a base path keeps two files next to it:
+//   <base>.snap  a snapshot in the IntSet binary format (IntSetFile.h),
+//                always checksummed, elements in insertion order
+//   <base>.wal   the write-ahead log of every change made since that
+//                snapshot
+// Each add/remove/reset that changes the set appends one 8-byte record
+// to an in-memory buffer. Records reach the log by group commit: the
+// first thread that needs its record on disk writes (and fdatasyncs)
+// the whole buffer, covering every record queued so far, while the
+// threads behind it wait for that one write instead of issuing their
+// own. How long a change may stay only in memory is chosen by the
+// sync mode (see DurableOptions). checkpoint() writes a new snapshot
+// and starts an empty log; a maintenance thread does so on its own
+// once the log holds checkpointRecords records.
+//
+// A checkpoint can also run in the background: startBackground-
+// Checkpoint() forks, and the child process writes the snapshot from
+// its copy-on-write image of the set (the state at the fork) while
+// this process goes on changing the set at full speed. Records logged
+// after the fork are carried over into the log that follows the new
+// snapshot when it is installed, which happens once the child has
+// exited (see checkpointProgress() and waitForCheckpoint()).
+//
+// open() recovers: it loads the snapshot (an empty set if there is
+// none) and replays the log on top of it, stopping at the first torn
+// or damaged record (a crash mid-write) and cutting the log there.
+// Installing a background snapshot writes <base>.wal.next first and
+// renames it over <base>.wal last; if a crash comes in between, open()
+// finds that <base>.wal does not match the snapshot, uses
+// <base>.wal.next and finishes the rename. A <base>.wal.next left by a
+// crash before the snapshot was installed matches no snapshot; open()
+// removes it.
+//
+// LOG FORMAT (host byte order)
+//   A 32-byte header: magic "IWAL", byteOrder 0x01020304, version
+//   (2 bytes), 2 reserved bytes, baseCount (4 bytes), baseChecksum
+//   (8 bytes), 8 reserved bytes. baseCount and baseChecksum identify
+//   the snapshot the log follows (its element count and payload
+//   checksum); a log that does not match the snapshot is from before
+//   it and is not replayed.
+//   Then 8-byte records: value (4 bytes), op (1 byte: 1 add, 2 remove,
+//   3 reset), 1 zero byte and a 2-byte check of op and value.
+//
+// TYPES
+//   enum WalSyncMode
+//     WAL_SYNC_ALWAYS    a change is on disk before the call returns
+//     WAL_SYNC_PERIODIC  the log is written and synced every
+//                        syncIntervalMs; a crash loses at most that
+//                        much
+//     WAL_SYNC_NONE      the log is written when the buffer fills and
+//                        synced only by sync(), checkpoint() and close()
+//   struct DurableOptions
+//     syncMode           as above (default WAL_SYNC_ALWAYS)
+//     syncIntervalMs     period of the maintenance thread (default 1000)
+//     checkpointRecords  log length that triggers a checkpoint from the
+//                        maintenance thread; 0 never (default 1 << 20)
+//     backgroundCheckpoints  whether those checkpoints run in a forked
+//                        child (default true)
+//   struct CheckpointProgress
+//     running            a background checkpoint is in progress
+//     bytesWritten       snapshot payload bytes written so far (of the
+//                        running checkpoint, else of the last one)
+//     bytesTotal         payload bytes in that snapshot
+//     seconds            time since the running checkpoint started, or
+//                        time the last one took
+//     succeeded          the last finished checkpoint was installed
+//
+// CONSTANTS
+//   static const std::size_t WAL_BUFFER_BYTES = ____
+//     Buffered record bytes after which the buffer is written out even
+//     when the sync mode does not require it yet.
+//   static const std::size_t SNAPSHOT_CHUNK_BYTES = ____
+//     Bytes a background snapshot writes between progress updates.
+//
+// CONSTRUCTOR
+//   DurableIntSet()
+//     Post: The invoking DurableIntSet is closed.
+//
+// CONSTANT MEMBER FUNCTIONS (ACCESSORS)
+//   bool isOpen() const
+//     Post: true is returned if the invoking DurableIntSet is open.
+//   bool failed() const
+//     Post: true is returned if writing the log failed since open();
+//           the set then refuses further changes (see below).
+//   int size() const
+//   bool isEmpty() const
+//   bool contains(int anInt) const
+//     Post: As for IntSet.
+//   IntSet toIntSet() const
+//     Post: A copy of the current elements is returned.
+//   long long logRecords() const
+//     Post: The number of records in the log (those replayed by open()
+//           plus those logged since) is returned.
+//
+// MODIFICATION MEMBER FUNCTIONS
+//   bool open(const char* basePath,
+//             const DurableOptions& options = DurableOptions())
+//     Post: Any open set has been closed. If the snapshot (when it
+//           exists) is valid and the log could be opened or created,
+//           the set holds the recovered elements and true is returned;
+//           otherwise the invoking DurableIntSet is closed and false
+//           is returned.
+//   void close()
+//     Post: The log has been written and synced and the invoking
+//           DurableIntSet is closed (a closed one is left as is).
+//   bool add(int anInt)
+//   bool remove(int anInt)
+//     Pre:  isOpen()
+//     Post: As for IntSet, and a change has been logged as the sync
+//           mode says. If failed(), the set is left unchanged and
+//           false is returned.
+//   void reset()
+//     Pre:  isOpen()
+//     Post: As for IntSet (unless failed()), and logged.
+//   bool sync()
+//     Pre:  isOpen()
+//     Post: Every change so far has been written and synced; false is
+//           returned if that failed.
+//   bool checkpoint()
+//     Pre:  isOpen()
+//     Post: Any background checkpoint has finished (as for
+//           waitForCheckpoint). A snapshot of the current elements has
+//           replaced <base>.snap (written aside, synced and renamed
+//           into place) and the log has been replaced by an empty one;
+//           true is returned on success. If the snapshot cannot be
+//           written the old snapshot and log stay in use and false is
+//           returned.
+//   bool startBackgroundCheckpoint()
+//     Pre:  isOpen()
+//     Post: If no background checkpoint was running and fork()
+//           succeeded, a child process is writing a snapshot of the
+//           current elements to <base>.snap.tmp and true is returned;
+//           otherwise false is returned. Changes go on meanwhile.
+//   CheckpointProgress checkpointProgress()
+//     Post: If the background child has exited, its snapshot has been
+//           installed (or, if it failed, discarded); the progress of
+//           the running or last checkpoint is returned.
+//   bool waitForCheckpoint()
+//     Post: No background checkpoint is running (the caller waited for
+//           it and it was installed or discarded); true is returned
+//           unless one was discarded.
+//
+// THREAD SAFETY
+//   All member functions may be called from several threads at once;
+//   changes are applied in the order they take an internal lock.
+//
+// VALUE SEMANTICS
+//   DurableIntSet objects may not be copied or assigned. The
+//   destructor calls close(), which waits for a background checkpoint.
+
+#ifndef DURABLE_INT_SET_H
+#define DURABLE_INT_SET_H
+
+#include "IntSet.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+enum WalSyncMode
+{
+   WAL_SYNC_ALWAYS,
+   WAL_SYNC_PERIODIC,
+   WAL_SYNC_NONE
+};
+
+struct DurableOptions
+{
+   WalSyncMode syncMode;
+   int syncIntervalMs;
+   long long checkpointRecords;
+   bool backgroundCheckpoints;
+
+   DurableOptions()
+      : syncMode(WAL_SYNC_ALWAYS), syncIntervalMs(1000),
+        checkpointRecords(1 << 20), backgroundCheckpoints(true)
+   {
+   }
+};
+
+struct CheckpointProgress
+{
+   bool running;
+   long long bytesWritten;
+   long long bytesTotal;
+   double seconds;
+   bool succeeded;
+};
+
+class DurableIntSet
+{
+public:
+   static const std::size_t WAL_BUFFER_BYTES = 1 << 16;
+   static const std::size_t SNAPSHOT_CHUNK_BYTES = 1 << 22;
+   DurableIntSet();
+   ~DurableIntSet();
+   bool isOpen() const;
+   bool failed() const;
+   int size() const;
+   bool isEmpty() const;
+   bool contains(int anInt) const;
+   IntSet toIntSet() const;
+   long long logRecords() const;
+   bool open(const char* basePath,
+             const DurableOptions& options = DurableOptions());
+   void close();
+   bool add(int anInt);
+   bool remove(int anInt);
+   void reset();
+   bool sync();
+   bool checkpoint();
+   bool startBackgroundCheckpoint();
+   CheckpointProgress checkpointProgress();
+   bool waitForCheckpoint();
+
+private:
+   enum WalOp { WAL_ADD = 1, WAL_REMOVE = 2, WAL_RESET = 3 };
+   struct ChildProgress;          // shared with the snapshot child
+
+   std::string base;
+   DurableOptions options;
+   IntSet set;
+   int fd;                        // the log, -1 when closed
+   std::vector<char> pending;     // records not yet handed to write()
+   std::vector<char> writing;     // the batch the leader is writing
+   unsigned long long appended;   // records logged since open()
+   unsigned long long written;    // ... of which written
+   unsigned long long synced;     // ... of which written and synced
+   long long records;             // records in the log file
+   bool syncing;                  // a leader is writing the log
+   bool broken;                   // writing the log failed
+   bool stopping;                 // the maintenance thread must exit
+   mutable std::mutex lock;
+   std::condition_variable idle;  // a leader finished
+   std::condition_variable wake;  // stopping was set
+   std::thread maintainer;
+   pid_t child;                   // the snapshot child, -1 if none
+   ChildProgress* progress;       // shared mapping while child runs
+   long long forkRecords;         // log records the child's snapshot has
+   int forkCount;                 // elements in the child's snapshot
+   std::chrono::steady_clock::time_point forkTime;
+   CheckpointProgress last;       // the last finished checkpoint
+
+   DurableIntSet(const DurableIntSet&);
+   DurableIntSet& operator=(const DurableIntSet&);
+   bool log(std::unique_lock<std::mutex>& held, WalOp op, int value);
+   bool flush(std::unique_lock<std::mutex>& held, bool durable);
+   bool checkpointLocked(std::unique_lock<std::mutex>& held);
+   bool startChild(std::unique_lock<std::mutex>& held);
+   void finishChild(std::unique_lock<std::mutex>& held, bool wait);
+   bool installChild(std::unique_lock<std::mutex>& held);
+   void maintain();
+   static int writeSnapshot(const IntSet& set, const char* path,
+                            ChildProgress* progress);
+};
+
+#endif
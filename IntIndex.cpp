@@ -0,0 +1,142 @@
+// FILE: IntIndex.cpp
+//       Implementation file for the IntIndex class
+//       (See IntIndex.h for documentation.)
+// INVARIANT for the IntIndex class:
+// (1) slots has mask + 1 entries (a power of 2, or none at all when
+//     slots is 0); an entry of 0 means empty and an entry of k means
+//     position k - 1 of the array referenced by values.
+// (2) Every indexed position p sits in the first empty-free run of
+//     slots starting at hash(values[p]) & mask (linear probing).
+// (3) used is the number of non-empty slots and 2 * used <= mask + 1,
+//     except that the table stops growing at 2^31 slots (more than
+//     any int count), where the load may go past 1/2 but never
+//     reaches 1, so a probe always ends at an empty slot.
+
+#include "IntIndex.h"
+#include <cstring>
+
+namespace
+{
+   //the largest table: 2^31 slots hold any int count of positions
+   const unsigned int MAX_TABLE_SIZE = 1u << 31;
+
+   //smallest power of 2 (at least 16) that keeps the load <= 1/2, or
+   //MAX_TABLE_SIZE if none fits (sized in 64 bits: 2 * count need not
+   //fit in an unsigned int)
+   unsigned int tableSizeFor(long long count)
+   {
+      unsigned long long size = 16;
+      while (size < 2 * (unsigned long long)count && size < MAX_TABLE_SIZE)
+         size <<= 1;
+      return (unsigned int)size;
+   }
+
+   //a reused table more than this many times the needed size is
+   //dropped, so clearing it does not dominate small builds
+   const unsigned long long MAX_OVERSIZE = 8;
+}
+
+IntIndex::IntIndex() : values(0), slots(0), mask(0), used(0)
+{
+}
+
+IntIndex::~IntIndex()
+{
+   delete [] slots;
+}
+
+int IntIndex::find(int value) const
+{
+   if (used == 0)
+      return -1;
+   for (unsigned int i = hash(value) & mask; ; i = (i + 1) & mask)
+   {
+      int s = slots[i];
+      if (s == 0)
+         return -1;
+      if (values[s - 1] == value)
+         return s - 1;
+   }
+}
+
+bool IntIndex::contains(int value) const
+{
+   return find(value) != -1;
+}
+
+int IntIndex::count() const
+{
+   return used;
+}
+
+void IntIndex::grow(long long min_count)
+{
+   unsigned int size = tableSizeFor(min_count);
+   if (slots != 0 && size <= mask + 1)
+      return;
+
+   int* old = slots;
+   unsigned int oldSize = old ? mask + 1 : 0;
+   slots = new int[size];
+   mask = size - 1;
+   std::memset(slots, 0, size * sizeof(int));
+
+   //re-home whatever was indexed before
+   for (unsigned int i = 0; i < oldSize; ++i)
+      if (old[i] != 0)
+      {
+         unsigned int j = hash(values[old[i] - 1]) & mask;
+         while (slots[j] != 0)
+            j = (j + 1) & mask;
+         slots[j] = old[i];
+      }
+   delete [] old;
+}
+
+void IntIndex::build(const int* values, int count)
+{
+   this->values = values;
+   if (slots != 0 && mask + 1 > MAX_OVERSIZE * tableSizeFor(count))
+   {
+      delete [] slots;
+      slots = 0;
+      mask = 0;
+   }
+   clear();
+   grow(count);
+   for (int p = 0; p < count; ++p)
+   {
+      unsigned int j = hash(values[p]) & mask;
+      while (slots[j] != 0)
+         j = (j + 1) & mask;
+      slots[j] = p + 1;
+   }
+   used = count;
+}
+
+void IntIndex::rebind(const int* values)
+{
+   this->values = values;
+}
+
+bool IntIndex::insert(int pos)
+{
+   if (slots == 0 || 2 * ((long long)used + 1) > (long long)mask + 1)
+      grow(2 * ((long long)used + 1));
+
+   int value = values[pos];
+   unsigned int j = hash(value) & mask;
+   for (; slots[j] != 0; j = (j + 1) & mask)
+      if (values[slots[j] - 1] == value)
+         return false;
+   slots[j] = pos + 1;
+   ++used;
+   return true;
+}
+
+void IntIndex::clear()
+{
+   if (slots != 0)
+      std::memset(slots, 0, (mask + 1) * sizeof(int));
+   used = 0;
+}
@@ -0,0 +1,84 @@
+// FILE: IntIndex.h - header file for IntIndex class
+// CLASS PROVIDED: IntIndex (an open-addressing hash index over an
+//                 array of distinct int values)
+//
+// An IntIndex answers "where (if anywhere) is value v in this array"
+// in expected O(1) time. It stores positions into the indexed array,
+// not the values themselves, so it adds 4 bytes per slot and never
+// needs to be rebuilt when only the array's address changes (see
+// rebind). The table uses linear probing and is kept at most half
+// full.
+//
+// CONSTRUCTOR
+//   IntIndex()
+//     Post: The invoking IntIndex is empty and bound to no array.
+//
+// CONSTANT MEMBER FUNCTIONS (ACCESSORS)
+//   int find(int value) const
+//     Post: The position p with values[p] == value is returned if the
+//           indexed array holds value, otherwise -1 is returned.
+//   bool contains(int value) const
+//     Post: find(value) != -1 is returned.
+//   int count() const
+//     Post: The number of positions currently indexed is returned.
+//
+// MODIFICATION MEMBER FUNCTIONS (MUTATORS)
+//   void build(const int* values, int count)
+//     Pre:  values[0] .. values[count - 1] are distinct.
+//     Post: The invoking IntIndex indexes exactly those count values.
+//     Note: The table is reused when it is big enough and not far
+//           too big, so rebuilding one IntIndex over arrays of
+//           similar size allocates nothing.
+//   void rebind(const int* values)
+//     Pre:  values holds the same values at the same positions as the
+//           array the index was built over (e.g. after a resize).
+//     Post: Subsequent lookups read from values.
+//   bool insert(int pos)
+//     Pre:  The bound array holds a value at position pos.
+//     Post: If the value at pos was not yet indexed, pos has been
+//           indexed and true is returned, otherwise the index is
+//           unchanged and false is returned.
+//   void clear()
+//     Post: No positions are indexed; the table memory is kept for
+//           reuse.
+//
+// VALUE SEMANTICS
+//   IntIndex objects may not be copied or assigned.
+
+#ifndef INT_INDEX_H
+#define INT_INDEX_H
+
+class IntIndex
+{
+public:
+   IntIndex();
+   ~IntIndex();
+   int find(int value) const;
+   bool contains(int value) const;
+   int count() const;
+   void build(const int* values, int count);
+   void rebind(const int* values);
+   bool insert(int pos);
+   void clear();
+
+   static unsigned int hash(int value);
+
+private:
+   const int* values;
+   int* slots;          // position + 1, or 0 for an empty slot
+   unsigned int mask;   // table size - 1 (table size is a power of 2)
+   int used;
+
+   IntIndex(const IntIndex&);
+   IntIndex& operator=(const IntIndex&);
+   void grow(long long min_count);
+};
+
+inline unsigned int IntIndex::hash(int value)
+{
+   //multiplicative (Fibonacci) hashing, high bits folded down
+   unsigned int h = unsigned(value) * 2654435761u;
+   return h ^ (h >> 15);
+}
+
+#endif
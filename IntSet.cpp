@@ -40,6 +40,18 @@
 //           the data array and used (if properly initialized and
 //           maintained) should tell which elements of the data
 //           array are actually relevant.
+// (7) fingerprint holds the sum (modulo 2^64) of elementHash(x)
+//     over every element x; it is 0 for an empty IntSet.
+// (8) When used > 0, minValue and maxValue are the smallest and
+//     largest element. ascending is true if data[0] .. data[used - 1]
+//     is strictly ascending; it may also be false for a set that
+//     became ascending through remove (the planner then merely
+//     misses the merge kernels). It is true for an empty IntSet.
+// (9) delta is 0 unless changes are tracked; then applying *delta (see
+//     applyDelta) to the set as it was at the last checkpoint gives
+//     data[0] .. data[used - 1]. append records every addition,
+//     remove() and reset() the removals, and wholesale replacements
+//     of data (assignment, swap) go through noteRewritten().
 //
 // DOCUMENTATION for private member (helper) function:
 //   void resize(int new_capacity)
@@ -70,12 +82,136 @@
 //           If reallocation of dynamic array is unsuccessful, an
 //           error message to the effect is displayed and the
 //           program unconditionally terminated.
+//   void append(int anInt)
+//     Pre:  used < capacity and contains(anInt) is false.
+//     Post: anInt has been added as the newest element (no search,
+//           no resize).
+//   void recomputeStats()
+//     Pre:  data[0] .. data[used - 1] hold the elements.
+//     Post: fingerprint, minValue, maxValue and ascending have been
+//           recomputed from scratch; used after data has been filled
+//           in bulk.
+//   void prepare(int min_capacity)
+//     Post: The invoking IntSet is empty and its capacity is at least
+//           min_capacity; the current array is kept if it is big
+//           enough (so no allocation happens then).
+//   void checkUnique() const
+//     Post: With INTSET_CHECK_UNIQUE defined, asserts that the
+//           elements are distinct; otherwise does nothing.
+//   void noteRemoved(int anInt)
+//     Pre:  Changes are tracked and anInt has just been removed.
+//     Post: The delta records the removal.
+//   void noteRewritten()
+//     Pre:  Changes are tracked and data has just been replaced.
+//     Post: The delta records a clear followed by every element.
+//   static unsigned long long elementHash(int anInt)
+//     Post: A well-mixed 64-bit hash of anInt is returned.
 
 #include "IntSet.h"
+#include "SetKernels.h"
+#include "IntIndex.h"
+#include "SetPlanner.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
 #include <iostream>
 #include <cassert>
+#include <utility>
 using namespace std;
 
+//Number of values the arrays a and b have in common, by whichever
+//kernel the planner prices cheapest (with stopAt >= 0 the count may
+//stop once it reaches stopAt; see SetKernels.h).
+static int countCommon(const int* a, const SetStats& sa,
+                       const int* b, const SetStats& sb, int stopAt = -1)
+{
+   int lo, hi;
+   switch (planCommon(sa, sb, lo, hi))
+   {
+      case ALGO_NONE:
+         return 0;
+      case ALGO_SCAN:
+         return countCommonScan(a, sa.size, b, sb.size, stopAt);
+      case ALGO_MERGE:
+         return countCommonMerge(a, sa.size, b, sb.size, stopAt);
+      case ALGO_GALLOP:
+         return countCommonGallop(a, sa.size, b, sb.size, stopAt);
+      case ALGO_BITMAP:
+         return countCommonBitmap(a, sa.size, b, sb.size, lo, hi, stopAt);
+      default:
+         //index the smaller array, probe with the larger
+         return sa.size <= sb.size
+                ? countCommonHash(a, sa.size, b, sb.size, stopAt)
+                : countCommonHash(b, sb.size, a, sa.size, stopAt);
+   }
+}
+
+//Hit flags for the xxxInto functions, kept per thread so that
+//repeated calls reuse one buffer.
+static thread_local vector<char> hitScratch;
+
+//Flag, in aHit, which values of a also occur in b (same choice of
+//kernel as countCommon).
+static void markHits(const int* a, const SetStats& sa,
+                     const int* b, const SetStats& sb, vector<char>& aHit)
+{
+   aHit.assign(sa.size, 0);
+   int lo, hi;
+   switch (planCommon(sa, sb, lo, hi))
+   {
+      case ALGO_NONE:
+         break;
+      case ALGO_SCAN:
+         markCommonScan(a, sa.size, b, sb.size, &aHit[0]);
+         break;
+      case ALGO_MERGE:
+         markCommonMerge(a, sa.size, b, sb.size, &aHit[0]);
+         break;
+      case ALGO_GALLOP:
+         markCommonGallop(a, sa.size, b, sb.size, &aHit[0]);
+         break;
+      case ALGO_BITMAP:
+         markCommonBitmap(a, sa.size, b, sb.size, lo, hi, &aHit[0]);
+         break;
+      default:
+         markCommonHash(a, sa.size, b, sb.size, &aHit[0]);
+   }
+}
+
+//Flag, in aHit and bHit, which values of a and b also occur in the
+//other array; when the planner picks hashing, one index over the
+//smaller array serves both sides.
+static void markCommon(const int* a, const SetStats& sa,
+                       const int* b, const SetStats& sb,
+                       vector<char>& aHit, vector<char>& bHit)
+{
+   int lo, hi;
+   if (planCommon(sa, sb, lo, hi) != ALGO_HASH)
+   {
+      markHits(a, sa, b, sb, aHit);
+      markHits(b, sb, a, sa, bHit);
+      return;
+   }
+
+   aHit.assign(sa.size, 0);
+   bHit.assign(sb.size, 0);
+   bool aSmaller = sa.size <= sb.size;
+   const int* small = aSmaller ? a : b;
+   const int* large = aSmaller ? b : a;
+   int nLarge = aSmaller ? sb.size : sa.size;
+   vector<char>& smallHit = aSmaller ? aHit : bHit;
+   vector<char>& largeHit = aSmaller ? bHit : aHit;
+
+   IntIndex index;
+   index.build(small, aSmaller ? sa.size : sb.size);
+   for (int j = 0; j < nLarge; ++j)
+   {
+      int pos = index.find(large[j]);
+      if (pos >= 0)
+         smallHit[pos] = largeHit[j] = 1;
+   }
+}
+
 void IntSet::resize(int new_capacity)
 {
    //Check if the user specified new_capacity is valid 
@@ -104,7 +240,9 @@ void IntSet::resize(int new_capacity)
 }
 
 //Default constructor
-IntSet::IntSet(int initial_capacity) : capacity(initial_capacity), used(0)
+IntSet::IntSet(int initial_capacity)
+   : capacity(initial_capacity), used(0), fingerprint(0),
+     minValue(0), maxValue(0), ascending(true), delta(0)
 {
    //check validity of the user specified capacity
    //if it is invalid, set it to DEFAULT_CAPACITY
@@ -117,7 +255,10 @@ IntSet::IntSet(int initial_capacity) : capacity(initial_capacity), used(0)
 }
 
 //copy constructor
-IntSet::IntSet(const IntSet& src) : capacity(src.capacity), used(src.used)
+IntSet::IntSet(const IntSet& src)
+   : capacity(src.capacity), used(src.used), fingerprint(src.fingerprint),
+     minValue(src.minValue), maxValue(src.maxValue), ascending(src.ascending),
+     delta(0)
 {
    //dynamically allocate the memory 
    //with the same size as src set
@@ -128,11 +269,53 @@ IntSet::IntSet(const IntSet& src) : capacity(src.capacity), used(src.used)
       data[i] = src.data[i];
 }
 
+//move constructor
+IntSet::IntSet(IntSet&& src)
+   : data(src.data), capacity(src.capacity), used(src.used),
+     fingerprint(src.fingerprint), minValue(src.minValue),
+     maxValue(src.maxValue), ascending(src.ascending), delta(0)
+{
+   //leave src empty, as the default constructor would
+   src.data = new int[DEFAULT_CAPACITY];
+   src.capacity = DEFAULT_CAPACITY;
+   src.reset();
+}
+
+IntSet IntSet::adopt(unique_ptr<int[]> buffer, int size, int capacity)
+{
+   IntSet result;
+   if (buffer)
+   {
+      //take the buffer over in place of the default array
+      delete [] result.data;
+      result.data = buffer.release();
+      result.capacity = capacity;
+      result.used = size;
+      result.recomputeStats();
+      result.checkUnique();
+   }
+   return result;
+}
+
+unique_ptr<int[]> IntSet::release(int& size, int& capacity)
+{
+   unique_ptr<int[]> buffer(data);
+   size = used;
+   capacity = this->capacity;
+
+   //start over empty, as the default constructor would
+   data = new int[DEFAULT_CAPACITY];
+   this->capacity = DEFAULT_CAPACITY;
+   reset();
+   return buffer;
+}
+
 //Deconstructor
 IntSet::~IntSet()
 {
    //Deallocate all memory used by data array
    delete [] data;
+   delete delta;
 }
 
 IntSet& IntSet::operator=(const IntSet& rhs)
@@ -155,13 +338,26 @@ IntSet& IntSet::operator=(const IntSet& rhs)
       //assign member variable from rhs to current member 
       data = newData;
 	  capacity = rhs.capacity;
-	  used = rhs.used;	
+	  used = rhs.used;
+	  fingerprint = rhs.fingerprint;
+	  minValue = rhs.minValue;
+	  maxValue = rhs.maxValue;
+	  ascending = rhs.ascending;
+	  if (delta)
+	     noteRewritten();
    }
    
    //the invoking set is unchanged
    return *this;
 }
 
+IntSet& IntSet::operator=(IntSet&& rhs)
+{
+   //take rhs's array over; rhs frees ours when it goes away
+   swap(rhs);
+   return *this;
+}
+
 int IntSet::size() const
 {
    //Number of elements in the invoking IntSet
@@ -196,17 +392,125 @@ bool IntSet::isSubsetOf(const IntSet& otherIntSet) const
        return true;
    else
    {
-   	  //loop through and check if all elements of the invoking IntSet
-      //are also elements of otherIntSet, otherwise return false.
-      for(int i =0; i < this->size(); i++)
-         if (!otherIntSet.contains(this->data[i]))
-	        return false;
-    		
-      return true;
+   	  //all elements of the invoking IntSet are also elements of
+      //otherIntSet exactly when they all are common to both
+      return countCommon(data, stats(), otherIntSet.data,
+                         otherIntSet.stats()) == used;
    }
 
 }
 
+bool IntSet::isDisjoint(const IntSet& otherIntSet) const
+{
+   //stop at the first common element
+   return countCommon(data, stats(), otherIntSet.data, otherIntSet.stats(),
+                      1) == 0;
+}
+
+IntSet IntSet::symmetricDifference(const IntSet& otherIntSet) const
+{
+   vector<char> mine, theirs;
+   markCommon(data, stats(), otherIntSet.data, otherIntSet.stats(),
+              mine, theirs);
+
+   //what only the invoking set has, then what only otherIntSet has
+   int common = int(count(mine.begin(), mine.end(), 1));
+   IntSet result(used + otherIntSet.used - 2 * common);
+   for (int i = 0; i < used; ++i)
+      if (!mine[i])
+         result.append(data[i]);
+   for (int j = 0; j < otherIntSet.used; ++j)
+      if (!theirs[j])
+         result.append(otherIntSet.data[j]);
+   return result;
+}
+
+int IntSet::intersectionSize(const IntSet& otherIntSet) const
+{
+   return countCommon(data, stats(), otherIntSet.data, otherIntSet.stats());
+}
+
+int IntSet::unionSize(const IntSet& otherIntSet) const
+{
+   //|A u B| = |A| + |B| - |A n B|
+   return used + otherIntSet.used - intersectionSize(otherIntSet);
+}
+
+int IntSet::differenceSize(const IntSet& otherIntSet) const
+{
+   //|A - B| = |A| - |A n B|
+   return used - intersectionSize(otherIntSet);
+}
+
+double IntSet::jaccard(const IntSet& otherIntSet) const
+{
+   if (used == 0 && otherIntSet.used == 0)
+      return 1.0;
+   int common = intersectionSize(otherIntSet);
+   return double(common) / (used + otherIntSet.used - common);
+}
+
+double IntSet::overlapCoefficient(const IntSet& otherIntSet) const
+{
+   int smaller = used < otherIntSet.used ? used : otherIntSet.used;
+   if (smaller == 0)
+      return 1.0;
+   return double(intersectionSize(otherIntSet)) / smaller;
+}
+
+IntSet IntSet::unionAll(const IntSet* const sets[], int numSets)
+{
+   //size the result for the worst case (all inputs disjoint)
+   int total = 0;
+   for (int k = 0; k < numSets; ++k)
+      total += sets[k]->used;
+   IntSet result(total);
+
+   //stage each value just past the end; keep it only if new
+   IntIndex index;
+   index.rebind(result.data);
+   for (int k = 0; k < numSets; ++k)
+      for (int i = 0; i < sets[k]->used; ++i)
+      {
+         result.data[result.used] = sets[k]->data[i];
+         if (index.insert(result.used))
+            result.append(sets[k]->data[i]);
+      }
+   return result;
+}
+
+IntSet IntSet::intersectAll(const IntSet* const sets[], int numSets)
+{
+   if (numSets < 1)
+      return IntSet();
+
+   //visit the inputs from smallest to largest
+   vector<const IntSet*> order(sets, sets + numSets);
+   stable_sort(order.begin(), order.end(),
+               [](const IntSet* x, const IntSet* y) { return x->used < y->used; });
+
+   IntSet result = *order[0];
+   vector<char> hit;
+   for (int k = 1; k < numSets && result.used > 0; ++k)
+   {
+      const IntSet& next = *order[k];
+      if (&next == order[0])
+         continue;
+
+      //mark the survivors with whichever kernel the planner picks
+      markHits(result.data, result.stats(), next.data, next.stats(), hit);
+
+      //compact the survivors in place, keeping their order
+      int kept = 0;
+      for (int i = 0; i < result.used; ++i)
+         if (hit[i])
+            result.data[kept++] = result.data[i];
+      result.used = kept;
+      result.recomputeStats();
+   }
+   return result;
+}
+
 void IntSet::DumpData(ostream& out) const
 {  
    if (used > 0)
@@ -217,51 +521,125 @@ void IntSet::DumpData(ostream& out) const
    }
 }
 
+//the results below start out big enough for any outcome, so the
+//xxxInto call that fills them never has to reallocate
 IntSet IntSet::unionWith(const IntSet& otherIntSet) const
 {
-   //make a copy of the invoking set
-   IntSet myUnionset = *this;
-	
-   //loop through otherIntSet to find the elements that  
-   //are not in the invoking set, if found addd them
-   for (int i = 0; i < otherIntSet.size(); i++)
-      if (!myUnionset.contains(otherIntSet.data[i]))
-         myUnionset.add(otherIntSet.data[i]);
-
+   IntSet myUnionset(used + otherIntSet.used);
+   unionInto(otherIntSet, myUnionset);
    return myUnionset; 
 }
 
 IntSet IntSet::intersect(const IntSet& otherIntSet) const
 {
-   //A copy of the invoking IntSet
-   IntSet myIntersect = *this;
-
-   //loop through to find elements of the invoking set that 
-   //are not in the otherIntSet. If found, remove them
-   for (int i = 0; i < size(); i++)
-      if (!otherIntSet.contains(data[i]))
-         myIntersect.remove(data[i]);
-	   
+   IntSet myIntersect(min(used, otherIntSet.used));
+   intersectInto(otherIntSet, myIntersect);
    return myIntersect; 
 }
 
 IntSet IntSet::subtract(const IntSet& otherIntSet) const
 {
-   //Make a copy of the invoking IntSet
-   IntSet mySubset = *this;
-	
-   //subtract otherIntSet from the invoking set
-   for (int i = 0; i < otherIntSet.size(); i++)
-      if (mySubset.contains(otherIntSet.data[i]))
-         mySubset.remove(otherIntSet.data[i]);
-		
+   IntSet mySubset(used);
+   subtractInto(otherIntSet, mySubset);
    return mySubset;
 }
 
+void IntSet::unionInto(const IntSet& otherIntSet, IntSet& out) const
+{
+   //otherIntSet's elements are still needed after out is
+   //overwritten, so build the result aside
+   if (&out == &otherIntSet && &out != this)
+   {
+      IntSet myUnionset(used + otherIntSet.used);
+      unionInto(otherIntSet, myUnionset);
+      out.swap(myUnionset);
+      return;
+   }
+
+   //find the elements of otherIntSet that are already in the
+   //invoking set
+   vector<char>& inMine = hitScratch;
+   markHits(otherIntSet.data, otherIntSet.stats(), data, stats(), inMine);
+   int added = int(count(inMine.begin(), inMine.end(), 0));
+
+   //a copy of the invoking set (unless out is the invoking set),
+   //then the rest of otherIntSet added to it
+   if (&out != this)
+   {
+      out.prepare(used + added);
+      for (int i = 0; i < used; ++i)
+         out.append(data[i]);
+   }
+   else if (out.capacity < used + added)
+      out.resize(used + added);
+   for (int i = 0; i < otherIntSet.used; i++)
+      if (!inMine[i])
+         out.append(otherIntSet.data[i]);
+}
+
+void IntSet::intersectInto(const IntSet& otherIntSet, IntSet& out) const
+{
+   //find the elements of the invoking set that are also
+   //in otherIntSet and keep only those, in order (when out is
+   //the invoking set this compacts it in place)
+   vector<char>& inOther = hitScratch;
+   markHits(data, stats(), otherIntSet.data, otherIntSet.stats(), inOther);
+
+   int n = used;
+   out.prepare(int(count(inOther.begin(), inOther.end(), 1)));
+   for (int i = 0; i < n; i++)
+      if (inOther[i])
+         out.append(data[i]);
+}
+
+void IntSet::subtractInto(const IntSet& otherIntSet, IntSet& out) const
+{
+   //find the elements of the invoking set that are also
+   //in otherIntSet and keep only the others, in order
+   vector<char>& inOther = hitScratch;
+   markHits(data, stats(), otherIntSet.data, otherIntSet.stats(), inOther);
+
+   int n = used;
+   out.prepare(n - int(count(inOther.begin(), inOther.end(), 1)));
+   for (int i = 0; i < n; i++)
+      if (!inOther[i])
+         out.append(data[i]);
+}
+
+void IntSet::checkUnique() const
+{
+#ifdef INTSET_CHECK_UNIQUE
+   IntIndex index;
+   index.rebind(data);
+   for (int i = 0; i < used; ++i)
+   {
+      bool fresh = index.insert(i);
+      assert(fresh && "trusted input holds a duplicate");
+      (void)fresh;
+   }
+#endif
+}
+
+void IntSet::prepare(int min_capacity)
+{
+   //keep the current array whenever it is big enough
+   reset();
+   if (capacity < min_capacity)
+      resize(min_capacity);
+}
+
 void IntSet::reset()
 {
    //empty the invoking IntSet
    used = 0;
+   fingerprint = 0;
+   ascending = true;
+   if (delta)
+   {
+      delta->cleared = true;
+      delta->removed.clear();
+      delta->added.clear();
+   }
 }
 
 bool IntSet::add(int anInt)
@@ -275,8 +653,7 @@ bool IntSet::add(int anInt)
    	     resize(int(1.5 * capacity) + 1);
    	     
    	  //add a new element if IntSet have enough room.   
-      data[used] = anInt;
-      used++;
+      append(anInt);
    	  return true;
    }
    //the invoking IntSet is unchanged
@@ -288,26 +665,226 @@ bool IntSet::remove(int anInt)
    //when removing a anInt-matching item
    if (contains(anInt))
    {
-   	  for (int i = 0; i < used; i++)
+      for (int i = 0; i < used; i++)
+      {
          if (data[i] == anInt)
+         {
             for (int j = i + 1; j < used; j++)
                data[j-1] = data[j];
-				
-            used--;
-			return true;
+         }
+      }
+
+      used--;
+      fingerprint -= elementHash(anInt);
+      if (delta)
+         noteRemoved(anInt);
+
+      //what remains is still ascending if it was; only losing
+      //an extreme value moves the range
+      if (used == 0)
+         ascending = true;
+      else if (anInt == minValue || anInt == maxValue)
+         valueRange(data, used, minValue, maxValue);
+      return true;
    }
-			
+
    //the invoking IntSet is unchanged
    return false;
 }
 
+int IntSet::addAll(const int* values, int n)
+{
+   //values in the invoking set's own array would be overwritten by
+   //the staging below or freed by a resize, so they are copied first
+   less<const int*> below;
+   if (n > 0 && !below(values, data) && below(values, data + capacity))
+   {
+      vector<int> copy(values, values + n);
+      return addAll(&copy[0], n);
+   }
+
+   int before = used;
+   IntIndex index;
+   index.build(data, used);
+   for (int at = 0; at < n; at += BULK_ADD_BATCH)
+   {
+      //room for the whole batch, plus the usual growth margin
+      int batch = n - at < BULK_ADD_BATCH ? n - at : BULK_ADD_BATCH;
+      if (capacity < used + batch)
+      {
+         int grown = int(1.5 * capacity) + 1;
+         resize(grown > used + batch ? grown : used + batch);
+         index.rebind(data);
+      }
+
+      //stage each value just past the end; keep it only if new
+      for (int i = at; i < at + batch; ++i)
+      {
+         data[used] = values[i];
+         if (index.insert(used))
+            append(values[i]);
+      }
+   }
+   return used - before;
+}
+
+void IntSet::swap(IntSet& other)
+{
+   std::swap(data, other.data);
+   std::swap(capacity, other.capacity);
+   std::swap(used, other.used);
+   std::swap(fingerprint, other.fingerprint);
+   std::swap(minValue, other.minValue);
+   std::swap(maxValue, other.maxValue);
+   std::swap(ascending, other.ascending);
+   if (delta)
+      noteRewritten();
+   if (other.delta)
+      other.noteRewritten();
+}
+
+void IntSet::trackChanges(bool on)
+{
+   if (on && !delta)
+   {
+      delta = new IntSetDelta;
+      markCheckpoint();
+   }
+   else if (!on)
+   {
+      delete delta;
+      delta = 0;
+   }
+}
+
+bool IntSet::tracksChanges() const
+{
+   return delta != 0;
+}
+
+const IntSetDelta& IntSet::changes() const
+{
+   assert(delta);
+   return *delta;
+}
+
+void IntSet::markCheckpoint()
+{
+   assert(delta);
+   delta->cleared = false;
+   delta->removed.clear();
+   delta->added.clear();
+   delta->baseSize = used;
+   delta->baseHash = hash();
+}
+
+void IntSet::applyDelta(const IntSetDelta& d)
+{
+   //copy first: d may be this set's own delta, which changes below
+   IntSetDelta applied(d);
+   if (applied.cleared)
+      reset();
+
+   //one pass drops every removed element, keeping the others' order
+   if (!applied.removed.empty() && used > 0)
+   {
+      IntIndex index;
+      index.build(&applied.removed[0], int(applied.removed.size()));
+      int kept = 0;
+      for (int i = 0; i < used; ++i)
+      {
+         if (index.find(data[i]) < 0)
+            data[kept++] = data[i];
+         else if (delta)
+            noteRemoved(data[i]);
+      }
+      used = kept;
+      recomputeStats();
+   }
+   if (!applied.added.empty())
+      addAll(&applied.added[0], int(applied.added.size()));
+}
+
+void IntSet::noteRemoved(int anInt)
+{
+   //an element added since the checkpoint just disappears from the
+   //delta; one from the checkpoint is recorded as removed
+   vector<int>& added = delta->added;
+   vector<int>::iterator at = find(added.begin(), added.end(), anInt);
+   if (at != added.end())
+      added.erase(at);
+   else if (!delta->cleared)
+      delta->removed.push_back(anInt);
+}
+
+void IntSet::noteRewritten()
+{
+   delta->cleared = true;
+   delta->removed.clear();
+   delta->added.assign(data, data + used);
+}
+
 bool operator==(const IntSet& is1, const IntSet& is2)
 {
-   //Check if is1 is a subset of is2 and is2 is a subset of is1.
-   //If true, then they are equal by the defintion of subset
-   //also empty set is equal to another empty set
-   if (is1.IntSet::isSubsetOf(is2) && is2.IntSet::isSubsetOf(is1))
-      return true;
-	
-   return false;
+   //Sets of different size or fingerprint can't be equal
+   if (is1.size() != is2.size() || is1.hash() != is2.hash())
+      return false;
+
+   //With equal sizes, is1 and is2 are equal exactly when every
+   //element of is1 is also in is2 (empty sets are equal)
+   return is1.intersectionSize(is2) == is1.size();
+}
+
+size_t IntSet::hash() const
+{
+   return size_t(fingerprint);
+}
+
+void IntSet::append(int anInt)
+{
+   if (used == 0)
+      minValue = maxValue = anInt;
+   else
+   {
+      ascending = ascending && anInt > data[used - 1];
+      if (anInt < minValue)
+         minValue = anInt;
+      if (anInt > maxValue)
+         maxValue = anInt;
+   }
+   data[used++] = anInt;
+   fingerprint += elementHash(anInt);
+   if (delta)
+      delta->added.push_back(anInt);
+}
+
+void IntSet::recomputeStats()
+{
+   fingerprint = 0;
+   ascending = true;
+   for (int i = 0; i < used; ++i)
+   {
+      fingerprint += elementHash(data[i]);
+      if (i > 0 && data[i] <= data[i - 1])
+         ascending = false;
+   }
+   if (used > 0)
+      valueRange(data, used, minValue, maxValue);
+}
+
+SetStats IntSet::stats() const
+{
+   SetStats s = { used, minValue, maxValue, ascending };
+   return s;
+}
+
+unsigned long long IntSet::elementHash(int anInt)
+{
+   //splitmix64 finalizer: every input bit affects every output bit,
+   //so sums of hashes of different sets rarely collide
+   unsigned long long h = (unsigned long long)(unsigned int)anInt;
+   h += 0x9E3779B97F4A7C15ULL;
+   h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+   return h ^ (h >> 31);
 }
@@ -20,6 +20,29 @@
 //     Note: When the IntSet is put to use after construction,
 //           its capacity will be resized as necessary.
 //
+// TRUSTED-INPUT CONSTRUCTION AND RELEASE
+//   static IntSet adopt(std::unique_ptr<int[]> buffer, int size,
+//                       int capacity)
+//     Pre:  buffer holds capacity ints (capacity >= 1, or buffer may
+//           be null when size is 0), of which buffer[0] ..
+//           buffer[size - 1] are distinct.
+//     Post: An IntSet owning buffer (no copy is made) with those size
+//           elements, in that order, is returned.
+//   template <class It> static IntSet fromUniqueRange(It first, It last)
+//     Pre:  The values in [first, last) are distinct.
+//     Post: An IntSet holding them, in that order, is returned (one
+//           copy, no per-element search).
+//   std::unique_ptr<int[]> release(int& size, int& capacity)
+//     Post: The element array is returned with its ownership; size
+//           and capacity describe it, and the invoking IntSet is
+//           empty (with a new array of DEFAULT_CAPACITY).
+//     Note: adopt and fromUniqueRange trust their input: the O(n)
+//           statistics pass they make does not look for duplicates.
+//           Compiling IntSet.cpp with -DINTSET_CHECK_UNIQUE adds an
+//           assert that the input really was duplicate-free. A buffer
+//           from malloc cannot be adopted (it would be freed with
+//           delete []); use fromUniqueRange to copy it instead.
+//
 // CONSTANT MEMBER FUNCTIONS (ACCESSORS)
 //   int size() const
 //     Pre:  (none)
@@ -69,6 +92,132 @@
 //           returned is one that initially is an exact copy of the
 //           invoking IntSet but subsequently has all elements of
 //           otherIntSet removed.
+//   void unionInto(const IntSet& otherIntSet, IntSet& out) const
+//   void intersectInto(const IntSet& otherIntSet, IntSet& out) const
+//   void subtractInto(const IntSet& otherIntSet, IntSet& out) const
+//     Pre:  (none)
+//     Post: out holds exactly what unionWith(otherIntSet),
+//           intersect(otherIntSet) or subtract(otherIntSet) would
+//           return, in the same order; out's previous contents are
+//           gone.
+//     Note: out's existing array is reused whenever it is big enough
+//           and the hit flags and kernel scratch are kept per thread,
+//           so a loop that computes into the same out over inputs of
+//           similar size does no heap allocation once warmed up.
+//           out may be the invoking IntSet or otherIntSet (a union
+//           into otherIntSet is built aside and then swapped in).
+//   IntSet symmetricDifference(const IntSet& otherIntSet) const
+//     Pre:  (none)
+//     Post: An IntSet holding the elements that are in exactly one of
+//           the invoking IntSet and otherIntSet is returned: first
+//           those only in the invoking IntSet, then those only in
+//           otherIntSet, each group in its original order.
+//     Note: Same result as subtract(otherIntSet).unionWith(
+//           otherIntSet.subtract(*this)), but computed in a single
+//           pass over each input.
+//   bool isDisjoint(const IntSet& otherIntSet) const
+//     Pre:  (none)
+//     Post: True is returned if the invoking IntSet and otherIntSet
+//           have no element in common, otherwise false.
+//     Note: Uses the same kernels as intersectionSize (see below)
+//           but stops at the first common element.
+//   int intersectionSize(const IntSet& otherIntSet) const
+//   int unionSize(const IntSet& otherIntSet) const
+//   int differenceSize(const IntSet& otherIntSet) const
+//     Post: The number of elements intersect(otherIntSet),
+//           unionWith(otherIntSet) or subtract(otherIntSet) would
+//           have is returned, without building that IntSet.
+//   double jaccard(const IntSet& otherIntSet) const
+//     Post: intersectionSize / unionSize is returned (1.0 if both
+//           IntSet's are empty).
+//   double overlapCoefficient(const IntSet& otherIntSet) const
+//     Post: intersectionSize divided by the smaller of the two sizes
+//           is returned (1.0 if either IntSet is empty, since an
+//           empty IntSet is a subset of every IntSet).
+//     Note: isSubsetOf, unionWith, intersect, subtract,
+//           symmetricDifference, isDisjoint, the counting functions
+//           and intersectAll all pick their kernel (see SetKernels.h)
+//           per call: every IntSet keeps its size, smallest and
+//           largest element and whether it is in ascending order up
+//           to date as it changes, and a cost model calibrated at
+//           startup prices scan, merge, galloping, bitmap and hash
+//           kernels from those statistics (see SetPlanner.h). The
+//           choice never changes a result or its element order.
+//   SetStats stats() const
+//     Post: Those statistics for the invoking IntSet are returned
+//           (in O(1)), e.g. for pricing an operation with planCost.
+//
+// ELEMENT ACCESS (without copying)
+//   typedef const int* const_iterator
+//   const_iterator begin() const
+//   const_iterator end() const
+//     Post: [begin(), end()) are the elements in insertion order
+//           (i.e. data[0] .. data[size() - 1]), usable with any STL
+//           algorithm that takes random-access iterators.
+//   View view() const
+//     Post: A View of the elements is returned: a pointer and a size,
+//           like std::span<const int> (which C++11 does not have),
+//           with data(), size(), empty(), operator[], begin() and
+//           end().
+//   template <class F> void forEach(F f) const
+//     Post: f(x) has been called for every element x, in insertion
+//           order.
+//     Note: Iterators, views and raw pointers obtained from them are
+//           invalidated by any mutator (and by assignment) of the
+//           invoking IntSet.
+//
+// MULTI-WAY SET ALGEBRA (STATIC MEMBER FUNCTIONS)
+//   static IntSet unionAll(const IntSet* const sets[], int numSets)
+//     Pre:  sets[0] .. sets[numSets - 1] point to IntSet's.
+//     Post: An IntSet representing the union of all the IntSet's is
+//           returned; its elements are in the order they would be
+//           after chaining sets[0]->unionWith(*sets[1]).unionWith(
+//           *sets[2])... (an empty IntSet if numSets < 1).
+//     Note: Done in a single pass into a result pre-sized from the
+//           total size of the inputs, with a hash index to skip
+//           values already taken.
+//   static IntSet intersectAll(const IntSet* const sets[], int numSets)
+//     Pre:  sets[0] .. sets[numSets - 1] point to IntSet's.
+//     Post: An IntSet representing the intersection of all the
+//           IntSet's is returned, with its elements in the order they
+//           have in the smallest input (an empty IntSet if
+//           numSets < 1).
+//     Note: Inputs are processed smallest first, and processing stops
+//           as soon as the running result is empty.
+//
+// PARALLEL SET ALGEBRA
+//   Each of the following gives the same result as the sequential
+//   member function it is named after, but builds a hash index
+//   (see IntIndex.h) over one input and splits the other input into
+//   contiguous slices that are probed on up to numThreads threads
+//   (numThreads <= 0 means one per hardware thread). Slices are
+//   concatenated in order, so results keep the same insertion order
+//   as the sequential versions. Inputs smaller than PARALLEL_GRAIN
+//   elements are processed on the calling thread only.
+//   IntSet parallelUnionWith(const IntSet& otherIntSet,
+//                            int numThreads = 0) const
+//   IntSet parallelIntersect(const IntSet& otherIntSet,
+//                            int numThreads = 0) const
+//   IntSet parallelSubtract(const IntSet& otherIntSet,
+//                           int numThreads = 0) const
+//   bool parallelIsSubsetOf(const IntSet& otherIntSet,
+//                           int numThreads = 0) const
+//   bool parallelEquals(const IntSet& otherIntSet,
+//                       int numThreads = 0) const
+//     Note: parallelIsSubsetOf and parallelEquals stop all threads
+//           soon after any one of them finds a counterexample;
+//           parallelEquals rejects sets of different size at once.
+//   IntSet sortedUnionWith(const IntSet& otherIntSet,
+//                          int numThreads = 0) const
+//   IntSet sortedIntersect(const IntSet& otherIntSet,
+//                          int numThreads = 0) const
+//     Post: An IntSet representing the union (intersection) of the
+//           invoking IntSet and otherIntSet is returned, with its
+//           elements in ascending order (NOT insertion order).
+//     Note: Both inputs are viewed in ascending order (a sorted copy
+//           is made of an input that is not already ascending) and
+//           merged with the output split into equal merge-path
+//           pieces, one per thread (see MergePath.h).
 //
 // MODIFICATION MEMBER FUNCTIONS (MUTATORS)
 //   void reset()
@@ -87,6 +236,59 @@
 //           removed from the invoking IntSet and true is
 //           returned, otherwise the invoking IntSet is unchanged
 //           and false is returned.
+//   int addAll(const int* values, int n)
+//     Pre:  values[0..n) are readable (duplicates are allowed).
+//     Post: Every value not yet an element has been added, in the
+//           order of its first occurrence in values (exactly as n
+//           calls of add would), and the number added is returned.
+//     Note: One hash index over the elements serves all n values, so
+//           this is O(size() + n) rather than add's O(size()) per
+//           value; values are taken BULK_ADD_BATCH at a time so the
+//           array grows with what is actually added. values may point
+//           into the invoking IntSet's own array (e.g. begin()); such
+//           values are copied before anything is added.
+//   void swap(IntSet& other)
+//     Pre:  (none)
+//     Post: The invoking IntSet and other have exchanged contents
+//           (in O(1), without copying any elements).
+//
+// CHANGE TRACKING
+//   struct IntSetDelta
+//     bool cleared          the set was emptied (by reset() or by a
+//                           bulk rewrite such as assignment) since the
+//                           checkpoint; removed is then empty
+//     std::vector<int> removed  elements of the checkpoint that have
+//                           been removed since (each at most once)
+//     std::vector<int> added    elements added since and still there,
+//                           in insertion order
+//     int baseSize, std::size_t baseHash   size() and hash() at the
+//                           checkpoint
+//     Applying a delta to the set as it was at the checkpoint (see
+//     applyDelta) gives the current set, insertion order included: an
+//     element removed and then added again is in both lists.
+//   void trackChanges(bool on = true)
+//     Post: If on, the invoking IntSet records its changes from now on
+//           in a fresh delta (as if markCheckpoint() had been called;
+//           a set already tracking keeps its delta); otherwise it
+//           records nothing and its delta is gone.
+//   bool tracksChanges() const
+//     Post: true is returned if the invoking IntSet records changes.
+//   const IntSetDelta& changes() const
+//     Pre:  tracksChanges()
+//     Post: The changes since the last checkpoint are returned.
+//   void markCheckpoint()
+//     Pre:  tracksChanges()
+//     Post: The delta is empty and its base is the current set.
+//   void applyDelta(const IntSetDelta& delta)
+//     Pre:  delta.removed holds distinct values.
+//     Post: The invoking IntSet has been reset if delta.cleared, then
+//           lost the elements in delta.removed and then gained those
+//           in delta.added, as reset(), remove() and addAll() would
+//           do (and recorded that way if it tracks changes).
+//     Note: Tracking costs one branch per added element; a remove()
+//           looks through the delta's added list, which is cheap
+//           while few elements change between checkpoints. A copy of
+//           a tracking IntSet does not track.
 //
 // NON-MEMBER FUNCTIONS
 //   bool operator==(const IntSet& is1, const IntSet& is2)
@@ -95,43 +297,193 @@
 //           otherwise false is returned; for e.g.: {1,2,3}, {1,3,2},
 //           {2,1,3}, {2,3,1}, {3,1,2}, and {3,2,1} are all equal.
 //     Note: By definition, two empty IntSet's are equal.
+//     Note: IntSet's of different size or different fingerprint (see
+//           hash()) are rejected in O(1); only when both match are
+//           the elements compared.
+//
+// HASHING
+//   std::size_t hash() const  (member)
+//     Pre:  (none)
+//     Post: An order-independent hash of the elements is returned;
+//           IntSet's that are == always have the same hash().
+//     Note: The hash is a 64-bit fingerprint (the sum of a mixed
+//           hash of every element) that add, remove, reset and the
+//           set-algebra operations keep up to date incrementally, so
+//           hash() is O(1). std::hash<IntSet> is specialized to call
+//           it, so IntSet's can be used as keys in unordered
+//           containers.
 //
 // VALUE SEMANTICS
 //   Assignment and the copy constructor may be used with IntSet
-//   objects.
+//   objects. An IntSet that is about to go away (a temporary or a
+//   std::move'd object) is moved instead: its array is taken over
+//   without copying any elements, and it is left empty (move
+//   construction) or holding the old contents of the target (move
+//   assignment).
+//
+// SET EXPRESSIONS
+//   IntSet(const SetExpr<E>& expr)
+//   IntSet& operator=(const SetExpr<E>& expr)
+//     Post: The invoking IntSet holds the result of the lazy set
+//           expression expr (built with |, &, - and ^), evaluated in
+//           one fused pass without temporaries (see SetExpr.h, which
+//           must be included to use them).
 
 #ifndef INT_SET_H
 #define INT_SET_H
 
+#include <cstddef>
+#include <functional>
+#include <iterator>
 #include <iostream>
+#include <memory>
+#include <vector>
+
+template <class Derived> struct SetExpr;
+struct SetStats;
+
+struct IntSetDelta
+{
+   bool cleared;
+   std::vector<int> removed;
+   std::vector<int> added;
+   int baseSize;
+   std::size_t baseHash;
+};
 
 class IntSet
 {
 public:
+   typedef const int* const_iterator;
+
+   class View
+   {
+   public:
+      View(const int* first, int count) : first(first), count(count) {}
+      const int* data() const { return first; }
+      int size() const { return count; }
+      bool empty() const { return count == 0; }
+      int operator[](int i) const { return first[i]; }
+      const_iterator begin() const { return first; }
+      const_iterator end() const { return first + count; }
+   private:
+      const int* first;
+      int count;
+   };
+
    static const int DEFAULT_CAPACITY = 1;
+   static const int PARALLEL_GRAIN = 16384;
+   static const int BULK_ADD_BATCH = 65536;
    IntSet(int initial_capacity = DEFAULT_CAPACITY);
    IntSet(const IntSet& src);
+   IntSet(IntSet&& src);
    ~IntSet();
    IntSet& operator=(const IntSet& rhs);
+   IntSet& operator=(IntSet&& rhs);
+   template <class E> IntSet(const SetExpr<E>& expr);
+   template <class E> IntSet& operator=(const SetExpr<E>& expr);
+   static IntSet adopt(std::unique_ptr<int[]> buffer, int size, int capacity);
+   template <class It> static IntSet fromUniqueRange(It first, It last);
+   std::unique_ptr<int[]> release(int& size, int& capacity);
    int size() const;
    bool isEmpty() const;
    bool contains(int anInt) const;
    bool isSubsetOf(const IntSet& otherIntSet) const;
    void DumpData(std::ostream& out) const;
+   const_iterator begin() const { return data; }
+   const_iterator end() const { return data + used; }
+   View view() const { return View(data, used); }
+   template <class F> void forEach(F f) const;
    IntSet unionWith(const IntSet& otherIntSet) const;
    IntSet intersect(const IntSet& otherIntSet) const;
    IntSet subtract(const IntSet& otherIntSet) const;
+   void unionInto(const IntSet& otherIntSet, IntSet& out) const;
+   void intersectInto(const IntSet& otherIntSet, IntSet& out) const;
+   void subtractInto(const IntSet& otherIntSet, IntSet& out) const;
+   IntSet symmetricDifference(const IntSet& otherIntSet) const;
+   bool isDisjoint(const IntSet& otherIntSet) const;
+   int intersectionSize(const IntSet& otherIntSet) const;
+   int unionSize(const IntSet& otherIntSet) const;
+   int differenceSize(const IntSet& otherIntSet) const;
+   double jaccard(const IntSet& otherIntSet) const;
+   double overlapCoefficient(const IntSet& otherIntSet) const;
+   SetStats stats() const;
+   static IntSet unionAll(const IntSet* const sets[], int numSets);
+   static IntSet intersectAll(const IntSet* const sets[], int numSets);
+   IntSet parallelUnionWith(const IntSet& otherIntSet, int numThreads = 0) const;
+   IntSet parallelIntersect(const IntSet& otherIntSet, int numThreads = 0) const;
+   IntSet parallelSubtract(const IntSet& otherIntSet, int numThreads = 0) const;
+   bool parallelIsSubsetOf(const IntSet& otherIntSet, int numThreads = 0) const;
+   bool parallelEquals(const IntSet& otherIntSet, int numThreads = 0) const;
+   IntSet sortedUnionWith(const IntSet& otherIntSet, int numThreads = 0) const;
+   IntSet sortedIntersect(const IntSet& otherIntSet, int numThreads = 0) const;
    void reset();
    bool add(int anInt);
    bool remove(int anInt);
+   int addAll(const int* values, int n);
+   void swap(IntSet& other);
+   std::size_t hash() const;
+   void trackChanges(bool on = true);
+   bool tracksChanges() const;
+   const IntSetDelta& changes() const;
+   void markCheckpoint();
+   void applyDelta(const IntSetDelta& delta);
 
 private:
+   friend class AtomicBitSet;
+   friend struct SetExprAccess;
    int* data;
    int  capacity;
    int  used;
+   unsigned long long fingerprint;
+   int  minValue;
+   int  maxValue;
+   bool ascending;
+   IntSetDelta* delta;   // 0 unless tracking changes
    void resize(int new_capacity);
+   void append(int anInt);
+   void recomputeStats();
+   void parallelRecomputeStats(int numThreads);
+   void prepare(int min_capacity);
+   void checkUnique() const;
+   void noteRemoved(int anInt);
+   void noteRewritten();
+   static unsigned long long elementHash(int anInt);
+   static IntSet parallelFilter(const IntSet* prefix, const IntSet& probe,
+                                const IntSet& indexed, bool keepFound,
+                                int numThreads);
+   const int* sortedView(std::vector<int>& scratch) const;
 };
 
+template <class It>
+IntSet IntSet::fromUniqueRange(It first, It last)
+{
+   IntSet result(int(std::distance(first, last)));
+   for (; first != last; ++first)
+      result.append(*first);
+   result.checkUnique();
+   return result;
+}
+
+template <class F>
+void IntSet::forEach(F f) const
+{
+   for (int i = 0; i < used; ++i)
+      f(data[i]);
+}
+
 bool operator==(const IntSet& is1, const IntSet& is2);
 
+namespace std
+{
+   template <>
+   struct hash<IntSet>
+   {
+      size_t operator()(const IntSet& is) const
+      {
+         return is.hash();
+      }
+   };
+}
+
 #endif
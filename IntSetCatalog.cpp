@@ -0,0 +1,464 @@
+// FILE: IntSetCatalog.cpp
+//       Implementation file for catalog loading
+//       (See IntSetCatalog.h for documentation.)
+
+#include "IntSetCatalog.h"
+#include "IntSetFile.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+//the open, read and close operations and the probe came with 5.6
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define INTSET_CATALOG_IO_URING 1
+#endif
+#endif
+#endif
+using namespace std;
+
+namespace
+{
+   enum EntryState { PENDING, LOADED, FAILED };
+
+   //true once the first have bytes of buffer hold a whole IntSet file
+   bool complete(const vector<char>& buffer, size_t have)
+   {
+      IntSetFileHeader h;
+      return checkIntSetHeader(buffer.data(), have, h);
+   }
+
+   //room for the next read of a file: the buffer doubles once full
+   void makeRoom(vector<char>& buffer, size_t have)
+   {
+      if (have == buffer.size())
+         buffer.resize(buffer.empty() ? READ_CHUNK_BYTES : 2 * buffer.size());
+   }
+
+   //opens, reads and decodes one file with blocking calls
+   bool loadFile(const char* path, vector<char>& buffer, IntSet& set)
+   {
+      int fd = open(path, O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+         return false;
+      size_t have = 0;
+      bool readOk = true;
+      for (;;)
+      {
+         makeRoom(buffer, have);
+         ssize_t n = pread(fd, &buffer[have], buffer.size() - have, off_t(have));
+         if (n < 0 && errno == EINTR)
+            continue;
+         if (n <= 0)
+         {
+            readOk = n == 0;
+            break;
+         }
+         have += size_t(n);
+         if (complete(buffer, have))
+            break;
+      }
+      close(fd);
+      return readOk && decodeIntSet(buffer.data(), have, set);
+   }
+
+   //loads the entries listed in which on up to numThreads threads
+   void threadLoad(const vector<CatalogEntry>& entries, const vector<int>& which,
+                   int numThreads, vector<IntSet>& sets, vector<char>& state)
+   {
+      parallelFor(int(which.size()), numThreads, [&](int t)
+      {
+         int i = which[t];
+         vector<char> buffer;
+         state[i] = loadFile(entries[i].path.c_str(), buffer, sets[i])
+                    ? LOADED : FAILED;
+      });
+   }
+
+#ifdef INTSET_CATALOG_IO_URING
+   //an io_uring instance driven through raw syscalls; one thread only
+   class Ring
+   {
+   public:
+      Ring();
+      ~Ring();
+      bool open(unsigned entries);
+      void close();
+      unsigned capacity() const { return sqEntries; }
+      void queue(const io_uring_sqe& entry);
+      bool submitAndWait();
+      bool pop(io_uring_cqe& completion);
+
+   private:
+      int fd;
+      void* sqRing;
+      size_t sqLength;
+      void* cqRing;
+      size_t cqLength;
+      io_uring_sqe* sqes;
+      size_t sqesLength;
+      unsigned sqEntries;
+      unsigned queued;               // queued but not yet submitted
+      unsigned* sqTail;
+      unsigned* sqMask;
+      unsigned* sqArray;
+      unsigned* cqHead;
+      unsigned* cqTail;
+      unsigned* cqMask;
+      io_uring_cqe* cqes;
+
+      Ring(const Ring&);
+      Ring& operator=(const Ring&);
+      bool supportsOps();
+   };
+
+   Ring::Ring()
+      : fd(-1), sqRing(MAP_FAILED), sqLength(0), cqRing(MAP_FAILED),
+        cqLength(0), sqes(0), sqesLength(0), sqEntries(0), queued(0)
+   {
+   }
+
+   Ring::~Ring()
+   {
+      close();
+   }
+
+   //tears the ring down; a closed ring stays closed
+   void Ring::close()
+   {
+      if (sqes != 0)
+         munmap(sqes, sqesLength);
+      if (cqRing != MAP_FAILED && cqRing != sqRing)
+         munmap(cqRing, cqLength);
+      if (sqRing != MAP_FAILED)
+         munmap(sqRing, sqLength);
+      if (fd >= 0)
+         ::close(fd);
+      fd = -1;
+      sqRing = cqRing = MAP_FAILED;
+      sqes = 0;
+      sqEntries = queued = 0;
+   }
+
+   bool Ring::open(unsigned entries)
+   {
+      io_uring_params p;
+      memset(&p, 0, sizeof p);
+      fd = int(syscall(__NR_io_uring_setup, entries, &p));
+      if (fd < 0)
+         return false;
+
+      sqLength = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+      cqLength = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+      bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+      if (single)
+         sqLength = cqLength = max(sqLength, cqLength);
+      sqRing = mmap(0, sqLength, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+      if (sqRing == MAP_FAILED)
+         return false;
+      cqRing = single ? sqRing
+                      : mmap(0, cqLength, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+      if (cqRing == MAP_FAILED)
+         return false;
+      sqesLength = p.sq_entries * sizeof(io_uring_sqe);
+      void* s = mmap(0, sqesLength, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+      if (s == MAP_FAILED)
+         return false;
+      sqes = static_cast<io_uring_sqe*>(s);
+
+      char* sq = static_cast<char*>(sqRing);
+      char* cq = static_cast<char*>(cqRing);
+      sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+      sqMask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+      sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+      cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+      cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+      cqMask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+      cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+      sqEntries = p.sq_entries;
+      return supportsOps();
+   }
+
+   //whether the kernel knows every operation the loader queues
+   bool Ring::supportsOps()
+   {
+      const unsigned MAX_OPS = 256;
+      vector<char> space(sizeof(io_uring_probe) + MAX_OPS * sizeof(io_uring_probe_op));
+      io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(&space[0]);
+      if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe,
+                  MAX_OPS) < 0)
+         return false;
+      const int ops[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE };
+      for (size_t i = 0; i < sizeof ops / sizeof ops[0]; ++i)
+         if (ops[i] > probe->last_op
+             || !(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED))
+            return false;
+      return true;
+   }
+
+   //Pre: fewer than capacity() entries are queued or in flight
+   void Ring::queue(const io_uring_sqe& entry)
+   {
+      unsigned tail = *sqTail;
+      unsigned index = tail & *sqMask;
+      sqes[index] = entry;
+      sqArray[index] = index;
+      //the entry must be in place before the kernel sees the new tail
+      __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+      ++queued;
+   }
+
+   //hands the queued entries to the kernel and waits for a completion
+   bool Ring::submitAndWait()
+   {
+      for (;;)
+      {
+         long n = syscall(__NR_io_uring_enter, fd, queued, 1,
+                          IORING_ENTER_GETEVENTS, 0, 0);
+         if (n >= 0)
+         {
+            queued -= unsigned(n);
+            return true;
+         }
+         if (errno != EINTR)
+            return false;
+      }
+   }
+
+   bool Ring::pop(io_uring_cqe& completion)
+   {
+      unsigned head = *cqHead;
+      if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+         return false;
+      completion = cqes[head & *cqMask];
+      __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+      return true;
+   }
+
+   //a file on its way through the ring
+   struct Slot
+   {
+      int entry;
+      int fd;                 // -1 while it is being opened
+      vector<char> buffer;
+      size_t have;
+   };
+
+   //marks the user_data of close entries, which hold the descriptor
+   //closed instead of a slot
+   const uint64_t CLOSE_DATA = uint64_t(1) << 63;
+
+   void forget(vector<int>& opened, int fd)
+   {
+      opened.erase(remove(opened.begin(), opened.end(), fd), opened.end());
+   }
+
+   io_uring_sqe makeEntry(int opcode, int fd, uint64_t userData)
+   {
+      io_uring_sqe e;
+      memset(&e, 0, sizeof e);
+      e.opcode = uint8_t(opcode);
+      e.fd = fd;
+      e.user_data = userData;
+      return e;
+   }
+
+   void queueOpen(Ring& ring, const char* path, int slot)
+   {
+      io_uring_sqe e = makeEntry(IORING_OP_OPENAT, AT_FDCWD, uint64_t(slot));
+      e.addr = uint64_t(uintptr_t(path));
+      e.open_flags = O_RDONLY | O_CLOEXEC;
+      ring.queue(e);
+   }
+
+   void queueRead(Ring& ring, Slot& s, int slot)
+   {
+      makeRoom(s.buffer, s.have);
+      io_uring_sqe e = makeEntry(IORING_OP_READ, s.fd, uint64_t(slot));
+      e.addr = uint64_t(uintptr_t(&s.buffer[s.have]));
+      e.len = unsigned(s.buffer.size() - s.have);
+      e.off = s.have;
+      ring.queue(e);
+   }
+
+   //loads the entries through ring, with up to depth files in flight
+   //and each file decoded as its last read completes. false is returned
+   //if the ring failed; it has then been closed, and the entries still
+   //PENDING are left to the caller.
+   bool ringLoad(Ring& ring, const vector<CatalogEntry>& entries, int depth,
+                 vector<IntSet>& sets, vector<char>& state)
+   {
+      //entries queued or in flight never exceed the submission queue,
+      //so the queue (and the completion queue, twice its size) never
+      //overflows
+      unsigned cap = ring.capacity();
+      vector<Slot> slots(size_t(max(depth, 1)));
+      vector<int> opened;     // descriptors not yet closed
+      vector<int> idle;
+      for (size_t s = slots.size(); s-- > 0; )
+         idle.push_back(int(s));
+      size_t next = 0;
+      unsigned inflight = 0;
+
+      for (;;)
+      {
+         while (!idle.empty() && next < entries.size() && inflight < cap)
+         {
+            int s = idle.back();
+            idle.pop_back();
+            slots[s].entry = int(next++);
+            slots[s].fd = -1;
+            queueOpen(ring, entries[slots[s].entry].path.c_str(), s);
+            ++inflight;
+         }
+         if (inflight == 0)
+            return true;
+
+         io_uring_cqe c;
+         if (!ring.submitAndWait())
+         {
+            //account for what has completed, then tear the ring down
+            //before the slots go: the kernel may write into the buffers
+            //of reads in flight until then. The files still open are
+            //closed here.
+            while (ring.pop(c))
+               if (c.user_data & CLOSE_DATA)
+                  forget(opened, int(c.user_data & ~CLOSE_DATA));
+               else if (slots[size_t(c.user_data)].fd < 0 && c.res >= 0)
+                  opened.push_back(c.res);
+            ring.close();
+            for (size_t i = 0; i < opened.size(); ++i)
+               close(opened[i]);
+            return false;
+         }
+
+         while (ring.pop(c))
+         {
+            --inflight;
+            if (c.user_data & CLOSE_DATA)
+            {
+               forget(opened, int(c.user_data & ~CLOSE_DATA));
+               continue;
+            }
+            int slot = int(c.user_data);
+            Slot& s = slots[slot];
+            if (s.fd < 0)
+            {
+               if (c.res < 0)
+               {
+                  state[s.entry] = FAILED;
+                  idle.push_back(slot);
+                  continue;
+               }
+               s.fd = c.res;
+               s.have = 0;
+               opened.push_back(s.fd);
+               queueRead(ring, s, slot);
+               ++inflight;
+               continue;
+            }
+
+            //a read that comes back empty (end of file) or failed ends
+            //the file; one that leaves it incomplete is followed by more
+            if (c.res > 0)
+               s.have += size_t(c.res);
+            if (c.res == -EINTR || c.res == -EAGAIN
+                || (c.res > 0 && !complete(s.buffer, s.have)))
+            {
+               queueRead(ring, s, slot);
+               ++inflight;
+               continue;
+            }
+            state[s.entry] = c.res >= 0
+                             && decodeIntSet(s.buffer.data(), s.have, sets[s.entry])
+                             ? LOADED : FAILED;
+            ring.queue(makeEntry(IORING_OP_CLOSE, s.fd, CLOSE_DATA | uint32_t(s.fd)));
+            ++inflight;
+            idle.push_back(slot);
+         }
+      }
+   }
+#endif
+}
+
+int loadIntSetCatalog(const vector<CatalogEntry>& entries,
+                      IntSetRegistry& registry, vector<string>* failed,
+                      const CatalogOptions& options)
+{
+   vector<IntSet> sets(entries.size());
+   vector<char> state(entries.size(), PENDING);
+#ifdef INTSET_CATALOG_IO_URING
+   if (options.useIoUring && !entries.empty())
+   {
+      int depth = max(options.queueDepth, 1);
+      Ring ring;
+      if (ring.open(2 * unsigned(depth)))
+         ringLoad(ring, entries, depth, sets, state);
+   }
+#endif
+
+   //whatever the ring did not get to
+   vector<int> rest;
+   for (size_t i = 0; i < entries.size(); ++i)
+      if (state[i] == PENDING)
+         rest.push_back(int(i));
+   threadLoad(entries, rest, options.numThreads, sets, state);
+
+   //in entry order, so a later entry for a name wins
+   int loaded = 0;
+   for (size_t i = 0; i < entries.size(); ++i)
+      if (state[i] == LOADED)
+      {
+         registry[entries[i].name].swap(sets[i]);
+         ++loaded;
+      }
+      else if (failed != 0)
+         failed->push_back(entries[i].name);
+   return loaded;
+}
+
+bool listIntSetCatalog(const char* directory, const char* suffix,
+                       vector<CatalogEntry>& entries)
+{
+   DIR* dir = opendir(directory);
+   if (dir == 0)
+      return false;
+   size_t suffixLength = strlen(suffix);
+   vector<string> names;
+   while (dirent* d = readdir(dir))
+   {
+      string name = d->d_name;
+      if (name != "." && name != ".." && name.size() > suffixLength
+          && name.compare(name.size() - suffixLength, suffixLength, suffix) == 0)
+         names.push_back(name);
+   }
+   closedir(dir);
+
+   sort(names.begin(), names.end());
+   for (size_t i = 0; i < names.size(); ++i)
+      entries.push_back(CatalogEntry(names[i].substr(0, names[i].size() - suffixLength),
+                                     string(directory) + "/" + names[i]));
+   return true;
+}
+
+bool catalogUsesIoUring()
+{
+#ifdef INTSET_CATALOG_IO_URING
+   Ring ring;
+   return ring.open(2);
+#else
+   return false;
+#endif
+}
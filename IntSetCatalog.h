@@ -0,0 +1,104 @@
+// FILE: IntSetCatalog.h - loading many IntSet files at once
+//
+// A catalog is a list of named IntSet files (see IntSetFile.h) loaded
+// together into a registry, a map from name to IntSet. Opening,
+// reading and closing each file with its own blocking syscalls makes a
+// catalog of many small files cost a few syscalls per file on a single
+// thread. loadIntSetCatalog instead keeps up to queueDepth files in
+// flight through an io_uring ring: the open, reads and close of every
+// file are queued as ring entries and handed to the kernel in batches
+// by one io_uring_enter call, and each file is decoded (decodeIntSet)
+// as soon as its last read completes, while the reads of the others
+// go on.
+//
+// The ring is set up with raw syscalls (no liburing), and only when the
+// kernel headers define it and the running kernel supports the open,
+// read and close operations; otherwise, or when options.useIoUring is
+// false, numThreads threads each open, pread and decode a share of the
+// files instead.
+//
+// A file is read in READ_CHUNK_BYTES pieces at first, doubling the
+// buffer while it is full, and read no further once the buffer holds
+// a complete IntSet file (its header says how long it is): a small
+// file takes one read.
+//
+// TYPES
+//   struct CatalogEntry
+//     name               key of the set in the registry
+//     path               file it is loaded from
+//   typedef std::map<std::string, IntSet> IntSetRegistry
+//   struct CatalogOptions
+//     useIoUring         use io_uring when available (default true)
+//     queueDepth         files in flight in the ring (default 64)
+//     numThreads         threads without io_uring; one per hardware
+//                        thread if <= 0 (default 0)
+//
+// CONSTANTS
+//   READ_CHUNK_BYTES     size of the first read of each file
+//
+// FUNCTIONS PROVIDED:
+//   int loadIntSetCatalog(const std::vector<CatalogEntry>& entries,
+//                         IntSetRegistry& registry,
+//                         std::vector<std::string>* failed = 0,
+//                         const CatalogOptions& options = CatalogOptions())
+//     Post: Every entry whose file is a valid IntSet file (checksum
+//           included) has been stored in registry under its name,
+//           replacing what was there (for names listed twice, the
+//           later entry wins); the names of the other entries have
+//           been appended to *failed (when failed is not 0). The
+//           number of entries loaded is returned.
+//   bool listIntSetCatalog(const char* directory, const char* suffix,
+//                          std::vector<CatalogEntry>& entries)
+//     Post: If directory could be read, an entry for each file in it
+//           whose name ends in suffix (and is longer; "." and ".." are
+//           skipped) has been appended to entries, in name order, named
+//           by the file name without suffix; true is returned.
+//           Otherwise false is returned and entries is unchanged.
+//   bool catalogUsesIoUring()
+//     Post: true is returned if loadIntSetCatalog can use io_uring on
+//           this build and kernel.
+
+#ifndef INT_SET_CATALOG_H
+#define INT_SET_CATALOG_H
+
+#include "IntSet.h"
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+const std::size_t READ_CHUNK_BYTES = 1 << 16;
+
+struct CatalogEntry
+{
+   std::string name;
+   std::string path;
+
+   CatalogEntry(const std::string& name, const std::string& path)
+      : name(name), path(path)
+   {
+   }
+};
+
+typedef std::map<std::string, IntSet> IntSetRegistry;
+
+struct CatalogOptions
+{
+   bool useIoUring;
+   int queueDepth;
+   int numThreads;
+
+   CatalogOptions() : useIoUring(true), queueDepth(64), numThreads(0)
+   {
+   }
+};
+
+int loadIntSetCatalog(const std::vector<CatalogEntry>& entries,
+                      IntSetRegistry& registry,
+                      std::vector<std::string>* failed = 0,
+                      const CatalogOptions& options = CatalogOptions());
+bool listIntSetCatalog(const char* directory, const char* suffix,
+                       std::vector<CatalogEntry>& entries);
+bool catalogUsesIoUring();
+
+#endif
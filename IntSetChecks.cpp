@@ -0,0 +1,2001 @@
+// FILE: IntSetChecks.cpp
+//       Implementation file for the automatic checks
+//       (See IntSetChecks.h for documentation.)
+
+#include "IntSetChecks.h"
+#include "IntSet.h"
+#include "AtomicBitSet.h"
+#include "ShardedIntSet.h"
+#include "Parallel.h"
+#include "MergePath.h"
+#include "SetPlanner.h"
+#include "WorkStealingPool.h"
+#include "SetBatch.h"
+#include "SetGraph.h"
+#include "SetExpr.h"
+#include "IntSetFile.h"
+#include "MappedIntSet.h"
+#include "CompressedIntSet.h"
+#include "PackedInts.h"
+#include "IntSetDump.h"
+#include "IntSetText.h"
+#include "DurableIntSet.h"
+#include "IntSetDeltaFile.h"
+#include "IntSetCatalog.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+using namespace std;
+
+namespace
+{
+   //counts and reports the failed cases of one check function
+   class Checker
+   {
+   public:
+      Checker(ostream& out) : out(out), failures(0) {}
+
+      void operator()(bool ok, const char* what)
+      {
+         if (!ok)
+         {
+            out << "   FAILED: " << what << endl;
+            ++failures;
+         }
+      }
+
+      int failed() const { return failures; }
+
+   private:
+      ostream& out;
+      int failures;
+   };
+
+   //the elements of set in order
+   vector<int> elementsOf(const IntSet& set)
+   {
+      return vector<int>(set.begin(), set.end());
+   }
+
+   //a set of n distinct values drawn from [0, range), in random order
+   IntSet randomSet(int n, int range, unsigned seed)
+   {
+      mt19937 random(seed);
+      IntSet set;
+      vector<int> values;
+      while (set.size() < n)
+      {
+         values.clear();
+         for (int i = set.size(); i < n; ++i)
+            values.push_back(int(random() % unsigned(range)));
+         set.addAll(&values[0], int(values.size()));
+      }
+      return set;
+   }
+
+   //true if a and b hold the same elements in the same order
+   bool sameOrder(const IntSet& a, const IntSet& b)
+   {
+      return a.size() == b.size() && equal(a.begin(), a.end(), b.begin());
+   }
+
+   //the elements of set in ascending order, as an IntSet
+   IntSet sortedCopy(const IntSet& set)
+   {
+      vector<int> values(set.begin(), set.end());
+      sort(values.begin(), values.end());
+      IntSet sorted;
+      if (!values.empty())
+         sorted.addAll(&values[0], int(values.size()));
+      return sorted;
+   }
+
+   //true if the fingerprint of set matches that of the same elements
+   //added one at a time, in reverse order
+   bool fingerprintHolds(const IntSet& set)
+   {
+      IntSet rebuilt;
+      for (int i = set.size() - 1; i >= 0; --i)
+         rebuilt.add(set.begin()[i]);
+      return set.hash() == rebuilt.hash();
+   }
+
+   //a directory of its own under the system temporary directory,
+   //removed with everything in it when the object goes away
+   class ScratchDir
+   {
+   public:
+      ScratchDir()
+      {
+         const char* tmp = getenv("TMPDIR");
+         string pattern = string(tmp && *tmp ? tmp : "/tmp") + "/intset-checks-XXXXXX";
+         vector<char> name(pattern.begin(), pattern.end());
+         name.push_back('\0');
+         if (mkdtemp(&name[0]))
+            dir = &name[0];
+      }
+
+      ~ScratchDir()
+      {
+         if (dir.empty())
+            return;
+         if (DIR* d = opendir(dir.c_str()))
+         {
+            while (dirent* e = readdir(d))
+               if (strcmp(e->d_name, ".") != 0 && strcmp(e->d_name, "..") != 0)
+                  unlink(path(e->d_name).c_str());
+            closedir(d);
+         }
+         rmdir(dir.c_str());
+      }
+
+      bool ok() const { return !dir.empty(); }
+      string path(const string& name) const { return dir + "/" + name; }
+
+   private:
+      string dir;
+
+      ScratchDir(const ScratchDir&);
+      ScratchDir& operator=(const ScratchDir&);
+   };
+
+   //a read-only stream buffer over a string that cannot seek, as a
+   //pipe cannot: tellg() on a stream reading it fails
+   class UnseekableBuffer : public streambuf
+   {
+   public:
+      explicit UnseekableBuffer(const string& bytes) : bytes(bytes)
+      {
+         char* first = &this->bytes[0];
+         setg(first, first, first + this->bytes.size());
+      }
+
+   private:
+      string bytes;
+   };
+
+   //the whole contents of the file at path
+   string fileContents(const string& path)
+   {
+      ifstream in(path.c_str(), ios::binary);
+      ostringstream bytes;
+      bytes << in.rdbuf();
+      return bytes.str();
+   }
+
+   //the bytes saveIntSet writes for set
+   string savedBytes(const IntSet& set, unsigned flags)
+   {
+      ostringstream out;
+      saveIntSet(set, out, flags);
+      return out.str();
+   }
+
+   IntSetFileHeader headerOf(const string& bytes)
+   {
+      IntSetFileHeader h;
+      memcpy(&h, bytes.data(), sizeof h);
+      return h;
+   }
+
+   void setHeader(string& bytes, const IntSetFileHeader& h)
+   {
+      memcpy(&bytes[0], &h, sizeof h);
+   }
+
+   //element i of the payload of a saved (unpacked) file
+   void setElement(string& bytes, int i, int32_t value)
+   {
+      memcpy(&bytes[sizeof(IntSetFileHeader) + i * sizeof(int32_t)], &value,
+             sizeof value);
+   }
+
+   //recomputes the checksum after the payload has been changed
+   void resum(string& bytes)
+   {
+      IntSetFileHeader h = headerOf(bytes);
+      h.checksum = intSetChecksum(bytes.data() + sizeof h, bytes.size() - sizeof h);
+      setHeader(bytes, h);
+   }
+
+   //loads bytes through a seekable stream, an unseekable one and
+   //decodeIntSet; true only if all three accept them, and false only
+   //if all three refuse them and leave set alone
+   enum LoadOutcome { LOADED_ALL, REFUSED_ALL, INCONSISTENT };
+   LoadOutcome loadAllWays(const string& bytes, IntSet& set)
+   {
+      IntSet viaStream(set), viaPipe(set), viaMemory(set);
+      istringstream stream(bytes);
+      UnseekableBuffer buffer(bytes);
+      istream pipe(&buffer);
+      bool a = loadIntSet(stream, viaStream);
+      bool b = loadIntSet(pipe, viaPipe);
+      bool c = decodeIntSet(bytes.data(), bytes.size(), viaMemory);
+      if (a && b && c && sameOrder(viaStream, viaPipe)
+          && sameOrder(viaStream, viaMemory))
+      {
+         set = viaStream;
+         return LOADED_ALL;
+      }
+      if (!a && !b && !c && sameOrder(viaStream, set) && sameOrder(viaPipe, set)
+          && sameOrder(viaMemory, set))
+         return REFUSED_ALL;
+      return INCONSISTENT;
+   }
+
+   //true if set holds exactly values, in that order
+   bool holds(const IntSet& set, const vector<int>& values)
+   {
+      return elementsOf(set) == values;
+   }
+
+   void writeFile(const string& path, const string& bytes)
+   {
+      ofstream file(path.c_str(), ios::binary | ios::trunc);
+      file << bytes;
+   }
+
+   //copies the files a DurableIntSet keeps for base from (those that
+   //exist) to base to, as a crash would leave them on disk
+   void crashImage(const string& from, const string& to)
+   {
+      const char* suffixes[] = { ".snap", ".wal", ".wal.next" };
+      for (size_t i = 0; i < sizeof suffixes / sizeof suffixes[0]; ++i)
+      {
+         string path = from + suffixes[i];
+         unlink((to + suffixes[i]).c_str());
+         if (access(path.c_str(), F_OK) == 0)
+            writeFile(to + suffixes[i], fileContents(path));
+      }
+   }
+
+   string deltaName(const string& base, int n)
+   {
+      ostringstream name;
+      name << base << ".delta." << n;
+      return name.str();
+   }
+
+   //copies the delta chain at from (the base and its deltas) to to,
+   //replacing the one there
+   void copyChain(const string& from, const string& to)
+   {
+      for (int n = 1; unlink(deltaName(to, n).c_str()) == 0; ++n)
+         ;
+      writeFile(to, fileContents(from));
+      for (int n = 1; access(deltaName(from, n).c_str(), F_OK) == 0; ++n)
+         writeFile(deltaName(to, n), fileContents(deltaName(from, n)));
+   }
+
+   //the set a DurableIntSet recovers from base; false if open fails
+   bool recover(const string& base, IntSet& set, long long* records = 0)
+   {
+      DurableOptions options;
+      options.checkpointRecords = 0;
+      DurableIntSet durable;
+      if (!durable.open(base.c_str(), options))
+         return false;
+      set = durable.toIntSet();
+      if (records)
+         *records = durable.logRecords();
+      return true;
+   }
+}
+
+int checkAtomicBitSet(ostream& out)
+{
+   Checker check(out);
+   AtomicBitSet a(130);
+   check(a.universeSize() == 130 && a.isEmpty(), "new AtomicBitSet is empty");
+   check(a.add(0) && a.add(64) && a.add(129) && !a.add(64),
+         "add reports whether the value was new");
+   check(!a.add(-1) && !a.add(130) && !a.contains(130),
+         "values outside the universe are refused");
+   check(a.size() == 3 && a.contains(129) && !a.contains(1), "size and contains");
+   check(a.remove(64) && !a.remove(64) && a.size() == 2, "remove");
+   check(holds(a.toIntSet(), vector<int>{0, 129}), "toIntSet is ascending");
+
+   AtomicBitSet b(70);
+   b.add(0);
+   b.add(5);
+   check(holds(a.unionWith(b), vector<int>{0, 5, 129}), "unionWith");
+   check(holds(a.intersect(b), vector<int>{0}), "intersect");
+   a.reset();
+   check(a.isEmpty() && a.toIntSet().size() == 0, "reset");
+
+   //one thread adds x and then x + HALF (a different word) for rising
+   //x, clearing the set between rounds; a snapshot taken at one
+   //instant never holds x + HALF without x
+   const int HALF = 1 << 12;
+   const int SNAPSHOTS = 2000;
+   AtomicBitSet moving(2 * HALF);
+   atomic<bool> stop(false);
+   thread writer([&]()
+   {
+      while (!stop)
+      {
+         for (int x = 0; x < HALF; ++x)
+         {
+            moving.add(x);
+            moving.add(x + HALF);
+         }
+         moving.reset();
+      }
+   });
+   bool consistent = true;
+   for (int n = 0; n < SNAPSHOTS; ++n)
+   {
+      vector<int> seen = elementsOf(moving.toIntSet());
+      vector<bool> present(2 * HALF, false);
+      for (size_t i = 0; i < seen.size(); ++i)
+         present[seen[i]] = true;
+      for (int x = 0; x < HALF; ++x)
+         if (present[x + HALF] && !present[x])
+            consistent = false;
+   }
+   stop = true;
+   writer.join();
+   check(consistent, "snapshots taken during writes are consistent");
+   check(moving.size() == moving.toIntSet().size(),
+         "striped count is exact once writers stop");
+   moving.reset();
+   check(moving.isEmpty(), "reset after concurrent writes");
+   return check.failed();
+}
+
+int checkShardedIntSet(ostream& out)
+{
+   Checker check(out);
+   const int CLIENTS = 3, PER_CLIENT = 500;
+   ShardedIntSet sharded(4, CLIENTS);
+   check(sharded.numShards() == 4 && sharded.numClients() == CLIENTS,
+         "shard and client counts");
+
+   //each client adds its own values twice, asks for them without
+   //waiting (requests to one shard keep their order) and removes the
+   //even ones
+   vector<thread> clients;
+   atomic<int> wrong(0);
+   for (int c = 0; c < CLIENTS; ++c)
+      clients.push_back(thread([&, c]()
+      {
+         vector<future<bool> > added, again, present, removed;
+         for (int i = 0; i < PER_CLIENT; ++i)
+         {
+            int v = c * PER_CLIENT + i;
+            added.push_back(sharded.add(c, v));
+            again.push_back(sharded.add(c, v));
+            present.push_back(sharded.contains(c, v));
+            if (v % 2 == 0)
+               removed.push_back(sharded.remove(c, v));
+         }
+         for (int i = 0; i < PER_CLIENT; ++i)
+            if (!added[i].get() || again[i].get() || !present[i].get())
+               ++wrong;
+         for (size_t i = 0; i < removed.size(); ++i)
+            if (!removed[i].get())
+               ++wrong;
+      }));
+   for (size_t c = 0; c < clients.size(); ++c)
+      clients[c].join();
+   check(wrong == 0, "results of concurrent requests");
+   check(sharded.size() == CLIENTS * PER_CLIENT / 2, "size once futures are ready");
+   check(!sharded.contains(0, 2).get() && sharded.contains(1, 3).get(),
+         "contains after removals");
+   check(sharded.shardOf(7) == sharded.shardOf(7) && sharded.shardOf(7) >= 0
+         && sharded.shardOf(7) < 4, "shardOf");
+   return check.failed();
+}
+
+int checkParallelAlgebra(ostream& out)
+{
+   Checker check(out);
+   const int N = 4 * IntSet::PARALLEL_GRAIN;
+   IntSet a = randomSet(N, 3 * N, 1), b = randomSet(N, 3 * N, 2);
+
+   //the results the sequential operations give, worked out with hash
+   //sets: a's elements in order, then (for the union) b's new ones
+   vector<int> va = elementsOf(a), vb = elementsOf(b);
+   unordered_set<int> inA(va.begin(), va.end()), inB(vb.begin(), vb.end());
+   vector<int> expectUnion(va), expectCommon, expectRest;
+   for (size_t k = 0; k < vb.size(); ++k)
+      if (inA.count(vb[k]) == 0)
+         expectUnion.push_back(vb[k]);
+   for (size_t k = 0; k < va.size(); ++k)
+      (inB.count(va[k]) != 0 ? expectCommon : expectRest).push_back(va[k]);
+
+   for (int threads = 1; threads <= 4; threads += 3)
+   {
+      IntSet u = a.parallelUnionWith(b, threads);
+      check(holds(u, expectUnion), "parallelUnionWith matches unionWith");
+      IntSet i = a.parallelIntersect(b, threads);
+      check(holds(i, expectCommon), "parallelIntersect matches intersect");
+      IntSet d = a.parallelSubtract(b, threads);
+      check(holds(d, expectRest), "parallelSubtract matches subtract");
+      check(i.parallelIsSubsetOf(a, threads) && !a.parallelIsSubsetOf(b, threads),
+            "parallelIsSubsetOf");
+      check(u.parallelEquals(b.parallelUnionWith(a, threads), threads)
+            && !u.parallelEquals(a, threads), "parallelEquals");
+   }
+   IntSet empty;
+   check(sameOrder(empty.parallelUnionWith(a, 4), a)
+         && a.parallelIntersect(empty, 4).isEmpty(),
+         "parallel operations with an empty set");
+
+   //parallelFor from several threads at once, each call nesting
+   //another: every task of every call runs exactly once
+   const int CALLERS = 4, TASKS = 50, INNER = 20;
+   vector<atomic<int> > runs(CALLERS * TASKS * INNER);
+   for (size_t r = 0; r < runs.size(); ++r)
+      runs[r] = 0;
+   vector<thread> callers;
+   for (int c = 0; c < CALLERS; ++c)
+      callers.push_back(thread([&, c]()
+      {
+         parallelFor(TASKS, 3, [&](int t)
+         {
+            parallelFor(INNER, 2, [&](int k)
+            {
+               ++runs[(c * TASKS + t) * INNER + k];
+            });
+         });
+      }));
+   for (size_t c = 0; c < callers.size(); ++c)
+      callers[c].join();
+   bool once = true;
+   for (size_t r = 0; r < runs.size(); ++r)
+      once = once && runs[r] == 1;
+   check(once, "nested and concurrent parallelFor run every task once");
+
+   //a throwing task ends the call on the caller; the pool goes on
+   int thrown = -1;
+   try
+   {
+      parallelFor(1000, 4, [&](int t)
+      {
+         if (t % 100 == 7)
+            throw t;
+      });
+   }
+   catch (int t)
+   {
+      thrown = t;
+   }
+   check(thrown % 100 == 7, "a throwing task is rethrown");
+   atomic<int> after(0);
+   parallelFor(100, 4, [&](int) { ++after; });
+   check(after == 100, "parallelFor after a task has thrown");
+   return check.failed();
+}
+
+int checkMergePath(ostream& out)
+{
+   Checker check(out);
+   //every other multiple of 3 in a, multiples of 2 in b: plenty of
+   //values in common, spread over every piece
+   const int N = 2 * MERGE_PATH_GRAIN;
+   vector<int> a, b;
+   for (int i = 0; i < N; ++i)
+   {
+      a.push_back(6 * i + (i % 2) * 3);
+      b.push_back(2 * i);
+   }
+   vector<int> expectUnion, expectCommon;
+   set_union(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expectUnion));
+   set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                    back_inserter(expectCommon));
+
+   bool splits = true;
+   for (int diag = 0; diag <= 2 * N; diag += 4099)
+   {
+      int i = mergePathSplit(&a[0], N, &b[0], N, diag), j = diag - i;
+      //everything before the split is <= everything after it
+      if (i < 0 || i > N || j < 0 || j > N
+          || (i > 0 && j < N && a[i - 1] > b[j])
+          || (j > 0 && i < N && b[j - 1] >= a[i]))
+         splits = false;
+   }
+   check(splits, "mergePathSplit cuts at a consistent point");
+
+   for (int threads = 1; threads <= 7; threads += 3)
+   {
+      vector<int> out(2 * N);
+      int n = sortedUnion(&a[0], N, &b[0], N, &out[0], threads);
+      check(n == int(expectUnion.size())
+            && equal(expectUnion.begin(), expectUnion.end(), out.begin()),
+            "sortedUnion");
+      n = sortedIntersection(&a[0], N, &b[0], N, &out[0], threads);
+      check(n == int(expectCommon.size())
+            && equal(expectCommon.begin(), expectCommon.end(), out.begin()),
+            "sortedIntersection");
+   }
+
+   //IntSet's versions sort unordered inputs first
+   IntSet x = randomSet(N, 4 * N, 3), y = randomSet(N, 4 * N, 4);
+   IntSet u = x.sortedUnionWith(y, 4), i = x.sortedIntersect(y, 4);
+   vector<int> inU = elementsOf(u), inI = elementsOf(i);
+   check(u.parallelEquals(x.parallelUnionWith(y)) && is_sorted(inU.begin(), inU.end()),
+         "sortedUnionWith");
+   check(i.parallelEquals(x.parallelIntersect(y)) && is_sorted(inI.begin(), inI.end()),
+         "sortedIntersect");
+   return check.failed();
+}
+
+int checkWorkStealingPool(ostream& out)
+{
+   Checker check(out);
+   const int PARENTS = 100, CHILDREN = 10;
+   atomic<int> ran(0);
+   {
+      WorkStealingPool pool(3);
+      check(pool.numThreads() == 3, "numThreads");
+
+      //tasks that spawn tasks: wait() covers the children too
+      for (int p = 0; p < PARENTS; ++p)
+         pool.submit([&]()
+         {
+            for (int c = 0; c < CHILDREN; ++c)
+               pool.submit([&]() { ++ran; });
+            ++ran;
+         });
+      pool.wait();
+      check(ran == PARENTS * (CHILDREN + 1), "wait covers tasks spawned by tasks");
+
+      //a throwing task hands its exception to its future and the
+      //workers carry on
+      future<void> thrown = pool.submit([]() { throw runtime_error("task"); });
+      bool caught = false;
+      try
+      {
+         thrown.get();
+      }
+      catch (const runtime_error&)
+      {
+         caught = true;
+      }
+      check(caught, "a task's exception reaches its future");
+      future<void> after = pool.submit([&]() { ++ran; });
+      after.get();
+      check(ran == PARENTS * (CHILDREN + 1) + 1, "the pool runs tasks after a throw");
+
+      //the destructor runs what is still queued
+      for (int t = 0; t < PARENTS; ++t)
+         pool.submit([&]() { ++ran; });
+   }
+   check(ran == PARENTS * (CHILDREN + 2) + 1, "the destructor runs queued tasks");
+
+   //SetBatchExecutor agrees with evaluating each job on its own
+   IntSet small = randomSet(50, 200, 5), other = randomSet(60, 200, 6);
+   IntSet big = randomSet(3000, 9000, 7), big2 = randomSet(3000, 9000, 8);
+   const SetOp ops[] = { SET_UNION, SET_INTERSECT, SET_SUBTRACT };
+   vector<SetJob> jobs;
+   for (int k = 0; k < 40; ++k)
+   {
+      SetJob job = { ops[k % 3], k % 4 == 0 ? &big : &small,
+                     k % 4 == 0 ? &big2 : &other };
+      jobs.push_back(job);
+   }
+   SetBatchExecutor batch(3);
+   vector<IntSet> results = batch.run(jobs);
+   vector< future<IntSet> > futures = batch.submit(jobs);
+   bool same = results.size() == jobs.size();
+   for (size_t k = 0; same && k < jobs.size(); ++k)
+   {
+      IntSet expect = SetBatchExecutor::evaluate(jobs[k]);
+      same = sameOrder(results[k], expect) && sameOrder(futures[k].get(), expect);
+   }
+   check(same, "SetBatchExecutor run and submit");
+   check(batch.run(vector<SetJob>()).empty(), "empty batch");
+   SetJob large = { SET_UNION, &big, &big2 }, tiny = { SET_UNION, &small, &other };
+   check(SetBatchExecutor::evaluate(large) == big.unionWith(big2)
+         && SetBatchExecutor::estimateCost(tiny) >= 1
+         && SetBatchExecutor::estimateCost(large) > SetBatchExecutor::estimateCost(tiny),
+         "estimateCost grows with the job");
+
+   //moving an IntSet takes its array over and leaves the source empty
+   IntSet moved(big);
+   IntSet taken(std::move(moved));
+   check(sameOrder(taken, big) && moved.isEmpty(), "move construction");
+   moved = std::move(taken);
+   check(sameOrder(moved, big), "move assignment");
+   return check.failed();
+}
+
+int checkSetSizes(ostream& out)
+{
+   Checker check(out);
+   //small, hashed and (for ascending inputs) merged kernels
+   const int sizes[] = { 0, 5, 300, 20000 };
+   bool counts = true, ratios = true;
+   for (int i = 0; i < 4; ++i)
+      for (int j = 0; j < 4; ++j)
+         for (int sorted = 0; sorted < 2; ++sorted)
+         {
+            IntSet a = randomSet(sizes[i], 3 * sizes[i] + 10, 10 + i);
+            IntSet b = randomSet(sizes[j], 3 * sizes[j] + 10, 20 + j);
+            if (sorted)
+            {
+               a = sortedCopy(a);
+               b = sortedCopy(b);
+            }
+            int common = a.intersect(b).size(), all = a.unionWith(b).size();
+            counts = counts && a.intersectionSize(b) == common
+                     && a.unionSize(b) == all
+                     && a.differenceSize(b) == a.subtract(b).size();
+            int smaller = min(a.size(), b.size());
+            ratios = ratios
+                     && a.jaccard(b) == (all == 0 ? 1.0 : double(common) / all)
+                     && a.overlapCoefficient(b)
+                        == (smaller == 0 ? 1.0 : double(common) / smaller);
+         }
+   check(counts, "intersectionSize, unionSize and differenceSize");
+   check(ratios, "jaccard and overlapCoefficient");
+
+   IntSet x = randomSet(100, 1000, 30);
+   check(x.jaccard(x) == 1.0 && x.overlapCoefficient(x.intersect(x)) == 1.0,
+         "a set compared with itself");
+   return check.failed();
+}
+
+int checkFingerprint(ostream& out)
+{
+   Checker check(out);
+   IntSet a = randomSet(500, 2000, 40), b = randomSet(700, 2000, 41);
+   bool kept = fingerprintHolds(a) && fingerprintHolds(b);
+   for (int v = 0; v < 2000; v += 7)
+      a.remove(v);
+   kept = kept && fingerprintHolds(a);
+   IntSet results[] = { a.unionWith(b), a.intersect(b), a.subtract(b),
+                        a.parallelUnionWith(b, 2),
+                        a.parallelIntersect(b, 2), a.parallelSubtract(b, 2),
+                        a.sortedUnionWith(b, 2), a.sortedIntersect(b, 2) };
+   for (size_t r = 0; r < sizeof results / sizeof results[0]; ++r)
+      kept = kept && fingerprintHolds(results[r]);
+   IntSet copy(a), assigned;
+   assigned = b;
+   IntSet moved(std::move(copy));
+   copy = std::move(assigned);
+   kept = kept && fingerprintHolds(moved) && fingerprintHolds(copy)
+          && fingerprintHolds(assigned);
+   copy.reset();
+   check(kept && copy.hash() == IntSet().hash(),
+         "the fingerprint follows every change");
+
+   //equal sets in different orders; unequal sets of the same size
+   IntSet forward, backward;
+   for (int v = 0; v < 100; ++v)
+   {
+      forward.add(v);
+      backward.add(99 - v);
+   }
+   check(forward == backward && forward.hash() == backward.hash()
+         && hash<IntSet>()(forward) == forward.hash(), "equal in any order");
+   IntSet other(forward);
+   other.remove(50);
+   other.add(100);
+   check(!(other == forward) && other.size() == forward.size(),
+         "unequal sets of the same size");
+   other.remove(100);
+   other.add(50);
+   check(other == forward && other.hash() == forward.hash(),
+         "equal again after undoing the changes");
+   return check.failed();
+}
+
+int checkMultiWay(ostream& out)
+{
+   Checker check(out);
+   const int K = 6;
+   IntSet sets[K];
+   const IntSet* pointers[K];
+   for (int k = 0; k < K; ++k)
+   {
+      //values below 400 are common to every set
+      sets[k] = randomSet(1000 + 300 * k, 5000, 50 + k);
+      for (int v = 0; v < 400; ++v)
+         sets[k].add(v);
+      pointers[k] = &sets[k];
+   }
+   IntSet chainedUnion = sets[0], chainedCommon = sets[0];
+   for (int k = 1; k < K; ++k)
+   {
+      chainedUnion = chainedUnion.unionWith(sets[k]);
+      chainedCommon = chainedCommon.intersect(sets[k]);
+   }
+   check(sameOrder(IntSet::unionAll(pointers, K), chainedUnion),
+         "unionAll matches chained unionWith, order included");
+   IntSet common = IntSet::intersectAll(pointers, K);
+   check(common == chainedCommon && common.size() >= 400,
+         "intersectAll matches chained intersect");
+   IntSet inSmallest = sets[0].intersect(chainedCommon);
+   check(sameOrder(common, inSmallest), "intersectAll keeps the smallest input's order");
+
+   IntSet empty;
+   const IntSet* withEmpty[] = { &sets[1], &empty, &sets[2] };
+   check(IntSet::intersectAll(withEmpty, 3).isEmpty(), "intersectAll with an empty input");
+   check(IntSet::unionAll(withEmpty, 3) == sets[1].unionWith(sets[2]),
+         "unionAll with an empty input");
+   check(IntSet::unionAll(pointers, 0).isEmpty()
+         && IntSet::intersectAll(pointers, 0).isEmpty(), "no inputs");
+   check(sameOrder(IntSet::unionAll(pointers, 1), sets[0])
+         && sameOrder(IntSet::intersectAll(pointers, 1), sets[0]), "one input");
+   return check.failed();
+}
+
+int checkSymmetricDifference(ostream& out)
+{
+   Checker check(out);
+   const int sizes[] = { 0, 5, 300, 20000 };
+   bool same = true, disjoint = true;
+   for (int i = 0; i < 4; ++i)
+      for (int j = 0; j < 4; ++j)
+         for (int sorted = 0; sorted < 2; ++sorted)
+         {
+            IntSet a = randomSet(sizes[i], 3 * sizes[i] + 10, 60 + i);
+            IntSet b = randomSet(sizes[j], 3 * sizes[j] + 10, 70 + j);
+            if (sorted)
+            {
+               a = sortedCopy(a);
+               b = sortedCopy(b);
+            }
+            same = same && sameOrder(a.symmetricDifference(b),
+                                     a.subtract(b).unionWith(b.subtract(a)));
+            disjoint = disjoint
+                       && a.isDisjoint(b) == a.intersect(b).isEmpty()
+                       && a.isDisjoint(b.subtract(a))
+                       && a.subtract(b).isDisjoint(b);
+         }
+   check(same, "symmetricDifference matches the two subtractions, order included");
+   check(disjoint, "isDisjoint");
+
+   IntSet a = randomSet(200, 1000, 80);
+   check(a.symmetricDifference(a).isEmpty()
+         && sameOrder(a.symmetricDifference(IntSet()), a),
+         "symmetricDifference with itself and with an empty set");
+   check(!a.isDisjoint(a) && a.isDisjoint(IntSet()),
+         "isDisjoint with itself and an empty set");
+   return check.failed();
+}
+
+int checkSetExpr(ostream& out)
+{
+   Checker check(out);
+   IntSet a = randomSet(300, 1000, 90), b = randomSet(400, 1000, 91);
+   IntSet c = randomSet(500, 1000, 92), d = randomSet(10, 1000, 93);
+   IntSet r = ((a | b) & c) - d;
+   check(r == a.unionWith(b).intersect(c).subtract(d), "((a | b) & c) - d");
+   r = (a ^ b) | (c - a);
+   check(sameOrder(r, a.symmetricDifference(b).unionWith(c.subtract(a))),
+         "(a ^ b) | (c - a), order included");
+   r = a | (b & (c - d));
+   check(r == a.unionWith(b.intersect(c.subtract(d))), "a | (b & (c - d))");
+
+   //the destination as an operand: the result is moved in
+   IntSet x(a);
+   x = x & b;
+   check(x == a.intersect(b), "x = x & b");
+   x = b - x;
+   check(x == b.subtract(a.intersect(b)), "x = b - x");
+   x = x | x;
+   check(x == b.subtract(a.intersect(b)), "x = x | x");
+
+   IntSet tracked(a);
+   tracked.trackChanges();
+   tracked = tracked - d;
+   check(tracked == a.subtract(d) && tracked.changes().cleared,
+         "assignment from an expression is tracked");
+   return check.failed();
+}
+
+int checkSetGraph(ostream& out)
+{
+   Checker check(out);
+   IntSet a = randomSet(3000, 9000, 100), b = randomSet(3000, 9000, 101);
+   IntSet c = randomSet(3000, 9000, 102);
+   SetGraph graph;
+   SetGraph::Node na = graph.leaf(a), nb = graph.leaf(b), nc = graph.leaf(c);
+   SetGraph::Node ab = graph.unite(na, nb);
+   check(graph.unite(nb, na) == ab && graph.leaf(a) == na
+         && graph.subtract(na, nb) != graph.subtract(nb, na),
+         "shared subexpressions are one node");
+   SetGraph::Node abc = graph.intersect(ab, nc);
+   SetGraph::Node rest = graph.subtract(nc, ab);
+   SetGraph::Node both = graph.symmetricDifference(abc, rest);
+   check(graph.numNodes() == 9, "numNodes");
+
+   IntSet expectAbc = a.unionWith(b).intersect(c);
+   IntSet expectRest = c.subtract(a.unionWith(b));
+   IntSet expectBoth = expectAbc.symmetricDifference(expectRest);
+   vector<SetGraph::Node> outputs{ abc, both, na, abc, rest };
+   bool same = true;
+   for (int call = 0; call < 3; ++call)
+   {
+      //repeated calls reuse the graph's pool
+      vector<IntSet> r = graph.evaluate(outputs, 1 + call % 2);
+      same = same && r.size() == 5 && r[0] == expectAbc && r[1] == expectBoth
+             && sameOrder(r[2], a) && r[3] == expectAbc && r[4] == expectRest;
+   }
+   check(same, "evaluate, with repeated and leaf outputs");
+
+   //several graphs on one caller-supplied pool at once
+   WorkStealingPool pool(3);
+   SetGraph copy(graph);
+   atomic<int> wrong(0);
+   vector<thread> callers;
+   for (int t = 0; t < 3; ++t)
+      callers.push_back(thread([&, t]()
+      {
+         vector<IntSet> r = (t == 0 ? graph : copy).evaluate(
+                               vector<SetGraph::Node>{ both, ab }, pool);
+         if (r.size() != 2 || !(r[0] == expectBoth) || !(r[1] == a.unionWith(b)))
+            ++wrong;
+      }));
+   for (size_t t = 0; t < callers.size(); ++t)
+      callers[t].join();
+   check(wrong == 0, "concurrent evaluate on a shared pool");
+   check(graph.evaluate(vector<SetGraph::Node>(), pool).empty(), "no outputs");
+   return check.failed();
+}
+
+int checkPlanner(ostream& out)
+{
+   Checker check(out);
+   const PlannerCosts& costs = plannerCosts();
+   check(costs.scanPair > 0 && costs.mergeElement > 0 && costs.gallopStep > 0
+         && costs.bitmapElement > 0 && costs.bitmapWord > 0
+         && costs.hashBuild > 0 && costs.hashProbe > 0, "calibrated costs are positive");
+
+   int lo = 0, hi = 0;
+   SetStats empty = { 0, 0, 0, true }, low = { 100, 0, 99, true };
+   SetStats high = { 100, 100, 199, true }, mid = { 100, 50, 149, false };
+   check(planCommon(empty, low, lo, hi) == ALGO_NONE
+         && planCommon(low, high, lo, hi) == ALGO_NONE,
+         "nothing to do for an empty input or disjoint ranges");
+   SetAlgorithm algo = planCommon(low, mid, lo, hi);
+   check(algo != ALGO_NONE && algo != ALGO_MERGE && algo != ALGO_GALLOP
+         && lo == 50 && hi == 99, "overlap, and no merge for unordered input");
+   SetStats wide = { 1000, -2000000000, 2000000000, false };
+   check(planCommon(wide, wide, lo, hi) != ALGO_BITMAP, "no bitmap over a huge span");
+
+   //whatever kernel is picked, the results agree with std::set
+   struct Shape { int na, nb, range; bool sorted; };
+   const Shape shapes[] = { { 3, 4, 10, false }, { 2000, 2000, 3000, false },
+                            { 2000, 2000, 3000, true }, { 5, 50000, 200000, true },
+                            { 3000, 3000, 1 << 30, false } };
+   bool same = true;
+   for (size_t k = 0; k < sizeof shapes / sizeof shapes[0]; ++k)
+   {
+      IntSet a = randomSet(shapes[k].na, shapes[k].range, 110 + unsigned(k));
+      IntSet b = randomSet(shapes[k].nb, shapes[k].range, 120 + unsigned(k));
+      if (shapes[k].sorted)
+      {
+         a = sortedCopy(a);
+         b = sortedCopy(b);
+      }
+      vector<int> valuesA = elementsOf(a), valuesB = elementsOf(b);
+      set<int> inB(valuesB.begin(), valuesB.end());
+      vector<int> common, only;
+      for (size_t i = 0; i < valuesA.size(); ++i)
+         (inB.count(valuesA[i]) ? common : only).push_back(valuesA[i]);
+      same = same && holds(a.intersect(b), common) && holds(a.subtract(b), only)
+             && a.intersectionSize(b) == int(common.size())
+             && a.isSubsetOf(b) == only.empty();
+   }
+   check(same, "operations agree with std::set for every kernel");
+   return check.failed();
+}
+
+int checkIntoOperations(ostream& out)
+{
+   Checker check(out);
+   IntSet a = randomSet(2000, 6000, 130), b = randomSet(2500, 6000, 131);
+   IntSet result;
+   a.unionInto(b, result);
+   bool same = sameOrder(result, a.unionWith(b));
+   a.intersectInto(b, result);
+   same = same && sameOrder(result, a.intersect(b));
+   a.subtractInto(b, result);
+   same = same && sameOrder(result, a.subtract(b));
+   check(same, "xxxInto match the returning operations, order included");
+
+   //the output may be either input
+   bool aliased = true;
+   for (int op = 0; op < 3; ++op)
+      for (int target = 0; target < 2; ++target)
+      {
+         IntSet x(a), y(b);
+         IntSet& into = target == 0 ? x : y;
+         if (op == 0)
+            x.unionInto(y, into);
+         else if (op == 1)
+            x.intersectInto(y, into);
+         else
+            x.subtractInto(y, into);
+         IntSet expect = op == 0 ? a.unionWith(b)
+                         : op == 1 ? a.intersect(b) : a.subtract(b);
+         aliased = aliased && sameOrder(into, expect)
+                   && sameOrder(target == 0 ? y : x, target == 0 ? b : a);
+      }
+   check(aliased, "output is one of the inputs");
+
+   //once big enough, the output keeps its array
+   randomSet(5000, 6000, 139).unionInto(b, result);
+   const int* array = &*result.begin();
+   bool kept = true;
+   for (unsigned seed = 0; seed < 5; ++seed)
+   {
+      IntSet c = randomSet(2000, 6000, 140 + seed);
+      c.intersectInto(b, result);
+      c.subtractInto(b, result);
+      c.unionInto(b, result);
+      kept = kept && &*result.begin() == array && result == c.unionWith(b);
+   }
+   check(kept, "the output's array is reused");
+
+   IntSet x(a), y(b);
+   x.swap(y);
+   check(sameOrder(x, b) && sameOrder(y, a) && x.hash() == b.hash()
+         && y.hash() == a.hash(), "swap exchanges contents");
+   return check.failed();
+}
+
+int checkElementAccess(ostream& out)
+{
+   Checker check(out);
+   IntSet a;
+   vector<int> inserted;
+   for (int v = 50; v > -50; v -= 3)
+   {
+      a.add(v);
+      inserted.push_back(v);
+   }
+   a.remove(50);
+   inserted.erase(inserted.begin());
+   check(holds(a, inserted) && a.end() - a.begin() == a.size(),
+         "begin and end give the elements in insertion order");
+
+   IntSet::View view = a.view();
+   bool viewOk = view.size() == a.size() && !view.empty()
+                 && view.data() == a.begin() && view.begin() == a.begin()
+                 && view.end() == a.end();
+   for (int i = 0; viewOk && i < view.size(); ++i)
+      viewOk = view[i] == inserted[i];
+   check(viewOk && IntSet().view().empty(), "view");
+
+   vector<int> visited;
+   a.forEach([&](int x) { visited.push_back(x); });
+   check(visited == inserted, "forEach visits in insertion order");
+   check(*max_element(a.begin(), a.end()) == 47
+         && count_if(a.begin(), a.end(), [](int x) { return x < 0; }) == 17,
+         "STL algorithms on the iterators");
+   return check.failed();
+}
+
+int checkBufferAdoption(ostream& out)
+{
+   Checker check(out);
+   const int N = 1000, CAPACITY = 1500;
+   unique_ptr<int[]> buffer(new int[CAPACITY]);
+   for (int i = 0; i < N; ++i)
+      buffer[i] = 3 * (N - i);
+   const int* array = buffer.get();
+   IntSet adopted = IntSet::adopt(std::move(buffer), N, CAPACITY);
+   IntSet expect;
+   for (int i = 0; i < N; ++i)
+      expect.add(3 * (N - i));
+   check(adopted.begin() == array && sameOrder(adopted, expect)
+         && adopted.hash() == expect.hash(), "adopt takes the buffer over");
+
+   //statistics are set up: operations agree with the built set
+   IntSet other = randomSet(500, 3 * N, 150);
+   check(sameOrder(adopted.intersect(other), expect.intersect(other))
+         && adopted.contains(3) && !adopted.contains(4), "operations on an adopted set");
+   adopted.add(1);
+   check(adopted.size() == N + 1 && adopted.begin() == array,
+         "an adopted set grows into its spare capacity");
+
+   int size = 0, capacity = 0;
+   unique_ptr<int[]> back = adopted.release(size, capacity);
+   check(back.get() == array && size == N + 1 && capacity == CAPACITY
+         && adopted.isEmpty(), "release hands the array back");
+   adopted.add(7);
+   check(holds(adopted, vector<int>{7}), "a released set is usable");
+   check(IntSet::adopt(unique_ptr<int[]>(), 0, 0).isEmpty(), "adopting nothing");
+
+   vector<int> values(expect.begin(), expect.end());
+   IntSet ranged = IntSet::fromUniqueRange(values.begin(), values.end());
+   check(sameOrder(ranged, expect) && ranged.hash() == expect.hash(),
+         "fromUniqueRange");
+   return check.failed();
+}
+
+int checkIntSetFile(ostream& out)
+{
+   Checker check(out);
+   IntSet a = randomSet(5000, 100000, 160), ascending = sortedCopy(a);
+   bool roundTrip = true;
+   const IntSet* sets[] = { &a, &ascending };
+   for (int k = 0; k < 2; ++k)
+      for (unsigned flags = 0; flags <= INTSET_FILE_CHECKSUM; ++flags)
+      {
+         IntSet loaded;
+         string bytes = savedBytes(*sets[k], flags);
+         bool flagged = (headerOf(bytes).flags & INTSET_FILE_ASCENDING) != 0;
+         roundTrip = roundTrip && loadAllWays(bytes, loaded) == LOADED_ALL
+                     && sameOrder(loaded, *sets[k]) && flagged == (k == 1);
+      }
+   IntSet empty;
+   string none = savedBytes(IntSet(), INTSET_FILE_CHECKSUM);
+   roundTrip = roundTrip && loadAllWays(none, empty) == LOADED_ALL && empty.isEmpty();
+   check(roundTrip, "raw files load back in stored order");
+
+   ScratchDir scratch;
+   check(scratch.ok(), "scratch directory");
+   string path = scratch.path("a.iset");
+   IntSet fromFile;
+   MappedIntSet mapped;
+   check(saveIntSet(a, path.c_str()) && loadIntSet(path.c_str(), fromFile)
+         && sameOrder(fromFile, a), "saving to and loading from a path");
+   bool mappedOk = mapped.open(path.c_str(), true) && mapped.size() == a.size()
+                   && equal(a.begin(), a.end(), mapped.begin());
+   for (int v = 0; mappedOk && v < 100000; v += 97)
+      mappedOk = mapped.contains(v) == a.contains(v);
+   check(mappedOk, "MappedIntSet reads the file in place");
+   check(!loadIntSet(scratch.path("missing").c_str(), fromFile)
+         && !mapped.open(scratch.path("missing").c_str()) && !mapped.isOpen(),
+         "missing file");
+
+   //damaged files are refused by every reader and leave the set alone
+   IntSet kept = randomSet(10, 100, 161);
+   string good = savedBytes(a, INTSET_FILE_CHECKSUM);
+   bool refused = true;
+   const size_t HEADER = sizeof(IntSetFileHeader);
+   const size_t cuts[] = { 0, 10, HEADER - 1, HEADER, good.size() / 2, good.size() - 1 };
+   for (size_t k = 0; k < sizeof cuts / sizeof cuts[0]; ++k)
+      refused = refused && loadAllWays(good.substr(0, cuts[k]), kept) == REFUSED_ALL;
+   check(refused, "truncated files");
+
+   IntSetFileHeader h = headerOf(good);
+   string bad = good;
+   bad[0] = 'X';
+   refused = loadAllWays(bad, kept) == REFUSED_ALL;
+   for (int field = 0; field < 3; ++field)
+   {
+      IntSetFileHeader changed = h;
+      if (field == 0)
+         changed.byteOrder = 0x04030201u;
+      else if (field == 1)
+         changed.version = INTSET_FILE_VERSION + 1;
+      else
+         changed.flags |= 0x100;
+      bad = good;
+      setHeader(bad, changed);
+      refused = refused && loadAllWays(bad, kept) == REFUSED_ALL;
+   }
+   check(refused, "unknown magic, byte order, version or flags");
+
+   bad = good;
+   bad[bad.size() - 3] ^= 0x10;
+   check(loadAllWays(bad, kept) == REFUSED_ALL, "checksum mismatch");
+
+   //sizes far beyond the data fail without a huge allocation, through
+   //a stream that can tell its length and one that cannot
+   IntSetFileHeader huge = headerOf(savedBytes(a, 0));
+   huge.count = uint32_t(INT32_MAX);
+   huge.payloadBytes = uint64_t(INT32_MAX) * sizeof(int32_t);
+   bad = savedBytes(a, 0);
+   setHeader(bad, huge);
+   check(loadAllWays(bad, kept) == REFUSED_ALL, "a count far beyond the data");
+
+   //a checksum only proves the bytes are the ones written: a payload
+   //that breaks the format is refused anyway
+   bad = good;
+   setElement(bad, 1, a.begin()[0]);
+   resum(bad);
+   bool inconsistent = loadAllWays(bad, kept) == REFUSED_ALL;
+   bad = savedBytes(a, 0);
+   setElement(bad, 2, a.begin()[3]);
+   inconsistent = inconsistent && loadAllWays(bad, kept) == REFUSED_ALL;
+   check(inconsistent, "duplicate elements, with and without a checksum");
+   {
+      ofstream file(path.c_str(), ios::binary | ios::trunc);
+      file << bad;
+   }
+   check(mapped.open(path.c_str()) && mapped.size() == a.size()
+         && mapped.toIntSet().isEmpty(), "toIntSet of a mapping with duplicates");
+   mapped.close();
+
+   bad = savedBytes(ascending, INTSET_FILE_CHECKSUM);
+   setElement(bad, 0, ascending.begin()[1]);
+   setElement(bad, 1, ascending.begin()[0]);
+   resum(bad);
+   inconsistent = loadAllWays(bad, kept) == REFUSED_ALL;
+   bad = good;
+   IntSetFileHeader range = h;
+   range.maxValue += 1;
+   setHeader(bad, range);
+   inconsistent = inconsistent && loadAllWays(bad, kept) == REFUSED_ALL;
+   check(inconsistent, "a false ascending flag or value range");
+   return check.failed();
+}
+
+int checkStoredIndex(ostream& out)
+{
+   Checker check(out);
+   ScratchDir scratch;
+   if (!scratch.ok())
+   {
+      check(false, "scratch directory");
+      return check.failed();
+   }
+   string path = scratch.path("indexed.iset");
+   const unsigned INDEXED = INTSET_FILE_CHECKSUM | INTSET_FILE_INDEXED;
+   MappedIntSet mapped;
+
+   //an odd and an even count (with and without padding), and none
+   bool served = true;
+   const int counts[] = { 999, 1000, 0 };
+   for (int k = 0; k < 3; ++k)
+   {
+      IntSet set = randomSet(counts[k], 50000, 170 + k), loaded;
+      string bytes = savedBytes(set, INDEXED);
+      served = served && loadAllWays(bytes, loaded) == LOADED_ALL
+               && sameOrder(loaded, set);
+      writeFile(path, bytes);
+      for (int verify = 0; verify < 2; ++verify)
+      {
+         served = served && mapped.open(path.c_str(), verify == 1)
+                  && mapped.isIndexed() && mapped.size() == set.size()
+                  && equal(set.begin(), set.end(), mapped.begin());
+         for (int v = -10; served && v < 50010; v += 7)
+            served = mapped.contains(v) == set.contains(v);
+         for (int i = 0; served && i < set.size(); ++i)
+            served = mapped.contains(set.begin()[i]);
+      }
+   }
+   check(served, "indexed files load and are probed in place");
+
+   IntSet a = randomSet(999, 50000, 173);
+   check(!(headerOf(savedBytes(a, INDEXED | INTSET_FILE_PACKED)).flags
+           & INTSET_FILE_INDEXED), "a packed file has no index");
+   writeFile(path, savedBytes(a, INTSET_FILE_CHECKSUM));
+   check(mapped.open(path.c_str()) && !mapped.isIndexed()
+         && mapped.contains(a.begin()[5]), "a file without an index is scanned");
+
+   //the words of the index of a's file: padding, slotCount, zero, slots
+   const string good = savedBytes(a, INDEXED);
+   const size_t INDEX = sizeof(IntSetFileHeader) + ((999 * 4 + 7) & ~size_t(7));
+   uint32_t slotCount;
+   memcpy(&slotCount, &good[INDEX], sizeof slotCount);
+   check(slotCount >= 2 * 999 && (slotCount & (slotCount - 1)) == 0
+         && headerOf(good).payloadBytes == INDEX - sizeof(IntSetFileHeader)
+                                           + (2 + slotCount) * 4,
+         "index layout");
+   auto setWord = [](string& bytes, size_t at, uint32_t value)
+   {
+      memcpy(&bytes[at], &value, sizeof value);
+   };
+
+   //a bad layout is refused by every reader, checksum or not
+   IntSet kept = randomSet(10, 100, 174);
+   bool refused = true;
+   const uint32_t badCounts[] = { 0, slotCount - 1, slotCount / 2, slotCount * 2 };
+   for (int k = 0; k < 5; ++k)
+   {
+      string bad = good;
+      if (k < 4)
+         setWord(bad, INDEX, badCounts[k]);
+      else
+         setWord(bad, INDEX + 4, 1);
+      resum(bad);
+      writeFile(path, bad);
+      refused = refused && loadAllWays(bad, kept) == REFUSED_ALL
+                && !mapped.open(path.c_str()) && !mapped.isOpen()
+                && !mapped.open(path.c_str(), true);
+   }
+   check(refused, "a bad slotCount or a nonzero word after it");
+   string bad = good.substr(0, good.size() - 4);
+   IntSetFileHeader h = headerOf(bad);
+   h.payloadBytes -= 4;
+   setHeader(bad, h);
+   resum(bad);
+   writeFile(path, bad);
+   check(loadAllWays(bad, kept) == REFUSED_ALL && !mapped.open(path.c_str()),
+         "a table shorter than slotCount");
+   bad = good;
+   h = headerOf(bad);
+   h.flags &= ~unsigned(INTSET_FILE_INDEXED);
+   setHeader(bad, h);
+   check(loadAllWays(bad, kept) == REFUSED_ALL, "an index without the flag");
+
+   //damaged slots: the checksum catches them; without verify a lookup
+   //may go wrong but ends, and stays inside the mapping
+   const size_t SLOTS = INDEX + 8;
+   bool bounded = true;
+   for (int k = 0; k < 3; ++k)
+   {
+      bad = good;
+      uint32_t fill = k == 0 ? 0 : k == 1 ? 1 : 999 + 5;
+      for (uint32_t j = 0; j < slotCount; ++j)
+         setWord(bad, SLOTS + 4 * j, fill);
+      writeFile(path, bad);
+      bounded = bounded && loadAllWays(bad, kept) == REFUSED_ALL
+                && !mapped.open(path.c_str(), true) && mapped.open(path.c_str())
+                && mapped.isIndexed();
+      for (int i = 1; bounded && i < a.size(); i += 37)
+         bounded = !mapped.contains(a.begin()[i]);
+      bounded = bounded && mapped.contains(a.begin()[0]) == (k == 1);
+   }
+   check(bounded, "empty, full and out-of-range slots");
+   return check.failed();
+}
+
+int checkPackedInts(ostream& out)
+{
+   Checker check(out);
+   //three blocks (the last one short), small gaps and one large one
+   vector<int> values;
+   for (int i = 0; i < 300; ++i)
+      values.push_back(-1000 + 5 * i + (i >= 200 ? 1 << 30 : 0));
+   IntSet set;
+   set.addAll(&values[0], int(values.size()));
+   CompressedIntSet packed(set);
+   bool same = packed.size() == 300 && holds(packed.toIntSet(), values);
+   for (int v = -1100; same && v < 600; ++v)
+      same = packed.contains(v) == set.contains(v);
+   vector<int> visited;
+   packed.forEach([&](int x) { visited.push_back(x); });
+   check(same && visited == values && packed.contains(values[250]),
+         "CompressedIntSet holds the elements in ascending order");
+   check(CompressedIntSet(IntSet()).isEmpty()
+         && CompressedIntSet(IntSet()).toIntSet().isEmpty(), "empty CompressedIntSet");
+
+   vector<uint32_t> words;
+   packSortedInts(&values[0], 300, words);
+   CompressedIntSet copy;
+   check(copy.assignEncoded(&words[0], words.size(), 300)
+         && sameOrder(copy.toIntSet(), packed.toIntSet()), "assignEncoded");
+
+   //damaged encodings: each is refused and leaves the set alone
+   const int BLOCKS = 3, HEAD = 1 + 2 * BLOCKS;
+   bool refused = true;
+   for (int damage = 0; damage < 7; ++damage)
+   {
+      vector<uint32_t> bad = words;
+      size_t numWords = bad.size();
+      int n = 300;
+      if (damage == 0)
+         bad[HEAD + bad[2]] = 0;                   // block 0: every gap 0
+      else if (damage == 1)
+         bad[1 + 2 * 2] = uint32_t(INT_MAX - 5);   // block 2 runs past INT_MAX
+      else if (damage == 2)
+         bad[1 + 2 * 1] = bad[1];                  // block 1 starts too low
+      else if (damage == 3)
+         bad[HEAD + bad[4]] = 33;                  // bit width too large
+      else if (damage == 4)
+         bad[6] = uint32_t(bad.size());            // offset past the end
+      else if (damage == 5)
+         --numWords;                               // truncated
+      else
+         n = 301;                                  // wrong count
+      refused = refused && !copy.assignEncoded(&bad[0], numWords, n);
+   }
+   check(refused && sameOrder(copy.toIntSet(), packed.toIntSet()),
+         "damaged encodings are refused");
+
+   //packed files: round trip, and a damaged payload with a matching
+   //checksum is refused by every reader
+   string bytes = savedBytes(set, INTSET_FILE_CHECKSUM | INTSET_FILE_PACKED);
+   IntSet loaded;
+   istringstream in(bytes);
+   CompressedIntSet loadedPacked;
+   check(loadAllWays(bytes, loaded) == LOADED_ALL && holds(loaded, values)
+         && loadCompressedIntSet(in, loadedPacked)
+         && loadedPacked.encoded() == words, "packed files load back");
+   string bad = bytes;
+   setElement(bad, HEAD + int(words[2]), 0);
+   resum(bad);
+   istringstream badIn(bad);
+   check(loadAllWays(bad, loaded) == REFUSED_ALL && holds(loaded, values)
+         && !loadCompressedIntSet(badIn, loadedPacked),
+         "a packed file whose gaps are 0 is refused");
+   return check.failed();
+}
+
+int checkDump(ostream& out)
+{
+   Checker check(out);
+   const int edges[] = { 0, -1, 1, 9, 10, -10, 99, 100, 12345, -99999,
+                         1000000000, INT_MAX, INT_MIN, INT_MIN + 1 };
+   bool formatted = true;
+   for (size_t k = 0; k < sizeof edges / sizeof edges[0]; ++k)
+   {
+      char buffer[MAX_INT_CHARS];
+      char* end = formatInt(edges[k], buffer);
+      ostringstream expect;
+      expect << edges[k];
+      formatted = formatted && string(buffer, end) == expect.str();
+   }
+   check(formatted, "formatInt at the edges of each digit count");
+
+   //big enough for several chunks, and every width of int
+   IntSet big = randomSet(50000, INT_MAX, 170);
+   big.add(INT_MIN);
+   big.add(0);
+   IntSet single, none;
+   single.add(-7);
+   ScratchDir scratch;
+   bool same = true;
+   const IntSet* cases[] = { &big, &single, &none };
+   for (int k = 0; k < 3; ++k)
+   {
+      ostringstream expect, viaStream;
+      cases[k]->DumpData(expect);
+      same = same && dumpIntSet(*cases[k], viaStream)
+             && viaStream.str() == expect.str();
+
+      string path = scratch.path("dump.txt");
+      FILE* file = fopen(path.c_str(), "wb");
+      same = same && file && dumpIntSet(*cases[k], file);
+      if (file)
+         fclose(file);
+      same = same && fileContents(path) == expect.str();
+
+      int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+      same = same && fd >= 0 && dumpIntSet(*cases[k], fd);
+      if (fd >= 0)
+         close(fd);
+      same = same && fileContents(path) == expect.str();
+   }
+   check(same, "dumpIntSet writes what DumpData writes");
+   check(!dumpIntSet(big, -1), "a failed write is reported");
+   return check.failed();
+}
+
+int checkTextLoader(ostream& out)
+{
+   Checker check(out);
+   struct Case { const char* text; bool ok; size_t offset; };
+   const Case cases[] =
+   {
+      { "", true, 0 },
+      { " \t\n\v\f\r", true, 0 },
+      { "1  -2\n+3\t\r\n007", true, 0 },
+      { "-2147483648 2147483647", true, 0 },
+      { "5 2147483648", false, 2 },
+      { "-2147483649", false, 0 },
+      { "99999999999999999999", false, 0 },
+      { "12 3x", false, 4 },
+      { "12 - 3", false, 4 },
+      { "--1", false, 1 },
+      { "+", false, 1 },
+      { "1,2", false, 1 }
+   };
+   bool parsed = true;
+   for (size_t k = 0; k < sizeof cases / sizeof cases[0]; ++k)
+   {
+      vector<int> values;
+      TextParseError error = { 0, 0 };
+      bool ok = parseInts(cases[k].text, strlen(cases[k].text), values, error);
+      parsed = parsed && ok == cases[k].ok
+               && (ok || (error.offset == cases[k].offset && error.reason != 0));
+   }
+   vector<int> values;
+   TextParseError error;
+   const char* text = "1  -2\n+3\t\r\n007 -2147483648";
+   parsed = parsed && parseInts(text, strlen(text), values, error)
+            && values == vector<int>({ 1, -2, 3, 7, INT_MIN });
+   check(parsed, "parseInts follows the grammar and reports where it fails");
+
+   //loading: first occurrences in order; a failed load changes nothing
+   IntSet set;
+   set.add(3);
+   istringstream good("5 3 9 5 -1"), bad("8 9 oops");
+   vector<int> expect{ 3, 5, 9, -1 };
+   check(loadIntSetText(good, set, error) && holds(set, expect),
+         "loadIntSetText from a stream");
+   check(!loadIntSetText(bad, set, error) && error.offset == 4 && holds(set, expect),
+         "a failed load leaves the set alone");
+
+   //addAll of the set's own elements, which a resize would free
+   IntSet own = randomSet(3000, 9000, 179), ownCopy(own);
+   check(own.addAll(own.begin(), own.size()) == 0 && sameOrder(own, ownCopy),
+         "addAll from the set's own array");
+
+   //a file (mapped) and the same text through a stream, round trip
+   //through DumpData included
+   ScratchDir scratch;
+   IntSet big = randomSet(40000, INT_MAX, 180), fromFile, fromStream;
+   string path = scratch.path("set.txt");
+   {
+      ofstream file(path.c_str());
+      big.DumpData(file);
+   }
+   ifstream stream(path.c_str());
+   check(loadIntSetText(path.c_str(), fromFile, error) && sameOrder(fromFile, big)
+         && loadIntSetText(stream, fromStream, error) && sameOrder(fromStream, big),
+         "DumpData output loads back from a file and a stream");
+   IntSet empty;
+   check(!loadIntSetText(scratch.path("missing").c_str(), empty, error)
+         && empty.isEmpty() && error.reason != 0, "a missing file");
+   return check.failed();
+}
+
+int checkParallelText(ostream& out)
+{
+   Checker check(out);
+   //more than one piece of each kind, with a few duplicates
+   IntSet big = randomSet(400000, INT_MAX, 190);
+   ostringstream expect;
+   big.DumpData(expect);
+   string prefix = expect.str().substr(0, expect.str().find(' ', 1000));
+   string text = expect.str() + "  " + prefix + " ";
+   check(text.size() > PARALLEL_TEXT_BYTES
+         && big.size() > 2 * PARALLEL_DUMP_ELEMENTS, "input spans several pieces");
+
+   ScratchDir scratch;
+   string path = scratch.path("dump.txt");
+   bool dumped = true;
+   for (int threads = 1; threads <= 4; threads += 3)
+   {
+      ostringstream viaStream;
+      dumped = dumped && parallelDumpIntSet(big, viaStream, threads)
+               && viaStream.str() == expect.str();
+      FILE* file = fopen(path.c_str(), "wb");
+      dumped = dumped && file && parallelDumpIntSet(big, file, threads);
+      if (file)
+         fclose(file);
+      dumped = dumped && fileContents(path) == expect.str();
+      int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+      dumped = dumped && fd >= 0 && parallelDumpIntSet(big, fd, threads);
+      if (fd >= 0)
+         close(fd);
+      dumped = dumped && fileContents(path) == expect.str();
+   }
+   check(dumped, "parallelDumpIntSet writes what DumpData writes");
+
+   vector<int> serial, parallel;
+   TextParseError error, parallelError;
+   bool parsed = parseInts(text.data(), text.size(), serial, error);
+   for (int threads = 1; threads <= 4; threads += 3)
+   {
+      parallel.clear();
+      parsed = parsed && parallelParseInts(text.data(), text.size(), parallel,
+                                           parallelError, threads)
+               && parallel == serial;
+   }
+   check(parsed && int(serial.size()) > big.size(),
+         "parallelParseInts matches parseInts");
+
+   //errors in two pieces: the first one in the text is reported
+   string bad = text;
+   bad[bad.size() - 5] = 'x';
+   bad[PARALLEL_TEXT_BYTES + 10] = ',';
+   parseInts(bad.data(), bad.size(), serial, error);
+   bool reported = true;
+   for (int threads = 1; threads <= 4; threads += 3)
+      reported = reported
+                 && !parallelParseInts(bad.data(), bad.size(), parallel,
+                                       parallelError, threads)
+                 && parallelError.offset == error.offset
+                 && string(parallelError.reason) == error.reason;
+   check(reported, "parallelParseInts reports the first error");
+
+   {
+      ofstream file(path.c_str());
+      file << text;
+   }
+   IntSet loaded, untouched = randomSet(5, 10, 191), kept(untouched);
+   check(parallelLoadIntSetText(path.c_str(), loaded, error, 4)
+         && sameOrder(loaded, big), "parallelLoadIntSetText");
+   {
+      ofstream file(path.c_str());
+      file << bad;
+   }
+   check(!parallelLoadIntSetText(path.c_str(), kept, parallelError, 4)
+         && parallelError.offset == error.offset && sameOrder(kept, untouched),
+         "a failed parallel load leaves the set alone");
+   return check.failed();
+}
+
+int checkDurableIntSet(ostream& out)
+{
+   Checker check(out);
+   ScratchDir scratch;
+   if (!scratch.ok())
+   {
+      check(false, "scratch directory");
+      return check.failed();
+   }
+   const size_t HEADER = 32, RECORD = 8;
+   string base = scratch.path("set"), crash = scratch.path("crash");
+   DurableOptions options;
+   options.checkpointRecords = 0;
+   IntSet recovered;
+   long long records = -1;
+
+   DurableIntSet durable;
+   check(durable.open(base.c_str(), options) && durable.isOpen()
+         && durable.isEmpty() && durable.logRecords() == 0
+         && fileContents(base + ".wal").size() == HEADER,
+         "open creates an empty log");
+   durable.add(10);
+   durable.add(20);
+   durable.add(30);
+   durable.remove(20);
+   durable.add(40);
+   check(!durable.add(10) && !durable.remove(20) && durable.logRecords() == 5,
+         "only changes are logged");
+   check(holds(durable.toIntSet(), vector<int>{10, 30, 40}) && durable.contains(40)
+         && !durable.contains(20) && !durable.failed(), "changes apply");
+
+   //a crash leaves the files as they are while the set is open
+   crashImage(base, crash);
+   check(recover(crash, recovered, &records)
+         && holds(recovered, vector<int>{10, 30, 40}) && records == 5,
+         "the log is replayed after a crash");
+
+   string wal = fileContents(base + ".wal");
+   crashImage(base, crash);
+   writeFile(crash + ".wal", wal + wal.substr(HEADER, 3));
+   check(recover(crash, recovered, &records)
+         && holds(recovered, vector<int>{10, 30, 40}) && records == 5
+         && fileContents(crash + ".wal") == wal, "a torn record is cut off");
+   writeFile(crash + ".wal", wal + string(RECORD, '\0'));
+   check(recover(crash, recovered) && holds(recovered, vector<int>{10, 30, 40})
+         && fileContents(crash + ".wal") == wal, "a zero-filled record is cut off");
+   string damaged = wal;
+   damaged[HEADER + 2 * RECORD] ^= 1;
+   writeFile(crash + ".wal", damaged);
+   check(recover(crash, recovered, &records)
+         && holds(recovered, vector<int>{10, 20}) && records == 2
+         && fileContents(crash + ".wal") == wal.substr(0, HEADER + 2 * RECORD),
+         "replay stops at a damaged record");
+
+   durable.reset();
+   durable.add(7);
+   crashImage(base, crash);
+   check(recover(crash, recovered) && holds(recovered, vector<int>{7}),
+         "reset is logged");
+
+   //a log from before the snapshot is not replayed on top of it
+   string before = scratch.path("before");
+   crashImage(base, before);
+   check(durable.checkpoint() && durable.logRecords() == 0
+         && fileContents(base + ".wal").size() == HEADER
+         && loadIntSet((base + ".snap").c_str(), recovered)
+         && holds(recovered, vector<int>{7}), "checkpoint");
+   durable.add(8);
+   crashImage(base, crash);
+   check(recover(crash, recovered, &records) && holds(recovered, vector<int>{7, 8})
+         && records == 1, "the snapshot and the log after it are recovered");
+   writeFile(crash + ".wal", fileContents(before + ".wal"));
+   check(recover(crash, recovered, &records) && holds(recovered, vector<int>{7})
+         && records == 0, "a log from before the snapshot is ignored");
+   crashImage(base, crash);
+   unlink((crash + ".wal").c_str());
+   check(recover(crash, recovered) && holds(recovered, vector<int>{7}),
+         "a snapshot without a log");
+
+   string snap = fileContents(base + ".snap");
+   snap[snap.size() - 1] ^= 1;
+   writeFile(crash + ".snap", snap);
+   DurableIntSet refused;
+   check(!refused.open(crash.c_str(), options) && !refused.isOpen(),
+         "a damaged snapshot is refused");
+
+   //group commit: every change acknowledged is on disk
+   const int THREADS = 4, PER_THREAD = 250;
+   vector<thread> writers;
+   for (int t = 0; t < THREADS; ++t)
+      writers.push_back(thread([&durable, t]()
+      {
+         for (int i = 0; i < PER_THREAD; ++i)
+            durable.add(1000 + t * PER_THREAD + i);
+      }));
+   for (size_t t = 0; t < writers.size(); ++t)
+      writers[t].join();
+   IntSet expect = durable.toIntSet();
+   crashImage(base, crash);
+   check(expect.size() == 2 + THREADS * PER_THREAD && recover(crash, recovered)
+         && sameOrder(recovered, expect), "concurrent changes are all logged");
+
+   durable.close();
+   check(!durable.isOpen() && durable.isEmpty(), "close");
+   check(recover(base, recovered) && sameOrder(recovered, expect),
+         "reopen after close");
+
+   //without WAL_SYNC_ALWAYS changes reach the log by sync()
+   options.syncMode = WAL_SYNC_NONE;
+   check(durable.open(base.c_str(), options) && durable.add(5) && durable.sync(),
+         "sync");
+   crashImage(base, crash);
+   check(recover(crash, recovered) && recovered.contains(5), "sync writes the log");
+   durable.close();
+
+   //the maintenance thread checkpoints a long log
+   options.syncMode = WAL_SYNC_PERIODIC;
+   options.syncIntervalMs = 1;
+   options.checkpointRecords = 100;
+   options.backgroundCheckpoints = false;
+   check(durable.open(base.c_str(), options), "open with a maintenance thread");
+   for (int i = 0; i < 150; ++i)
+      durable.add(5000 + i);
+   for (int wait = 0; wait < 2000 && durable.logRecords() >= 100; ++wait)
+      this_thread::sleep_for(chrono::milliseconds(1));
+   expect = durable.toIntSet();
+   check(durable.logRecords() < 100, "the maintenance thread checkpoints");
+   durable.close();
+   check(recover(base, recovered) && sameOrder(recovered, expect),
+         "recovery after maintenance checkpoints");
+   return check.failed();
+}
+
+int checkBackgroundCheckpoint(ostream& out)
+{
+   Checker check(out);
+   ScratchDir scratch;
+   if (!scratch.ok())
+   {
+      check(false, "scratch directory");
+      return check.failed();
+   }
+   string base = scratch.path("set"), crash = scratch.path("crash");
+   string before = scratch.path("before");
+   DurableOptions options;
+   options.checkpointRecords = 0;
+   IntSet recovered, atFork;
+   long long records = -1;
+
+   DurableIntSet durable;
+   check(durable.open(base.c_str(), options), "open");
+   const int N = 1000, AFTER = 100;
+   for (int i = 0; i < N; ++i)
+      durable.add(i);
+   atFork = durable.toIntSet();
+   crashImage(base, before);
+
+   //nothing reaps the child until it is waited for
+   check(durable.startBackgroundCheckpoint() && !durable.startBackgroundCheckpoint(),
+         "one background checkpoint at a time");
+   for (int i = 0; i < AFTER; ++i)
+      durable.add(N + i);
+   durable.remove(0);
+   IntSet expect = durable.toIntSet();
+   check(durable.waitForCheckpoint(), "waitForCheckpoint");
+   CheckpointProgress progress = durable.checkpointProgress();
+   check(!progress.running && progress.succeeded
+         && progress.bytesTotal == N * (long long)sizeof(int32_t)
+         && progress.bytesWritten == progress.bytesTotal, "progress");
+   check(loadIntSet((base + ".snap").c_str(), recovered)
+         && sameOrder(recovered, atFork) && durable.logRecords() == AFTER + 1
+         && access((base + ".wal.next").c_str(), F_OK) != 0,
+         "the snapshot holds the set at the fork, the log the changes since");
+   crashImage(base, crash);
+   check(recover(crash, recovered, &records) && sameOrder(recovered, expect)
+         && records == AFTER + 1, "recovery after a background checkpoint");
+
+   //a crash after the snapshot was installed, before its log was renamed
+   string log = fileContents(base + ".wal");
+   crashImage(base, crash);
+   writeFile(crash + ".wal", fileContents(before + ".wal"));
+   writeFile(crash + ".wal.next", log);
+   check(recover(crash, recovered) && sameOrder(recovered, expect)
+         && access((crash + ".wal.next").c_str(), F_OK) != 0
+         && fileContents(crash + ".wal") == log, "the log is renamed by open");
+
+   //a crash before the snapshot was installed leaves a .next that must
+   //not replace the log in use
+   crashImage(before, crash);
+   writeFile(crash + ".wal.next", log);
+   check(recover(crash, recovered) && sameOrder(recovered, atFork)
+         && access((crash + ".wal.next").c_str(), F_OK) != 0,
+         "a log that follows no snapshot is removed");
+   check(recover(crash, recovered) && sameOrder(recovered, atFork),
+         "the log in use survives a stale .next");
+
+   //the maintenance thread starts background checkpoints on its own
+   durable.close();
+   options.syncMode = WAL_SYNC_PERIODIC;
+   options.syncIntervalMs = 1;
+   options.checkpointRecords = 100;
+   check(durable.open(base.c_str(), options), "open with a maintenance thread");
+   for (int i = 0; i < 150; ++i)
+      durable.add(5000 + i);
+   for (int wait = 0; wait < 2000 && durable.logRecords() >= 100; ++wait)
+      this_thread::sleep_for(chrono::milliseconds(1));
+   expect = durable.toIntSet();
+   check(durable.logRecords() < 100, "the maintenance thread checkpoints");
+   durable.close();
+   check(recover(base, recovered) && sameOrder(recovered, expect),
+         "recovery after background checkpoints");
+   return check.failed();
+}
+
+int checkDeltaChain(ostream& out)
+{
+   Checker check(out);
+   ScratchDir scratch;
+   if (!scratch.ok())
+   {
+      check(false, "scratch directory");
+      return check.failed();
+   }
+   string base = scratch.path("set"), crash = scratch.path("crash");
+   IntSet set = randomSet(2000, 10000, 201), loaded, atBase, atFirst;
+   set.trackChanges();
+   check(checkpointDelta(set, base.c_str()) && deltaChainLength(base.c_str()) == 0
+         && loadIntSetChain(base.c_str(), loaded) && sameOrder(loaded, set),
+         "the first checkpoint writes the base");
+   atBase = set;
+   for (int i = 0; i < 5; ++i)
+      set.add(20000 + i);
+   set.remove(set.begin()[0]);
+   set.remove(set.begin()[7]);
+   check(checkpointDelta(set, base.c_str()) && deltaChainLength(base.c_str()) == 1
+         && set.changes().added.empty(), "a checkpoint writes a delta");
+   atFirst = set;
+   set.add(30000);
+   set.remove(set.begin()[3]);
+   check(checkpointDelta(set, base.c_str()) && deltaChainLength(base.c_str()) == 2,
+         "the next checkpoint writes the next delta");
+   check(checkpointDelta(set, base.c_str()) && deltaChainLength(base.c_str()) == 2,
+         "no changes, no delta");
+   check(loadIntSetChain(base.c_str(), loaded) && sameOrder(loaded, set)
+         && loaded.tracksChanges() && loaded.changes().added.empty(),
+         "loadIntSetChain applies the deltas");
+
+   //each delta names its place in the chain
+   string second = fileContents(deltaName(base, 2));
+   IntSetDelta delta;
+   int toSize = -1, sequence = -1;
+   size_t toHash = 0;
+   unsigned long long baseChecksum = 0;
+   istringstream in(second);
+   check(loadIntSetDelta(in, delta, toSize, toHash, sequence, baseChecksum)
+         && sequence == 2 && toSize == set.size() && toHash == set.hash()
+         && baseChecksum == headerOf(fileContents(base)).checksum
+         && delta.baseSize == atFirst.size() && delta.baseHash == atFirst.hash(),
+         "loadIntSetDelta");
+   string old = second;
+   uint16_t version = INTSET_DELTA_VERSION - 1;
+   memcpy(&old[8], &version, sizeof version);
+   istringstream oldIn(old);
+   check(!loadIntSetDelta(oldIn, delta, toSize, toHash, sequence, baseChecksum),
+         "a delta of another version is refused");
+
+   //a damaged last delta ends the chain, and the next one replaces it
+   copyChain(base, crash);
+   writeFile(deltaName(crash, 2), second.substr(0, second.size() / 2));
+   check(loadIntSetChain(crash.c_str(), loaded) && sameOrder(loaded, atFirst)
+         && deltaChainLength(crash.c_str()) == 1,
+         "the chain stops at the last good delta");
+   loaded.add(40000);
+   IntSet expect = loaded;
+   check(checkpointDelta(loaded, crash.c_str())
+         && deltaChainLength(crash.c_str()) == 2
+         && loadIntSetChain(crash.c_str(), loaded) && sameOrder(loaded, expect),
+         "a delta written after a damaged one is loaded");
+   copyChain(base, crash);
+   string first = fileContents(deltaName(base, 1));
+   first[first.size() - 1] ^= 1;
+   writeFile(deltaName(crash, 1), first);
+   check(loadIntSetChain(crash.c_str(), loaded) && sameOrder(loaded, atBase)
+         && deltaChainLength(crash.c_str()) == 0, "a damaged first delta");
+
+   //a delta out of place does not belong to the chain
+   copyChain(base, crash);
+   writeFile(deltaName(crash, 1), second);
+   unlink(deltaName(crash, 2).c_str());
+   check(loadIntSetChain(crash.c_str(), loaded) && sameOrder(loaded, atBase),
+         "a delta with another number is not applied");
+
+   //one in place but not following the state reached is damaged
+   copyChain(base, crash);
+   {
+      ofstream wrong(deltaName(crash, 2).c_str(), ios::binary | ios::trunc);
+      delta.baseHash ^= 1;
+      saveIntSetDelta(delta, toSize, toHash, 2,
+                      headerOf(fileContents(base)).checksum, wrong);
+   }
+   IntSet untouched = randomSet(5, 10, 203), kept(untouched);
+   check(!loadIntSetChain(crash.c_str(), kept) && sameOrder(kept, untouched),
+         "a delta that does not follow is refused");
+
+   //a crash during compaction: the new base is in place, the old
+   //deltas are not yet deleted
+   copyChain(base, crash);
+   IntSet compacted = set;
+   compacted.add(50000);
+   check(saveIntSet(compacted, crash.c_str())
+         && loadIntSetChain(crash.c_str(), loaded) && sameOrder(loaded, compacted)
+         && deltaChainLength(crash.c_str()) == 0,
+         "deltas of an old base are not applied to the new one");
+
+   //back to the state of the base: compaction only deletes the deltas
+   copyChain(base, crash);
+   check(loadIntSetChain(crash.c_str(), loaded), "load before compaction");
+   string baseBytes = fileContents(crash);
+   IntSet back = atBase;
+   back.trackChanges();
+   check(compactDeltaChain(back, crash.c_str()) && fileContents(crash) == baseBytes
+         && deltaChainLength(crash.c_str()) == 0
+         && loadIntSetChain(crash.c_str(), loaded) && sameOrder(loaded, atBase),
+         "compacting to the base's own state");
+
+   //a long chain, the set cleared or many changes compact it
+   check(checkpointDelta(set, base.c_str()) && deltaChainLength(base.c_str()) == 2,
+         "chain before compaction");
+   set.add(60000);
+   check(checkpointDelta(set, base.c_str(), 2) && deltaChainLength(base.c_str()) == 0
+         && loadIntSetChain(base.c_str(), loaded) && sameOrder(loaded, set),
+         "maxChain compacts the chain");
+   set.reset();
+   set.add(1);
+   check(checkpointDelta(set, base.c_str()) && deltaChainLength(base.c_str()) == 0
+         && loadIntSetChain(base.c_str(), loaded) && holds(loaded, vector<int>{1}),
+         "a cleared set compacts the chain");
+   check(access((base + ".tmp").c_str(), F_OK) != 0
+         && access((deltaName(base, 1) + ".tmp").c_str(), F_OK) != 0,
+         "no files are left aside");
+   return check.failed();
+}
+
+int checkCatalog(ostream& out)
+{
+   Checker check(out);
+   ScratchDir scratch;
+   if (!scratch.ok())
+   {
+      check(false, "scratch directory");
+      return check.failed();
+   }
+
+   //small files, an empty one, one needing several reads, indexed and
+   //packed ones, and more of them than the deepest queue below
+   const int FILES = 150;
+   vector<IntSet> sets;
+   vector<CatalogEntry> entries;
+   bool saved = true;
+   for (int i = 0; i < FILES; ++i)
+   {
+      int n = i == 0 ? 0 : i == 1 ? 100000 : 10 + 37 * i;
+      sets.push_back(randomSet(n, 4 * n + 1, 210 + i));
+      unsigned flags = INTSET_FILE_CHECKSUM
+                       | (i % 3 == 1 ? INTSET_FILE_INDEXED : 0)
+                       | (i % 5 == 2 ? INTSET_FILE_PACKED : 0);
+      ostringstream name;
+      name << "set" << 1000 + i;
+      string path = scratch.path(name.str() + ".iset");
+      saved = saved && saveIntSet(sets.back(), path.c_str(), flags);
+      if (flags & INTSET_FILE_PACKED)
+         sets.back() = sortedCopy(sets.back());
+      entries.push_back(CatalogEntry(name.str(), path));
+   }
+   check(saved, "catalog files saved");
+
+   vector<CatalogEntry> listed;
+   writeFile(scratch.path("notes.txt"), "not a set");
+   writeFile(scratch.path(".iset"), "");
+   bool sameList = listIntSetCatalog(scratch.path(".").c_str(), ".iset", listed)
+                   && listed.size() == entries.size();
+   for (size_t i = 0; sameList && i < listed.size(); ++i)
+      sameList = listed[i].name == entries[i].name
+                 && fileContents(listed[i].path) == fileContents(entries[i].path);
+   check(sameList, "listIntSetCatalog lists the files in name order");
+   vector<CatalogEntry> unchanged(1, entries[0]);
+   check(!listIntSetCatalog(scratch.path("missing").c_str(), ".iset", unchanged)
+         && unchanged.size() == 1, "a missing directory");
+
+   //entries that fail: missing, truncated and damaged files; and a
+   //name listed twice, whose later entry wins
+   string good = fileContents(entries[5].path);
+   writeFile(scratch.path("truncated"), good.substr(0, good.size() - 1));
+   string damaged = good;
+   damaged[damaged.size() - 1] ^= 1;
+   writeFile(scratch.path("damaged"), damaged);
+   vector<CatalogEntry> all = entries;
+   all.push_back(CatalogEntry("missing", scratch.path("none")));
+   all.push_back(CatalogEntry("truncated", scratch.path("truncated")));
+   all.push_back(CatalogEntry("damaged", scratch.path("damaged")));
+   all.push_back(CatalogEntry(entries[3].name, entries[4].path));
+   vector<string> expectFailed;
+   expectFailed.push_back("missing");
+   expectFailed.push_back("truncated");
+   expectFailed.push_back("damaged");
+
+   bool loadedAll = true;
+   const int depths[] = { 1, 4, 64 };
+   for (int uring = 0; uring < 2; ++uring)
+      for (int d = 0; d < 3; ++d)
+      {
+         CatalogOptions options;
+         options.useIoUring = uring == 1;
+         options.queueDepth = depths[d];
+         options.numThreads = d + 1;
+         IntSetRegistry registry;
+         registry["untouched"] = sets[7];
+         registry[entries[9].name] = sets[8];
+         vector<string> failed;
+         int loaded = loadIntSetCatalog(all, registry, &failed, options);
+         loadedAll = loadedAll && loaded == FILES + 1 && failed == expectFailed
+                     && registry.size() == size_t(FILES + 1)
+                     && sameOrder(registry["untouched"], sets[7])
+                     && sameOrder(registry[entries[3].name], sets[4]);
+         for (int i = 0; loadedAll && i < FILES; ++i)
+            loadedAll = i == 3 || sameOrder(registry[entries[i].name], sets[i]);
+      }
+   check(loadedAll, "loadIntSetCatalog, with and without io_uring");
+
+   IntSetRegistry registry;
+   check(loadIntSetCatalog(vector<CatalogEntry>(), registry) == 0 && registry.empty(),
+         "an empty catalog");
+   if (!catalogUsesIoUring())
+      out << "   (io_uring is not available: both runs used threads)" << endl;
+   return check.failed();
+}
+
+int runAllChecks(ostream& out)
+{
+   struct Entry
+   {
+      const char* name;
+      int (*run)(ostream&);
+   };
+   const Entry checks[] =
+   {
+      { "AtomicBitSet", checkAtomicBitSet },
+      { "ShardedIntSet", checkShardedIntSet },
+      { "parallel set algebra", checkParallelAlgebra },
+      { "merge path", checkMergePath },
+      { "WorkStealingPool and SetBatchExecutor", checkWorkStealingPool },
+      { "set sizes and similarity", checkSetSizes },
+      { "fingerprint and equality", checkFingerprint },
+      { "multi-way union and intersection", checkMultiWay },
+      { "symmetricDifference and isDisjoint", checkSymmetricDifference },
+      { "set expressions", checkSetExpr },
+      { "SetGraph", checkSetGraph },
+      { "kernel planner", checkPlanner },
+      { "operations into an output set", checkIntoOperations },
+      { "element access", checkElementAccess },
+      { "buffer adoption and release", checkBufferAdoption },
+      { "IntSet files", checkIntSetFile },
+      { "stored index", checkStoredIndex },
+      { "packed ints", checkPackedInts },
+      { "fast DumpData", checkDump },
+      { "text loader", checkTextLoader },
+      { "parallel text", checkParallelText },
+      { "DurableIntSet", checkDurableIntSet },
+      { "background checkpoints", checkBackgroundCheckpoint },
+      { "delta chains", checkDeltaChain },
+      { "catalog loading", checkCatalog }
+   };
+
+   int failures = 0;
+   for (size_t i = 0; i < sizeof checks / sizeof checks[0]; ++i)
+   {
+      int failed = checks[i].run(out);
+      out << (failed == 0 ? "passed  " : "FAILED  ") << checks[i].name << endl;
+      failures += failed;
+   }
+   out << failures << " check(s) failed" << endl;
+   return failures;
+}
@@ -0,0 +1,140 @@
+// FILE: IntSetChecks.h - automatic checks of the IntSet extensions
+//
+// The interactive test program (Assign02.cpp) exercises the original
+// IntSet operations one command at a time. These functions check the
+// classes and functions built around IntSet without any input: each
+// runs a fixed set of cases (including concurrent, crash-recovery and
+// damaged-input cases where they apply), writes one line per failed
+// case to out and returns the number of failures. Files are written
+// in a scratch directory under the system temporary directory and
+// removed again.
+//
+// FUNCTIONS PROVIDED:
+//   int checkAtomicBitSet(std::ostream& out)
+//     Post: AtomicBitSet has been checked, including snapshots taken
+//           while another thread writes.
+//   int checkShardedIntSet(std::ostream& out)
+//     Post: ShardedIntSet has been checked with several client
+//           threads at once.
+//   int checkParallelAlgebra(std::ostream& out)
+//     Post: The parallel set operations have been checked against the
+//           sequential ones, and parallelFor with nested and
+//           concurrent calls and with tasks that throw.
+//   int checkMergePath(std::ostream& out)
+//     Post: Merge-path splitting and the sorted union and
+//           intersection have been checked against std::set_union and
+//           std::set_intersection.
+//   int checkWorkStealingPool(std::ostream& out)
+//     Post: WorkStealingPool (tasks spawning tasks, exceptions,
+//           shutdown), SetBatchExecutor and moving IntSet's have
+//           been checked.
+//   int checkSetSizes(std::ostream& out)
+//     Post: intersectionSize, unionSize, differenceSize, jaccard and
+//           overlapCoefficient have been checked against the sizes of
+//           the built results, for every kernel.
+//   int checkFingerprint(std::ostream& out)
+//     Post: The fingerprint behind hash() and operator== has been
+//           checked after every kind of change.
+//   int checkMultiWay(std::ostream& out)
+//     Post: unionAll and intersectAll have been checked against
+//           chained unionWith and intersect.
+//   int checkSymmetricDifference(std::ostream& out)
+//     Post: symmetricDifference and isDisjoint have been checked
+//           against subtract, unionWith and intersect, for every
+//           kernel.
+//   int checkSetExpr(std::ostream& out)
+//     Post: Set expressions (see SetExpr.h) have been checked against
+//           the member functions, including ones assigned to one of
+//           their operands.
+//   int checkSetGraph(std::ostream& out)
+//     Post: SetGraph node sharing and evaluation (repeated calls, a
+//           shared caller-supplied pool, concurrent callers) have
+//           been checked.
+//   int checkPlanner(std::ostream& out)
+//     Post: The kernel planner's choices and the results of the
+//           operations for inputs favouring each kernel have been
+//           checked.
+//   int checkIntoOperations(std::ostream& out)
+//     Post: unionInto, intersectInto and subtractInto have been
+//           checked, including with the output being an input and
+//           the output's array being reused.
+//   int checkElementAccess(std::ostream& out)
+//     Post: begin(), end(), view() and forEach have been checked.
+//   int checkBufferAdoption(std::ostream& out)
+//     Post: adopt, release and fromUniqueRange have been checked.
+//   int checkIntSetFile(std::ostream& out)
+//     Post: Saving and loading raw IntSet files (streams, paths,
+//           decodeIntSet, MappedIntSet) has been checked, including
+//           truncated, damaged and inconsistent files.
+//   int checkStoredIndex(std::ostream& out)
+//     Post: Files with a stored index (INTSET_FILE_INDEXED) have been
+//           checked through every reader and MappedIntSet lookups,
+//           including bad index layouts and damaged slots.
+//   int checkPackedInts(std::ostream& out)
+//     Post: Bit-packed encoding, CompressedIntSet and packed files
+//           have been checked, including damaged encodings (zero
+//           gaps, overflow, misordered blocks, bad widths, offsets,
+//           lengths and counts).
+//   int checkDump(std::ostream& out)
+//     Post: formatInt and dumpIntSet (to a stream, a FILE and a file
+//           descriptor) have been checked against DumpData.
+//   int checkTextLoader(std::ostream& out)
+//     Post: parseInts and loadIntSetText have been checked, including
+//           malformed and out-of-range input and error offsets, and
+//           addAll with values from the set's own array.
+//   int checkParallelText(std::ostream& out)
+//     Post: The parallel dump, parse and load functions have been
+//           checked against the sequential ones, errors included.
+//   int checkDurableIntSet(std::ostream& out)
+//     Post: DurableIntSet has been checked, including recovery from
+//           the files a crash leaves (torn and damaged log records, a
+//           log from before the snapshot, a damaged snapshot).
+//   int checkBackgroundCheckpoint(std::ostream& out)
+//     Post: Background checkpoints have been checked, including
+//           recovery from a crash on either side of installing one.
+//   int checkDeltaChain(std::ostream& out)
+//     Post: Delta files and chains have been checked, including
+//           damaged and misplaced deltas and a crash during
+//           compaction.
+//   int checkCatalog(std::ostream& out)
+//     Post: Listing and loading catalogs has been checked with and
+//           without io_uring, including entries that fail and names
+//           listed twice.
+//   int runAllChecks(std::ostream& out)
+//     Post: Every check above has run, its name and result have been
+//           written to out, followed by a summary; the total number
+//           of failures is returned.
+
+#ifndef INT_SET_CHECKS_H
+#define INT_SET_CHECKS_H
+
+#include <iostream>
+
+int checkAtomicBitSet(std::ostream& out);
+int checkShardedIntSet(std::ostream& out);
+int checkParallelAlgebra(std::ostream& out);
+int checkMergePath(std::ostream& out);
+int checkWorkStealingPool(std::ostream& out);
+int checkSetSizes(std::ostream& out);
+int checkFingerprint(std::ostream& out);
+int checkMultiWay(std::ostream& out);
+int checkSymmetricDifference(std::ostream& out);
+int checkSetExpr(std::ostream& out);
+int checkSetGraph(std::ostream& out);
+int checkPlanner(std::ostream& out);
+int checkIntoOperations(std::ostream& out);
+int checkElementAccess(std::ostream& out);
+int checkBufferAdoption(std::ostream& out);
+int checkIntSetFile(std::ostream& out);
+int checkStoredIndex(std::ostream& out);
+int checkPackedInts(std::ostream& out);
+int checkDump(std::ostream& out);
+int checkTextLoader(std::ostream& out);
+int checkParallelText(std::ostream& out);
+int checkDurableIntSet(std::ostream& out);
+int checkBackgroundCheckpoint(std::ostream& out);
+int checkDeltaChain(std::ostream& out);
+int checkCatalog(std::ostream& out);
+int runAllChecks(std::ostream& out);
+
+#endif
@@ -0,0 +1,294 @@
+// FILE: IntSetDeltaFile.cpp
+//       Implementation file for incremental IntSet persistence
+//       (See IntSetDeltaFile.h for documentation.)
+
+#include "IntSetDeltaFile.h"
+#include "IntSetFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+using namespace std;
+
+namespace
+{
+   const char MAGIC[4] = { 'I', 'D', 'L', 'T' };
+
+   struct DeltaHeader
+   {
+      char     magic[4];
+      uint32_t byteOrder;
+      uint16_t version;
+      uint16_t flags;
+      uint32_t removedCount;
+      uint32_t addedCount;
+      int32_t  fromSize;
+      uint64_t fromHash;
+      int32_t  toSize;
+      uint32_t sequence;
+      uint64_t toHash;
+      uint64_t baseChecksum;
+      uint64_t checksum;
+   };
+
+   static_assert(sizeof(DeltaHeader) == 64, "delta header layout changed");
+
+   string deltaPath(const char* basePath, int n)
+   {
+      ostringstream path;
+      path << basePath << ".delta." << n;
+      return path.str();
+   }
+
+   bool exists(const string& path)
+   {
+      return access(path.c_str(), F_OK) == 0;
+   }
+
+   //deletes basePath.delta.first, .first + 1, ... up to the first one
+   //missing
+   void unlinkDeltas(const char* basePath, int first)
+   {
+      for (int n = first; unlink(deltaPath(basePath, n).c_str()) == 0; ++n)
+         ;
+   }
+
+   //the header of the base at basePath, which identifies it to its
+   //deltas by its checksum; false if it cannot be read
+   bool readBaseHeader(const char* basePath, IntSetFileHeader& h)
+   {
+      ifstream in(basePath, ios::binary);
+      return in.read(reinterpret_cast<char*>(&h), sizeof h)
+             && h.byteOrder == INTSET_FILE_BYTE_ORDER
+             && h.version == INTSET_FILE_VERSION;
+   }
+
+   //checksum of the removed list followed by the added list, as they
+   //lie in the payload
+   unsigned long long payloadChecksum(const vector<int>& removed,
+                                      const vector<int>& added)
+   {
+      unsigned long long sum = INTSET_CHECKSUM_SEED;
+      if (!removed.empty())
+         sum = intSetChecksum(&removed[0], removed.size() * sizeof(int32_t), sum);
+      if (!added.empty())
+         sum = intSetChecksum(&added[0], added.size() * sizeof(int32_t), sum);
+      return sum;
+   }
+
+   bool readInts(istream& in, vector<int>& values, uint32_t count)
+   {
+      values.resize(count);
+      return count == 0
+             || in.read(reinterpret_cast<char*>(&values[0]),
+                        streamsize(count * sizeof(int32_t)));
+   }
+}
+
+bool saveIntSetDelta(const IntSetDelta& delta, int toSize, size_t toHash,
+                     int sequence, unsigned long long baseChecksum, ostream& out)
+{
+   DeltaHeader h;
+   memset(&h, 0, sizeof h);
+   memcpy(h.magic, MAGIC, sizeof MAGIC);
+   h.byteOrder = INTSET_FILE_BYTE_ORDER;
+   h.version = INTSET_DELTA_VERSION;
+   h.flags = delta.cleared ? INTSET_DELTA_CLEARED : 0;
+   h.removedCount = uint32_t(delta.removed.size());
+   h.addedCount = uint32_t(delta.added.size());
+   h.fromSize = delta.baseSize;
+   h.fromHash = delta.baseHash;
+   h.toSize = toSize;
+   h.sequence = uint32_t(sequence);
+   h.toHash = toHash;
+   h.baseChecksum = baseChecksum;
+   h.checksum = payloadChecksum(delta.removed, delta.added);
+
+   out.write(reinterpret_cast<const char*>(&h), sizeof h);
+   if (!delta.removed.empty())
+      out.write(reinterpret_cast<const char*>(&delta.removed[0]),
+                streamsize(delta.removed.size() * sizeof(int32_t)));
+   if (!delta.added.empty())
+      out.write(reinterpret_cast<const char*>(&delta.added[0]),
+                streamsize(delta.added.size() * sizeof(int32_t)));
+   return bool(out);
+}
+
+bool loadIntSetDelta(istream& in, IntSetDelta& delta, int& toSize,
+                     size_t& toHash, int& sequence,
+                     unsigned long long& baseChecksum)
+{
+   DeltaHeader h;
+   if (!in.read(reinterpret_cast<char*>(&h), sizeof h)
+       || memcmp(h.magic, MAGIC, sizeof MAGIC) != 0
+       || h.byteOrder != INTSET_FILE_BYTE_ORDER
+       || h.version != INTSET_DELTA_VERSION
+       || (h.flags & ~unsigned(INTSET_DELTA_KNOWN_FLAGS)) != 0
+       || h.removedCount > uint32_t(INT32_MAX)
+       || h.addedCount > uint32_t(INT32_MAX)
+       || h.sequence > uint32_t(INT32_MAX))
+      return false;
+
+   IntSetDelta loaded;
+   if (!readInts(in, loaded.removed, h.removedCount)
+       || !readInts(in, loaded.added, h.addedCount)
+       || payloadChecksum(loaded.removed, loaded.added) != h.checksum)
+      return false;
+   loaded.cleared = (h.flags & INTSET_DELTA_CLEARED) != 0;
+   loaded.baseSize = h.fromSize;
+   loaded.baseHash = size_t(h.fromHash);
+   delta.cleared = loaded.cleared;
+   delta.removed.swap(loaded.removed);
+   delta.added.swap(loaded.added);
+   delta.baseSize = loaded.baseSize;
+   delta.baseHash = loaded.baseHash;
+   toSize = h.toSize;
+   toHash = size_t(h.toHash);
+   sequence = int(h.sequence);
+   baseChecksum = h.baseChecksum;
+   return true;
+}
+
+bool checkpointDelta(IntSet& set, const char* basePath, int maxChain)
+{
+   const IntSetDelta& delta = set.changes();
+   IntSetFileHeader base;
+   bool hasBase = readBaseHeader(basePath, base);
+   if (hasBase && !delta.cleared && delta.removed.empty() && delta.added.empty())
+      return true;
+
+   int length = deltaChainLength(basePath);
+   size_t changed = delta.removed.size() + delta.added.size();
+   if (!hasBase || length >= maxChain || delta.cleared
+       || 2 * changed >= size_t(set.size()))
+      return compactDeltaChain(set, basePath);
+
+   //written aside, synced and renamed, so a delta file is whole or
+   //absent
+   string path = deltaPath(basePath, length + 1);
+   string aside = path + ".tmp";
+   {
+      ofstream out(aside.c_str(), ios::binary | ios::trunc);
+      if (!out || !saveIntSetDelta(delta, set.size(), set.hash(), length + 1,
+                                   base.checksum, out)
+          || !out.flush())
+      {
+         out.close();
+         unlink(aside.c_str());
+         return false;
+      }
+   }
+   if (!syncPath(aside.c_str()))
+   {
+      unlink(aside.c_str());
+      return false;
+   }
+
+   //deltas a crash during compaction left past the end of the chain
+   //must not be counted as following this one
+   unlinkDeltas(basePath, length + 2);
+   if (rename(aside.c_str(), path.c_str()) != 0)
+   {
+      unlink(aside.c_str());
+      return false;
+   }
+
+   //a delta that may not survive a crash must not stay in the chain
+   //either, or the changes (still recorded in set) would be saved twice
+   if (!syncParent(path.c_str()))
+   {
+      unlink(path.c_str());
+      return false;
+   }
+   set.markCheckpoint();
+   return true;
+}
+
+bool compactDeltaChain(IntSet& set, const char* basePath)
+{
+   //a base that already holds set keeps its place; deleting the deltas
+   //first means a crash cannot leave them to be applied to it again
+   IntSetFileHeader base;
+   if (readBaseHeader(basePath, base) && (base.flags & INTSET_FILE_CHECKSUM)
+       && base.count == uint32_t(set.size())
+       && base.checksum == intSetChecksum(set.begin(), set.size() * sizeof(int32_t)))
+   {
+      unlinkDeltas(basePath, 1);
+      if (!syncParent(basePath))
+         return false;
+      if (set.tracksChanges())
+         set.markCheckpoint();
+      return true;
+   }
+
+   string aside = string(basePath) + ".tmp";
+   if (!saveIntSet(set, aside.c_str()) || !syncPath(aside.c_str())
+       || rename(aside.c_str(), basePath) != 0)
+   {
+      unlink(aside.c_str());
+      return false;
+   }
+   if (!syncParent(basePath))
+      return false;
+
+   //the deltas left name the old base, so a crash before they are all
+   //gone leaves none that loading would apply
+   unlinkDeltas(basePath, 1);
+   if (set.tracksChanges())
+      set.markCheckpoint();
+   return true;
+}
+
+bool loadIntSetChain(const char* basePath, IntSet& set)
+{
+   IntSet loaded;
+   IntSetFileHeader base;
+   if (!loadIntSet(basePath, loaded) || !readBaseHeader(basePath, base))
+      return false;
+
+   IntSetDelta delta;
+   int n = 1;
+   for (; ; ++n)
+   {
+      ifstream in(deltaPath(basePath, n).c_str(), ios::binary);
+      if (!in)
+         break;
+      int toSize, sequence;
+      size_t toHash;
+      unsigned long long baseChecksum;
+      if (!loadIntSetDelta(in, delta, toSize, toHash, sequence, baseChecksum)
+          || sequence != n || baseChecksum != base.checksum)
+         break;
+
+      //one that belongs to the chain but not to the state reached so
+      //far, or does not reach its own target, is damaged
+      if (delta.baseSize != loaded.size() || delta.baseHash != loaded.hash())
+         return false;
+      loaded.applyDelta(delta);
+      if (toSize != loaded.size() || toHash != loaded.hash())
+         return false;
+   }
+
+   //a damaged delta, or one left from before the last compaction, ends
+   //the chain; the next delta written takes its place
+   if (exists(deltaPath(basePath, n)))
+   {
+      unlinkDeltas(basePath, n);
+      syncParent(basePath);
+   }
+
+   set.swap(loaded);
+   set.trackChanges();
+   set.markCheckpoint();
+   return true;
+}
+
+int deltaChainLength(const char* basePath)
+{
+   int n = 0;
+   while (exists(deltaPath(basePath, n + 1)))
+      ++n;
+   return n;
+}
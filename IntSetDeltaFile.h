@@ -0,0 +1,123 @@
+// FILE: IntSetDeltaFile.h - incremental (delta) persistence of IntSet
+//
+// A set that changes little between checkpoints is stored as a chain:
+// a base file in the IntSet binary format (IntSetFile.h) at basePath,
+// followed by delta files basePath.delta.1, basePath.delta.2, ...
+// each holding only what changed since the file before it (see
+// IntSetDelta and IntSet::trackChanges in IntSet.h). Loading applies
+// the deltas to the base in order; compaction writes the current set
+// as a new base and deletes the deltas.
+//
+// Every delta names its place in the chain: its number n and the
+// checksum in the header of the base it follows. Loading stops at the
+// first delta that does not belong there, and cuts the chain at it: a
+// delta that cannot be read, or one left behind by a crash during
+// compaction (the new base is synced and renamed into place before the
+// deltas are deleted) and so naming the old base. Every delta also
+// names the state it applies to and the state it gives (size and
+// hash()); a delta that belongs to the chain but does not match them
+// makes the load fail. Writing delta n deletes any run of files from
+// n + 1 on first, so leftovers never extend the chain. Delta and base
+// files are written aside, synced and renamed into place, and the
+// rename synced too.
+//
+// DELTA FILE (all fields in host byte order)
+//   offset  size  field
+//        0     4  magic         "IDLT"
+//        4     4  byteOrder     0x01020304 as written by the host
+//        8     2  version       INTSET_DELTA_VERSION
+//       10     2  flags         INTSET_DELTA_CLEARED if the set was
+//                               emptied before the changes
+//       12     4  removedCount
+//       16     4  addedCount
+//       20     4  fromSize      size() the delta applies to
+//       24     8  fromHash      hash() the delta applies to
+//       32     4  toSize        size() after applying it
+//       36     4  sequence      n, its place in the chain
+//       40     8  toHash        hash() after applying it
+//       48     8  baseChecksum  checksum in the base file's header
+//       56     8  checksum      FNV-1a of the payload
+//   Then the payload: removedCount ints, then addedCount ints.
+//
+// CONSTANTS
+//   MAX_DELTA_CHAIN       default number of deltas after which
+//                         checkpointDelta compacts the chain
+//
+// FUNCTIONS PROVIDED:
+//   bool saveIntSetDelta(const IntSetDelta& delta, int toSize,
+//                        std::size_t toHash, int sequence,
+//                        unsigned long long baseChecksum,
+//                        std::ostream& out)
+//     Post: delta, leading from (delta.baseSize, delta.baseHash) to
+//           (toSize, toHash) as delta number sequence of the chain
+//           on the base with baseChecksum, has been written to out;
+//           false is returned if writing failed.
+//   bool loadIntSetDelta(std::istream& in, IntSetDelta& delta,
+//                        int& toSize, std::size_t& toHash,
+//                        int& sequence, unsigned long long& baseChecksum)
+//     Post: If a valid delta could be read (checksum included), it is
+//           in delta (with its from state in baseSize and baseHash),
+//           its to state is in toSize and toHash, its place in the
+//           chain in sequence and baseChecksum, and true is returned;
+//           otherwise false is returned.
+//   bool checkpointDelta(IntSet& set, const char* basePath,
+//                        int maxChain = MAX_DELTA_CHAIN)
+//     Pre:  set.tracksChanges(), and its last checkpoint is the state
+//           the chain at basePath ends in (as after loadIntSetChain or
+//           a previous checkpointDelta).
+//     Post: set's changes since that checkpoint have been saved and
+//           set.markCheckpoint() called; true is returned, or false
+//           (with the changes still recorded in set) if writing
+//           failed. The changes go to the next delta file, unless
+//           there is no base yet, the chain already has maxChain
+//           deltas, the set was cleared or the changes are at least
+//           half the set's size: then the chain is compacted instead.
+//           Nothing is written if there are no changes.
+//   bool compactDeltaChain(IntSet& set, const char* basePath)
+//     Post: set has been written as the base at basePath (aside, then
+//           renamed into place), the delta files have been deleted
+//           and, if set tracks changes, set.markCheckpoint() has been
+//           called; false is returned if writing the base failed.
+//     Note: A base that already holds set (same count and checksum)
+//           is kept, and only the deltas are deleted.
+//   bool loadIntSetChain(const char* basePath, IntSet& set)
+//     Post: If the base could be loaded and the deltas that belong to
+//           its chain were consistent, set holds the result of
+//           applying them, tracks changes with that as its checkpoint,
+//           the delta files from the first one that does not belong
+//           on have been deleted, and true is returned; otherwise set
+//           is unchanged and false is returned.
+//   int deltaChainLength(const char* basePath)
+//     Post: The number of consecutive delta files basePath.delta.1,
+//           basePath.delta.2, ... that exist is returned.
+
+#ifndef INT_SET_DELTA_FILE_H
+#define INT_SET_DELTA_FILE_H
+
+#include "IntSet.h"
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+const std::uint16_t INTSET_DELTA_VERSION = 2;
+const int MAX_DELTA_CHAIN = 16;
+
+enum IntSetDeltaFlags
+{
+   INTSET_DELTA_CLEARED = 1,
+   INTSET_DELTA_KNOWN_FLAGS = 1
+};
+
+bool saveIntSetDelta(const IntSetDelta& delta, int toSize,
+                     std::size_t toHash, int sequence,
+                     unsigned long long baseChecksum, std::ostream& out);
+bool loadIntSetDelta(std::istream& in, IntSetDelta& delta,
+                     int& toSize, std::size_t& toHash,
+                     int& sequence, unsigned long long& baseChecksum);
+bool checkpointDelta(IntSet& set, const char* basePath,
+                     int maxChain = MAX_DELTA_CHAIN);
+bool compactDeltaChain(IntSet& set, const char* basePath);
+bool loadIntSetChain(const char* basePath, IntSet& set);
+int deltaChainLength(const char* basePath);
+
+#endif
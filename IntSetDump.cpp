@@ -0,0 +1,188 @@
+// FILE: IntSetDump.cpp
+//       Implementation file for fast IntSet text output
+//       (See IntSetDump.h for documentation.)
+
+#include "IntSetDump.h"
+#include "Parallel.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+using namespace std;
+
+namespace
+{
+   //"00" "01" ... "99": two digits per table lookup
+   const char DIGIT_PAIRS[] =
+      "0001020304050607080910111213141516171819"
+      "2021222324252627282930313233343536373839"
+      "4041424344454647484950515253545556575859"
+      "6061626364656667686970717273747576777879"
+      "8081828384858687888990919293949596979899";
+
+   //formats the set a chunk at a time and passes each chunk to sink;
+   //false as soon as sink does
+   template <class Sink>
+   bool dumpChunks(const IntSet& set, Sink sink)
+   {
+      const int PER_CHUNK = int(DUMP_CHUNK_BYTES / (MAX_INT_CHARS + 2));
+      vector<char> buffer(DUMP_CHUNK_BYTES);
+      const int* values = set.begin();
+      for (int at = 0, n = set.size(); at < n; at += PER_CHUNK)
+      {
+         int count = n - at < PER_CHUNK ? n - at : PER_CHUNK;
+         size_t length = formatInts(values + at, count, &buffer[0], at > 0);
+         if (!sink(&buffer[0], length))
+            return false;
+      }
+      return true;
+   }
+
+   //as dumpChunks, but numThreads pieces of PARALLEL_DUMP_ELEMENTS
+   //are formatted at once and then passed to sink in order
+   template <class Sink>
+   bool parallelDumpChunks(const IntSet& set, int numThreads, Sink sink)
+   {
+      int n = set.size();
+      numThreads = resolveThreads(numThreads);
+      if (numThreads == 1 || n <= PARALLEL_DUMP_ELEMENTS)
+         return dumpChunks(set, sink);
+
+      const int PER_PIECE = PARALLEL_DUMP_ELEMENTS;
+      const int* values = set.begin();
+      vector< vector<char> > buffers(numThreads,
+         vector<char>(size_t(PER_PIECE) * (MAX_INT_CHARS + 2)));
+      vector<size_t> lengths(numThreads);
+      for (int round = 0; round < n; round += numThreads * PER_PIECE)
+      {
+         parallelFor(numThreads, numThreads, [&](int t)
+         {
+            int at = round + t * PER_PIECE;
+            int count = n - at < PER_PIECE ? n - at : PER_PIECE;
+            lengths[t] = count <= 0 ? 0
+                         : formatInts(values + at, count, &buffers[t][0], at > 0);
+         });
+         for (int t = 0; t < numThreads; ++t)
+            if (lengths[t] > 0 && !sink(&buffers[t][0], lengths[t]))
+               return false;
+      }
+      return true;
+   }
+
+   bool writeAll(int fd, const char* text, size_t length)
+   {
+      //write() may take less than asked, or be interrupted
+      while (length > 0)
+      {
+         ssize_t done = write(fd, text, length);
+         if (done < 0)
+         {
+            if (errno == EINTR)
+               continue;
+            return false;
+         }
+         text += done;
+         length -= size_t(done);
+      }
+      return true;
+   }
+}
+
+char* formatInt(int value, char* out)
+{
+   //work in unsigned so that INT_MIN negates cleanly
+   unsigned int u = unsigned(value);
+   if (value < 0)
+   {
+      *out++ = '-';
+      u = 0u - u;
+   }
+
+   //digits come out lowest first, into the end of a scratch buffer
+   char scratch[MAX_INT_CHARS];
+   char* p = scratch + MAX_INT_CHARS;
+   while (u >= 100)
+   {
+      unsigned int pair = u % 100;
+      u /= 100;
+      p -= 2;
+      memcpy(p, DIGIT_PAIRS + 2 * pair, 2);
+   }
+   if (u >= 10)
+   {
+      p -= 2;
+      memcpy(p, DIGIT_PAIRS + 2 * u, 2);
+   }
+   else
+      *--p = char('0' + u);
+
+   size_t length = scratch + MAX_INT_CHARS - p;
+   memcpy(out, p, length);
+   return out + length;
+}
+
+size_t formatInts(const int* values, int n, char* out, bool leadingSeparator)
+{
+   char* p = out;
+   for (int i = 0; i < n; ++i)
+   {
+      if (i > 0 || leadingSeparator)
+      {
+         *p++ = ' ';
+         *p++ = ' ';
+      }
+      p = formatInt(values[i], p);
+   }
+   return size_t(p - out);
+}
+
+bool dumpIntSet(const IntSet& set, ostream& out)
+{
+   return dumpChunks(set, [&out](const char* text, size_t length)
+   {
+      return bool(out.write(text, streamsize(length)));
+   });
+}
+
+bool dumpIntSet(const IntSet& set, FILE* out)
+{
+   return dumpChunks(set, [out](const char* text, size_t length)
+   {
+      return fwrite(text, 1, length, out) == length;
+   });
+}
+
+bool dumpIntSet(const IntSet& set, int fd)
+{
+   return dumpChunks(set, [fd](const char* text, size_t length)
+   {
+      return writeAll(fd, text, length);
+   });
+}
+
+bool parallelDumpIntSet(const IntSet& set, ostream& out, int numThreads)
+{
+   return parallelDumpChunks(set, numThreads,
+                             [&out](const char* text, size_t length)
+   {
+      return bool(out.write(text, streamsize(length)));
+   });
+}
+
+bool parallelDumpIntSet(const IntSet& set, FILE* out, int numThreads)
+{
+   return parallelDumpChunks(set, numThreads,
+                             [out](const char* text, size_t length)
+   {
+      return fwrite(text, 1, length, out) == length;
+   });
+}
+
+bool parallelDumpIntSet(const IntSet& set, int fd, int numThreads)
+{
+   return parallelDumpChunks(set, numThreads,
+                             [fd](const char* text, size_t length)
+   {
+      return writeAll(fd, text, length);
+   });
+}
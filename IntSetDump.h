@@ -0,0 +1,74 @@
+// FILE: IntSetDump.h - fast text output of IntSet elements
+//
+// These functions write exactly the bytes IntSet::DumpData does (the
+// elements in insertion order, separated by two spaces, with nothing
+// before the first or after the last), but format the integers with a
+// table-driven conversion (two digits per step) into a large buffer
+// and hand it to the destination in DUMP_CHUNK_BYTES chunks, instead
+// of going through the stream's locale-aware operator<< per element.
+// DumpData itself is left as it is, since it honours the stream's
+// formatting state (e.g. std::hex), which these functions ignore.
+//
+// CONSTANTS
+//   DUMP_CHUNK_BYTES     size of the output buffer
+//   MAX_INT_CHARS        most chars one int takes ("-2147483648")
+//   PARALLEL_DUMP_ELEMENTS  elements formatted per task by the
+//                        parallel versions
+//
+// FUNCTIONS PROVIDED:
+//   char* formatInt(int value, char* out)
+//     Pre:  out has room for MAX_INT_CHARS chars.
+//     Post: The decimal form of value has been written at out (no
+//           terminating '\0') and the position just past it is
+//           returned.
+//   std::size_t formatInts(const int* values, int n, char* out,
+//                          bool leadingSeparator)
+//     Pre:  out has room for n * (MAX_INT_CHARS + 2) chars.
+//     Post: values[0..n) have been written to out in DumpData's
+//           format (preceded by the separator if leadingSeparator is
+//           true and n > 0) and the number of chars written is
+//           returned.
+//   bool dumpIntSet(const IntSet& set, std::ostream& out)
+//   bool dumpIntSet(const IntSet& set, std::FILE* out)
+//   bool dumpIntSet(const IntSet& set, int fd)
+//     Post: The same bytes as set.DumpData would produce have been
+//           written to out (or to the file descriptor fd); true is
+//           returned unless a write failed.
+//   bool parallelDumpIntSet(const IntSet& set, std::ostream& out,
+//                           int numThreads = 0)
+//   bool parallelDumpIntSet(const IntSet& set, std::FILE* out,
+//                           int numThreads = 0)
+//   bool parallelDumpIntSet(const IntSet& set, int fd,
+//                           int numThreads = 0)
+//     Post: As for dumpIntSet, but up to numThreads threads (one per
+//           hardware thread if numThreads <= 0) format consecutive
+//           pieces of PARALLEL_DUMP_ELEMENTS elements at once; the
+//           pieces are written in order, so the bytes are the same.
+//           Sets of at most PARALLEL_DUMP_ELEMENTS elements are
+//           formatted on the calling thread only.
+
+#ifndef INT_SET_DUMP_H
+#define INT_SET_DUMP_H
+
+#include "IntSet.h"
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+
+const std::size_t DUMP_CHUNK_BYTES = 1 << 16;
+const int MAX_INT_CHARS = 11;
+const int PARALLEL_DUMP_ELEMENTS = 1 << 16;
+
+char* formatInt(int value, char* out);
+std::size_t formatInts(const int* values, int n, char* out,
+                       bool leadingSeparator);
+bool dumpIntSet(const IntSet& set, std::ostream& out);
+bool dumpIntSet(const IntSet& set, std::FILE* out);
+bool dumpIntSet(const IntSet& set, int fd);
+bool parallelDumpIntSet(const IntSet& set, std::ostream& out,
+                        int numThreads = 0);
+bool parallelDumpIntSet(const IntSet& set, std::FILE* out,
+                        int numThreads = 0);
+bool parallelDumpIntSet(const IntSet& set, int fd, int numThreads = 0);
+
+#endif
@@ -0,0 +1,493 @@
+// FILE: IntSetFile.cpp
+//       Implementation file for the IntSet binary format
+//       (See IntSetFile.h for documentation.)
+
+#include "IntSetFile.h"
+#include "SetKernels.h"
+#include "PackedInts.h"
+#include "IntIndex.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+static_assert(sizeof(IntSetFileHeader) == 48, "header layout changed");
+
+namespace
+{
+   const char MAGIC[4] = { 'I', 'S', 'E', 'T' };
+
+   //what a stream read allocates at a time before the stream has
+   //shown that the payload its header claims is really there
+   const size_t READ_CHUNK_BYTES = 1 << 20;
+
+   //offset of the index in an INTSET_FILE_INDEXED payload: the
+   //elements, padded to a multiple of 8 bytes
+   uint64_t indexOffset(uint32_t count)
+   {
+      return (uint64_t(count) * sizeof(int32_t) + 7) & ~uint64_t(7);
+   }
+
+   //true if slotCount n and the word after it, which open the index
+   //of an INTSET_FILE_INDEXED payload, are laid out as h requires
+   bool indexLayoutFits(const IntSetFileHeader& h, uint32_t n, uint32_t zero)
+   {
+      return n != 0 && (n & (n - 1)) == 0 && uint64_t(n) >= 2 * uint64_t(h.count)
+             && zero == 0
+             && h.payloadBytes
+                == indexOffset(h.count) + (2 + uint64_t(n)) * sizeof(uint32_t);
+   }
+
+   //everything about h that does not depend on the file length
+   bool headerIsValid(const IntSetFileHeader& h)
+   {
+      return memcmp(h.magic, MAGIC, sizeof MAGIC) == 0
+             && h.byteOrder == INTSET_FILE_BYTE_ORDER
+             && h.version == INTSET_FILE_VERSION
+             && (h.flags & ~unsigned(INTSET_FILE_KNOWN_FLAGS)) == 0
+             && h.count <= uint32_t(INT32_MAX)
+             && ((h.flags & INTSET_FILE_PACKED)
+                 ? !(h.flags & INTSET_FILE_INDEXED)
+                   && h.payloadBytes % sizeof(uint32_t) == 0
+                   && h.payloadBytes >= sizeof(uint32_t)
+                 : (h.flags & INTSET_FILE_INDEXED)
+                 ? h.payloadBytes % sizeof(uint32_t) == 0
+                   && h.payloadBytes >= indexOffset(h.count) + 2 * sizeof(uint32_t)
+                 : h.payloadBytes == uint64_t(h.count) * sizeof(int32_t));
+   }
+
+   //the most elements an index can cover: slotCount is a 32-bit power
+   //of 2 at least twice the count
+   const int MAX_INDEXED_COUNT = 1 << 30;
+
+   //the index part of an INTSET_FILE_INDEXED payload for values[0..count):
+   //padding, slotCount, a zero word and the slots (see IntSetFile.h)
+   //Pre: count <= MAX_INDEXED_COUNT
+   vector<int32_t> buildIndex(const int* values, int count)
+   {
+      uint32_t slotCount = 16;
+      while (uint64_t(slotCount) < 2 * uint64_t(count))
+         slotCount <<= 1;
+      size_t pad = size_t(count % 2);
+      vector<int32_t> index(pad + 2 + slotCount, 0);
+      index[pad] = int32_t(slotCount);
+
+      int32_t* slots = &index[pad + 2];
+      uint32_t mask = slotCount - 1;
+      for (int p = 0; p < count; ++p)
+      {
+         uint32_t j = IntIndex::hash(values[p]) & mask;
+         while (slots[j] != 0)
+            j = (j + 1) & mask;
+         slots[j] = p + 1;
+      }
+      return index;
+   }
+
+   //header for count elements in [lo, hi] and a payload of the given
+   //length (checksum filled in from payload when flags ask for it)
+   IntSetFileHeader makeHeader(unsigned flags, int count, int lo, int hi,
+                               const void* payload, size_t bytes)
+   {
+      IntSetFileHeader h;
+      fillIntSetHeader(h, flags, count, lo, hi, bytes);
+      if (flags & INTSET_FILE_CHECKSUM)
+         h.checksum = intSetChecksum(payload, bytes);
+      return h;
+   }
+
+   bool writeFile(ostream& out, const IntSetFileHeader& h, const void* payload)
+   {
+      out.write(reinterpret_cast<const char*>(&h), sizeof h);
+      out.write(static_cast<const char*>(payload), streamsize(h.payloadBytes));
+      return bool(out);
+   }
+
+   bool readHeader(istream& in, IntSetFileHeader& h)
+   {
+      return in.read(reinterpret_cast<char*>(&h), sizeof h) && headerIsValid(h);
+   }
+
+   //whether in is known to hold at least bytes more bytes; false if
+   //it holds fewer or cannot tell (a pipe, say), so a caller never
+   //sizes an allocation by a header the data has not backed up
+   bool streamHolds(istream& in, uint64_t bytes)
+   {
+      streampos at = in.tellg();
+      if (at == streampos(-1))
+      {
+         in.clear();
+         return false;
+      }
+      in.seekg(0, ios::end);
+      streampos end = in.tellg();
+      in.clear();
+      in.seekg(at);
+      return end != streampos(-1) && end >= at && uint64_t(end - at) >= bytes;
+   }
+
+   //reads n elements of Item into a new array of room >= n (and >= 1)
+   //items; unless the stream's length has vouched for them
+   //(lengthKnown) the array starts at READ_CHUNK_BYTES and doubles as
+   //data arrives, so a damaged count fails at the end of the data
+   //rather than in the allocator
+   template <class Item>
+   bool readArray(istream& in, size_t n, bool lengthKnown,
+                  unique_ptr<Item[]>& array, size_t& room)
+   {
+      const size_t chunk = READ_CHUNK_BYTES / sizeof(Item);
+      room = max<size_t>(lengthKnown ? n : min(n, chunk), 1);
+      array.reset(new Item[room]);
+      size_t have = 0;
+      while (have < n)
+      {
+         if (have == room)
+         {
+            size_t grown = min(n, 2 * room);
+            unique_ptr<Item[]> bigger(new Item[grown]);
+            copy(array.get(), array.get() + have, bigger.get());
+            array.swap(bigger);
+            room = grown;
+         }
+         size_t step = min(n, room) - have;
+         if (!in.read(reinterpret_cast<char*>(array.get() + have),
+                      streamsize(step * sizeof(Item))))
+            return false;
+         have += step;
+      }
+      return true;
+   }
+
+   //feeds the next bytes of in through the checksum a fixed-size
+   //buffer at a time
+   bool checksumStream(istream& in, uint64_t bytes, unsigned long long& sum)
+   {
+      char buffer[1 << 16];
+      while (bytes > 0)
+      {
+         size_t step = size_t(min<uint64_t>(bytes, sizeof buffer));
+         if (!in.read(buffer, streamsize(step)))
+            return false;
+         sum = intSetChecksum(buffer, step, sum);
+         bytes -= step;
+      }
+      return true;
+   }
+
+   //whether values[0..h.count) can be adopted: distinct, strictly
+   //ascending if the header says so, and spanning exactly the
+   //header's [minValue, maxValue]; adopt() itself trusts its input,
+   //and a checksum only proves the bytes are the ones written
+   bool payloadIsConsistent(const IntSetFileHeader& h, const int* values)
+   {
+      int count = int(h.count);
+      if (count == 0)
+         return true;
+      int lo, hi;
+      valueRange(values, count, lo, hi);
+      if (lo != h.minValue || hi != h.maxValue)
+         return false;
+      if (h.flags & INTSET_FILE_ASCENDING)
+         return adjacent_find(values, values + count, greater_equal<int>())
+                == values + count;
+      IntIndex seen;
+      seen.rebind(values);
+      for (int i = 0; i < count; ++i)
+         if (!seen.insert(i))
+            return false;
+      return true;
+   }
+
+   //reads a raw (unpacked) payload, index and all, straight into the
+   //array an IntSet then adopts; of the index only the layout is
+   //checked, the slots are only run through the checksum
+   bool readRaw(istream& in, const IntSetFileHeader& h, IntSet& set)
+   {
+      size_t count = h.count;
+      size_t elementBytes = count * sizeof(int32_t);
+      unique_ptr<int[]> buffer;
+      size_t room;
+      if (!readArray(in, count, streamHolds(in, h.payloadBytes), buffer, room))
+         return false;
+      unsigned long long sum = intSetChecksum(buffer.get(), elementBytes);
+      uint64_t rest = h.payloadBytes - elementBytes;
+      if (h.flags & INTSET_FILE_INDEXED)
+      {
+         //padding (if any), slotCount and the zero word
+         uint32_t words[3];
+         size_t lead = size_t(indexOffset(h.count) - elementBytes)
+                       + 2 * sizeof(uint32_t);
+         char* at = reinterpret_cast<char*>(words);
+         if (!in.read(at, streamsize(lead)))
+            return false;
+         sum = intSetChecksum(at, lead, sum);
+         size_t n = lead / sizeof(uint32_t);
+         if (!indexLayoutFits(h, words[n - 2], words[n - 1]))
+            return false;
+         rest -= lead;
+      }
+      if (!checksumStream(in, rest, sum)
+          || ((h.flags & INTSET_FILE_CHECKSUM) && sum != h.checksum)
+          || !payloadIsConsistent(h, buffer.get()))
+         return false;
+      IntSet loaded = IntSet::adopt(std::move(buffer), int(count), int(room));
+      set.swap(loaded);
+      return true;
+   }
+
+   //reads a packed payload into set, checking the encoding
+   bool loadCompressedPayload(istream& in, const IntSetFileHeader& h,
+                              CompressedIntSet& set)
+   {
+      size_t numWords = size_t(h.payloadBytes / sizeof(uint32_t));
+      unique_ptr<uint32_t[]> words;
+      size_t room;
+      return readArray(in, numWords, streamHolds(in, h.payloadBytes), words, room)
+             && (!(h.flags & INTSET_FILE_CHECKSUM)
+                 || intSetChecksum(words.get(), size_t(h.payloadBytes)) == h.checksum)
+             && set.assignEncoded(words.get(), numWords, int(h.count));
+   }
+}
+
+void fillIntSetHeader(IntSetFileHeader& header, unsigned flags, int count,
+                      int minValue, int maxValue, uint64_t payloadBytes)
+{
+   memset(&header, 0, sizeof header);
+   memcpy(header.magic, MAGIC, sizeof MAGIC);
+   header.byteOrder = INTSET_FILE_BYTE_ORDER;
+   header.version = INTSET_FILE_VERSION;
+   header.flags = uint16_t(flags);
+   header.count = uint32_t(count);
+   header.minValue = count > 0 ? minValue : 0;
+   header.maxValue = count > 0 ? maxValue : 0;
+   header.payloadBytes = payloadBytes;
+}
+
+unsigned long long intSetChecksum(const void* bytes, size_t length,
+                                  unsigned long long seed)
+{
+   const unsigned char* p = static_cast<const unsigned char*>(bytes);
+   unsigned long long h = seed;
+   for (size_t i = 0; i < length; ++i)
+   {
+      h ^= p[i];
+      h *= 0x100000001B3ULL;
+   }
+   return h;
+}
+
+bool checkIntSetIndex(const IntSetFileHeader& header, const void* payload,
+                      const int32_t*& slots, uint32_t& slotCount)
+{
+   if (!(header.flags & INTSET_FILE_INDEXED))
+      return false;
+   uint64_t offset = indexOffset(header.count);
+   const uint32_t* at = reinterpret_cast<const uint32_t*>(
+      static_cast<const char*>(payload) + offset);
+   if (!indexLayoutFits(header, at[0], at[1]))
+      return false;
+   slots = reinterpret_cast<const int32_t*>(at + 2);
+   slotCount = at[0];
+   return true;
+}
+
+bool checkIntSetHeader(const void* bytes, size_t length,
+                       IntSetFileHeader& header)
+{
+   if (length < sizeof(IntSetFileHeader))
+      return false;
+   IntSetFileHeader h;
+   memcpy(&h, bytes, sizeof h);
+   if (!headerIsValid(h) || h.payloadBytes > length - sizeof h)
+      return false;
+   header = h;
+   return true;
+}
+
+bool saveIntSet(const IntSet& set, ostream& out, unsigned flags)
+{
+   flags &= INTSET_FILE_CHECKSUM | INTSET_FILE_PACKED | INTSET_FILE_INDEXED;
+   if ((flags & INTSET_FILE_PACKED) || set.size() > MAX_INDEXED_COUNT)
+      flags &= ~unsigned(INTSET_FILE_INDEXED);
+   int lo = 0, hi = 0;
+   if (set.size() > 0)
+      valueRange(set.begin(), set.size(), lo, hi);
+
+   if (flags & INTSET_FILE_PACKED)
+   {
+      vector<int> sorted(set.begin(), set.end());
+      sort(sorted.begin(), sorted.end());
+      vector<uint32_t> words;
+      packSortedInts(sorted.empty() ? 0 : &sorted[0], set.size(), words);
+      IntSetFileHeader h = makeHeader(flags | INTSET_FILE_ASCENDING, set.size(),
+                                      lo, hi, &words[0],
+                                      words.size() * sizeof(uint32_t));
+      return writeFile(out, h, &words[0]);
+   }
+
+   if (adjacent_find(set.begin(), set.end(), greater_equal<int>()) == set.end())
+      flags |= INTSET_FILE_ASCENDING;
+   size_t elementBytes = set.size() * sizeof(int32_t);
+   if (!(flags & INTSET_FILE_INDEXED))
+   {
+      IntSetFileHeader h = makeHeader(flags, set.size(), lo, hi, set.begin(),
+                                      elementBytes);
+      return writeFile(out, h, set.begin());
+   }
+
+   //the elements, then the index, as one checksummed payload
+   vector<int32_t> index = buildIndex(set.begin(), set.size());
+   size_t indexBytes = index.size() * sizeof(int32_t);
+   IntSetFileHeader h;
+   fillIntSetHeader(h, flags, set.size(), lo, hi, elementBytes + indexBytes);
+   if (flags & INTSET_FILE_CHECKSUM)
+      h.checksum = intSetChecksum(&index[0], indexBytes,
+                                  intSetChecksum(set.begin(), elementBytes));
+   out.write(reinterpret_cast<const char*>(&h), sizeof h);
+   out.write(reinterpret_cast<const char*>(set.begin()), streamsize(elementBytes));
+   out.write(reinterpret_cast<const char*>(&index[0]), streamsize(indexBytes));
+   return bool(out);
+}
+
+bool saveIntSet(const IntSet& set, const char* path, unsigned flags)
+{
+   ofstream out(path, ios::binary | ios::trunc);
+   return out && saveIntSet(set, out, flags) && out.flush();
+}
+
+bool loadIntSet(istream& in, IntSet& set)
+{
+   IntSetFileHeader h;
+   if (!readHeader(in, h))
+      return false;
+   if (!(h.flags & INTSET_FILE_PACKED))
+      return readRaw(in, h, set);
+
+   //decode through a CompressedIntSet, which checks the encoding
+   CompressedIntSet packed;
+   if (!loadCompressedPayload(in, h, packed))
+      return false;
+   IntSet loaded = packed.toIntSet();
+   set.swap(loaded);
+   return true;
+}
+
+bool loadIntSet(const char* path, IntSet& set)
+{
+   ifstream in(path, ios::binary);
+   return in && loadIntSet(in, set);
+}
+
+bool decodeIntSet(const void* bytes, size_t length, IntSet& set)
+{
+   IntSetFileHeader h;
+   if (!checkIntSetHeader(bytes, length, h))
+      return false;
+   const char* payload = static_cast<const char*>(bytes) + sizeof h;
+   if ((h.flags & INTSET_FILE_CHECKSUM)
+       && intSetChecksum(payload, size_t(h.payloadBytes)) != h.checksum)
+      return false;
+
+   if (h.flags & INTSET_FILE_PACKED)
+   {
+      //copied out, since bytes need not be aligned
+      vector<uint32_t> words(size_t(h.payloadBytes / sizeof(uint32_t)));
+      memcpy(&words[0], payload, size_t(h.payloadBytes));
+      CompressedIntSet packed;
+      if (!packed.assignEncoded(&words[0], words.size(), int(h.count)))
+         return false;
+      IntSet loaded = packed.toIntSet();
+      set.swap(loaded);
+      return true;
+   }
+
+   //a stored index (INTSET_FILE_INDEXED) is left behind once its
+   //layout is checked; length has already vouched for count
+   if (h.flags & INTSET_FILE_INDEXED)
+   {
+      uint32_t words[2];
+      memcpy(words, payload + indexOffset(h.count), sizeof words);
+      if (!indexLayoutFits(h, words[0], words[1]))
+         return false;
+   }
+   int count = int(h.count);
+   int room = count > 0 ? count : 1;
+   unique_ptr<int[]> buffer(new int[room]);
+   memcpy(buffer.get(), payload, size_t(count) * sizeof(int32_t));
+   if (!payloadIsConsistent(h, buffer.get()))
+      return false;
+   IntSet loaded = IntSet::adopt(std::move(buffer), count, room);
+   set.swap(loaded);
+   return true;
+}
+
+bool saveCompressedIntSet(const CompressedIntSet& set, ostream& out,
+                          unsigned flags)
+{
+   //the encoding is written as is
+   flags = (flags & INTSET_FILE_CHECKSUM) | INTSET_FILE_PACKED | INTSET_FILE_ASCENDING;
+   const vector<uint32_t>& words = set.encoded();
+   int lo = 0, hi = 0, at = 0;
+   set.forEach([&](int x) { hi = x; if (at++ == 0) lo = x; });
+   IntSetFileHeader h = makeHeader(flags, set.size(), lo, hi, &words[0],
+                                   words.size() * sizeof(uint32_t));
+   return writeFile(out, h, &words[0]);
+}
+
+bool saveCompressedIntSet(const CompressedIntSet& set, const char* path,
+                          unsigned flags)
+{
+   ofstream out(path, ios::binary | ios::trunc);
+   return out && saveCompressedIntSet(set, out, flags) && out.flush();
+}
+
+bool loadCompressedIntSet(istream& in, CompressedIntSet& set)
+{
+   IntSetFileHeader h;
+   if (!readHeader(in, h))
+      return false;
+   if (h.flags & INTSET_FILE_PACKED)
+      return loadCompressedPayload(in, h, set);
+
+   //a raw file is packed on the way in
+   IntSet loaded;
+   if (!readRaw(in, h, loaded))
+      return false;
+   set = CompressedIntSet(loaded);
+   return true;
+}
+
+bool loadCompressedIntSet(const char* path, CompressedIntSet& set)
+{
+   ifstream in(path, ios::binary);
+   return in && loadCompressedIntSet(in, set);
+}
+
+bool syncPath(const char* path)
+{
+   //Linux syncs the file's data whichever descriptor wrote it
+   int fd = open(path, O_RDONLY);
+   if (fd < 0)
+      return false;
+   bool ok = fsync(fd) == 0;
+   close(fd);
+   return ok;
+}
+
+bool syncParent(const char* path)
+{
+   string name = path;
+   size_t slash = name.rfind('/');
+   string dir = slash == string::npos ? string(".")
+                : slash == 0 ? string("/") : name.substr(0, slash);
+   int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+   if (fd < 0)
+      return false;
+   bool ok = fsync(fd) == 0;
+   close(fd);
+   return ok;
+}
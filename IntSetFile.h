@@ -0,0 +1,200 @@
+// FILE: IntSetFile.h - binary on-disk format for IntSet
+//
+// An IntSet is stored as a fixed 48-byte header followed by its
+// payload. The payload starts 8-byte aligned, so a file mapped into
+// memory (see MappedIntSet.h) can be read in place.
+//
+// HEADER (all fields in host byte order)
+//   offset  size  field
+//        0     4  magic         "ISET"
+//        4     4  byteOrder     0x01020304 as written by the host
+//        8     2  version       INTSET_FILE_VERSION
+//       10     2  flags         INTSET_FILE_xxx bits, see below
+//       12     4  count         number of elements
+//       16     4  minValue      smallest element (0 if count is 0)
+//       20     4  maxValue      largest element (0 if count is 0)
+//       24     8  payloadBytes  length of the payload
+//       32     8  checksum      FNV-1a of the payload (0 unless
+//                               INTSET_FILE_CHECKSUM)
+//       40     8  reserved      0
+//   A reader rejects a file whose magic, byteOrder or version it does
+//   not know, so files move freely between hosts of the same byte
+//   order and are refused (not misread) elsewhere.
+//
+// FLAGS
+//   INTSET_FILE_CHECKSUM   checksum holds the payload's checksum
+//   INTSET_FILE_ASCENDING  the elements are in strictly ascending
+//                          order (readers may binary-search them)
+//   INTSET_FILE_PACKED     the payload is bit-packed (see below)
+//   INTSET_FILE_INDEXED    a hash index of the elements follows them in
+//                          the payload (see below); never with
+//                          INTSET_FILE_PACKED
+//   A reader rejects a file with flags it does not know.
+//
+// PAYLOAD
+//   Unless INTSET_FILE_PACKED: count 32-bit ints, the elements in
+//   insertion order.
+//   With INTSET_FILE_PACKED: the elements in ascending order, encoded
+//   as described in PackedInts.h (payloadBytes / 4 words); insertion
+//   order is not kept. INTSET_FILE_ASCENDING is always set too.
+//   With INTSET_FILE_INDEXED: the count ints, 4 zero bytes if count is
+//   odd (so what follows is 8-byte aligned), slotCount (4 bytes, a
+//   power of 2 at least 2 * count), 4 zero bytes, then slotCount
+//   32-bit slots: an open-addressing table (linear probing from
+//   IntIndex::hash(value) & (slotCount - 1)) in which 0 is an empty
+//   slot and k stands for the element at position k - 1. The table
+//   holds positions, not addresses, so a mapped file can probe it
+//   where it lies; changing IntIndex::hash therefore changes the
+//   format. The checksum covers the whole payload, index included.
+//
+// TYPES
+//   struct IntSetFileHeader
+//     The header as laid out above.
+//
+// FUNCTIONS PROVIDED:
+//   bool saveIntSet(const IntSet& set, std::ostream& out,
+//                   unsigned flags = INTSET_FILE_CHECKSUM)
+//   bool saveIntSet(const IntSet& set, const char* path,
+//                   unsigned flags = INTSET_FILE_CHECKSUM)
+//     Post: set has been written to out (or to the file at path,
+//           replacing it); flags may hold INTSET_FILE_CHECKSUM,
+//           INTSET_FILE_PACKED and INTSET_FILE_INDEXED (which is
+//           dropped along with PACKED, and for a set of more than
+//           2^30 elements, whose slotCount would not fit in 32 bits;
+//           INTSET_FILE_ASCENDING is worked out from set). true is
+//           returned on success, false if writing failed.
+//   bool loadIntSet(std::istream& in, IntSet& set)
+//   bool loadIntSet(const char* path, IntSet& set)
+//     Post: If a valid IntSet file could be read (and its checksum,
+//           when it has one, matches), set holds its elements in the
+//           stored order and true is returned; otherwise set is
+//           unchanged and false is returned.
+//     Note: A raw payload is read straight into the array the IntSet
+//           adopts (see IntSet::adopt): no per-element add(). A
+//           packed payload is decoded block by block into that array
+//           (the IntSet is then in ascending order). A stored index
+//           is checksummed and its layout checked (a file
+//           MappedIntSet would refuse is refused here too), but its
+//           slots are not used: IntSet builds its own index.
+//     Note: Nothing in the header is taken on trust. Unless the
+//           stream's length shows the payload is all there, the
+//           array grows with the data actually read, so a damaged
+//           count or payloadBytes makes the load fail rather than
+//           allocate gigabytes. Before a raw payload is adopted its
+//           elements are checked to be distinct, strictly ascending
+//           if INTSET_FILE_ASCENDING says so, and to span exactly
+//           [minValue, maxValue] (an O(count) pass with a temporary
+//           hash index); a file failing that is rejected even with a
+//           matching checksum.
+//   bool decodeIntSet(const void* bytes, std::size_t length, IntSet& set)
+//     Post: As for loadIntSet, reading the file from the length bytes
+//           at bytes (which may go on past its end) instead of from a
+//           stream; the same checks are made.
+//   bool saveCompressedIntSet(const CompressedIntSet& set,
+//                             std::ostream& out,
+//                             unsigned flags = INTSET_FILE_CHECKSUM)
+//   bool saveCompressedIntSet(const CompressedIntSet& set,
+//                             const char* path,
+//                             unsigned flags = INTSET_FILE_CHECKSUM)
+//     Post: As for saveIntSet with INTSET_FILE_PACKED; the encoding
+//           set already holds is written as is.
+//   bool loadCompressedIntSet(std::istream& in, CompressedIntSet& set)
+//   bool loadCompressedIntSet(const char* path, CompressedIntSet& set)
+//     Post: As for loadIntSet, but the elements stay encoded: a packed
+//           payload is checked and kept as is, a raw one is packed.
+//   bool checkIntSetHeader(const void* bytes, std::size_t length,
+//                          IntSetFileHeader& header)
+//     Post: true is returned if the first length bytes at bytes start
+//           with a valid header whose payload fits in length bytes;
+//           the header is then copied to header.
+//   bool checkIntSetIndex(const IntSetFileHeader& header,
+//                         const void* payload, const std::int32_t*& slots,
+//                         std::uint32_t& slotCount)
+//     Pre:  header is valid (see checkIntSetHeader) and payload points
+//           at its whole payload, 4-byte aligned.
+//     Post: If header has INTSET_FILE_INDEXED and the index in payload
+//           is laid out as above, slots points at its table inside
+//           payload, slotCount holds its size and true is returned;
+//           otherwise false is returned. The slots themselves are not
+//           read (see the checksum for that).
+//   void fillIntSetHeader(IntSetFileHeader& header, unsigned flags,
+//                         int count, int minValue, int maxValue,
+//                         std::uint64_t payloadBytes)
+//     Post: header is a header with the given fields (minValue and
+//           maxValue 0 if count is 0) and a zero checksum, for writers
+//           that produce the payload themselves.
+//   unsigned long long intSetChecksum(const void* bytes,
+//                          std::size_t length,
+//                          unsigned long long seed = INTSET_CHECKSUM_SEED)
+//     Post: The 64-bit FNV-1a hash of the length bytes is returned,
+//           starting from seed; passing the hash of the bytes before
+//           them as seed continues that hash.
+//   bool syncPath(const char* path)
+//     Post: The file at path has been fsynced (through a descriptor of
+//           its own); false is returned if that failed.
+//   bool syncParent(const char* path)
+//     Post: The directory holding path has been fsynced, making a
+//           rename or unlink of path durable; false is returned if
+//           that failed.
+
+#ifndef INT_SET_FILE_H
+#define INT_SET_FILE_H
+
+#include "IntSet.h"
+#include "CompressedIntSet.h"
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+const std::uint16_t INTSET_FILE_VERSION = 1;
+const std::uint32_t INTSET_FILE_BYTE_ORDER = 0x01020304u;
+const unsigned long long INTSET_CHECKSUM_SEED = 0xCBF29CE484222325ULL;
+
+enum IntSetFileFlags
+{
+   INTSET_FILE_CHECKSUM = 1,
+   INTSET_FILE_ASCENDING = 2,
+   INTSET_FILE_PACKED = 4,
+   INTSET_FILE_INDEXED = 8,
+   INTSET_FILE_KNOWN_FLAGS = 15
+};
+
+struct IntSetFileHeader
+{
+   char          magic[4];
+   std::uint32_t byteOrder;
+   std::uint16_t version;
+   std::uint16_t flags;
+   std::uint32_t count;
+   std::int32_t  minValue;
+   std::int32_t  maxValue;
+   std::uint64_t payloadBytes;
+   std::uint64_t checksum;
+   std::uint64_t reserved;
+};
+
+bool saveIntSet(const IntSet& set, std::ostream& out,
+                unsigned flags = INTSET_FILE_CHECKSUM);
+bool saveIntSet(const IntSet& set, const char* path,
+                unsigned flags = INTSET_FILE_CHECKSUM);
+bool loadIntSet(std::istream& in, IntSet& set);
+bool loadIntSet(const char* path, IntSet& set);
+bool decodeIntSet(const void* bytes, std::size_t length, IntSet& set);
+bool saveCompressedIntSet(const CompressedIntSet& set, std::ostream& out,
+                          unsigned flags = INTSET_FILE_CHECKSUM);
+bool saveCompressedIntSet(const CompressedIntSet& set, const char* path,
+                          unsigned flags = INTSET_FILE_CHECKSUM);
+bool loadCompressedIntSet(std::istream& in, CompressedIntSet& set);
+bool loadCompressedIntSet(const char* path, CompressedIntSet& set);
+bool checkIntSetHeader(const void* bytes, std::size_t length,
+                       IntSetFileHeader& header);
+bool checkIntSetIndex(const IntSetFileHeader& header, const void* payload,
+                      const std::int32_t*& slots, std::uint32_t& slotCount);
+void fillIntSetHeader(IntSetFileHeader& header, unsigned flags, int count,
+                      int minValue, int maxValue, std::uint64_t payloadBytes);
+unsigned long long intSetChecksum(const void* bytes, std::size_t length,
+                                  unsigned long long seed = INTSET_CHECKSUM_SEED);
+bool syncPath(const char* path);
+bool syncParent(const char* path);
+
+#endif
@@ -0,0 +1,324 @@
+// FILE: IntSetParallel.cpp
+//       Implementation file for the parallel set algebra member
+//       functions of the IntSet class
+//       (See IntSet.h for documentation and IntSet.cpp for the class
+//       invariant.)
+//
+// DOCUMENTATION for private member (helper) function:
+//   static IntSet parallelFilter(const IntSet* prefix,
+//                                const IntSet& probe,
+//                                const IntSet& indexed, bool keepFound,
+//                                int numThreads)
+//     Pre:  No element of probe that is kept also occurs in *prefix.
+//     Post: Returned is an IntSet holding the elements of *prefix (if
+//           prefix is not 0) followed, in probe's order, by those
+//           elements x of probe for which indexed.contains(x) ==
+//           keepFound.
+//     Note: indexed is hash-partitioned into buckets indexed in
+//           parallel (see PartitionedIndex below), probe is filtered
+//           in parallel slices, and the prefix and the survivors are
+//           copied into the result in parallel.
+//   void parallelRecomputeStats(int numThreads)
+//     Post: As recomputeStats, but slices of the elements are summed
+//           and scanned in parallel.
+//   const int* sortedView(std::vector<int>& scratch) const
+//     Post: A pointer to the elements of the invoking IntSet in
+//           ascending order is returned: data itself if the
+//           ascending statistic says it is already ascending (O(1)),
+//           otherwise a sorted copy placed in scratch.
+
+#include "IntSet.h"
+#include "IntIndex.h"
+#include "MergePath.h"
+#include "Parallel.h"
+#include "SetKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+using namespace std;
+
+namespace
+{
+   //number of slices to cut n probe elements into: a few per thread
+   //for load balance, but none smaller than PARALLEL_GRAIN
+   int sliceCount(int n, int threads)
+   {
+      int slices = n / IntSet::PARALLEL_GRAIN;
+      if (slices > 4 * threads)
+         slices = 4 * threads;
+      return slices < 1 ? 1 : slices;
+   }
+
+   //most buckets a PartitionedIndex splits its values into
+   const int MAX_BUCKETS = 256;
+
+   //an index of values[0..n) built by several threads: the values are
+   //split into buckets by the top bits of IntIndex::hash (the bucket
+   //IntIndexes use the low bits), gathered bucket by bucket and each
+   //bucket indexed on its own
+   class PartitionedIndex
+   {
+   public:
+      PartitionedIndex(const int* values, int n, int threads);
+      bool contains(int value) const
+      {
+         return indexes[bucketOf(value)].contains(value);
+      }
+
+   private:
+      int bits;                          // log2 of the bucket count
+      vector<int> grouped;               // the values, bucket by bucket
+      unique_ptr<IntIndex[]> indexes;    // one per bucket
+
+      PartitionedIndex(const PartitionedIndex&);
+      PartitionedIndex& operator=(const PartitionedIndex&);
+      int bucketOf(int value) const
+      {
+         return bits == 0 ? 0 : int(IntIndex::hash(value) >> (32 - bits));
+      }
+   };
+
+   PartitionedIndex::PartitionedIndex(const int* values, int n, int threads)
+      : bits(0)
+   {
+      if (threads > 1 && n >= 2 * IntSet::PARALLEL_GRAIN)
+         while ((1 << bits) < 4 * threads && (1 << bits) < MAX_BUCKETS)
+            ++bits;
+      int buckets = 1 << bits;
+      indexes.reset(new IntIndex[buckets]);
+      if (buckets == 1)
+      {
+         indexes[0].build(values, n);
+         return;
+      }
+
+      //count each slice's values per bucket, turn the counts into the
+      //positions where each slice's run of each bucket starts, then
+      //scatter: every bucket ends up contiguous in grouped
+      int slices = sliceCount(n, threads);
+      vector<int> at(size_t(slices) * buckets, 0);
+      parallelFor(slices, threads, [&](int s)
+      {
+         int first, last;
+         splitRange(n, slices, s, first, last);
+         int* count = &at[size_t(s) * buckets];
+         for (int i = first; i < last; ++i)
+            ++count[bucketOf(values[i])];
+      });
+      vector<int> start(buckets + 1);
+      int total = 0;
+      for (int b = 0; b < buckets; ++b)
+      {
+         start[b] = total;
+         for (int s = 0; s < slices; ++s)
+         {
+            int count = at[size_t(s) * buckets + b];
+            at[size_t(s) * buckets + b] = total;
+            total += count;
+         }
+      }
+      start[buckets] = total;
+
+      grouped.resize(n);
+      parallelFor(slices, threads, [&](int s)
+      {
+         int first, last;
+         splitRange(n, slices, s, first, last);
+         int* next = &at[size_t(s) * buckets];
+         for (int i = first; i < last; ++i)
+            grouped[next[bucketOf(values[i])]++] = values[i];
+      });
+      parallelFor(buckets, threads, [&](int b)
+      {
+         indexes[b].build(grouped.data() + start[b], start[b + 1] - start[b]);
+      });
+   }
+}
+
+IntSet IntSet::parallelFilter(const IntSet* prefix, const IntSet& probe,
+                              const IntSet& indexed, bool keepFound,
+                              int numThreads)
+{
+   int threads = resolveThreads(numThreads);
+   PartitionedIndex index(indexed.data, indexed.used, threads);
+
+   //each slice collects its survivors privately, in order
+   int slices = sliceCount(probe.used, threads);
+   vector< vector<int> > kept(slices);
+   parallelFor(slices, threads, [&](int s)
+   {
+      int first, last;
+      splitRange(probe.used, slices, s, first, last);
+      for (int i = first; i < last; ++i)
+         if (index.contains(probe.data[i]) == keepFound)
+            kept[s].push_back(probe.data[i]);
+   });
+
+   //the prefix (in slices of its own) and the survivors of each slice
+   //are copied to their places in an exactly sized result at once
+   int prefixUsed = prefix ? prefix->used : 0;
+   int prefixSlices = prefix ? sliceCount(prefixUsed, threads) : 0;
+   vector<int> offset(slices + 1);
+   offset[0] = prefixUsed;
+   for (int s = 0; s < slices; ++s)
+      offset[s + 1] = offset[s] + int(kept[s].size());
+   IntSet result(offset[slices]);
+   parallelFor(prefixSlices + slices, threads, [&](int t)
+   {
+      if (t < prefixSlices)
+      {
+         int first, last;
+         splitRange(prefixUsed, prefixSlices, t, first, last);
+         copy(prefix->data + first, prefix->data + last, result.data + first);
+      }
+      else
+      {
+         int s = t - prefixSlices;
+         copy(kept[s].begin(), kept[s].end(), result.data + offset[s]);
+      }
+   });
+   result.used = offset[slices];
+   result.parallelRecomputeStats(threads);
+   return result;
+}
+
+void IntSet::parallelRecomputeStats(int numThreads)
+{
+   int threads = resolveThreads(numThreads);
+   int slices = sliceCount(used, threads);
+   if (slices == 1)
+   {
+      recomputeStats();
+      return;
+   }
+
+   //every slice also compares its first element with the one before
+   //it, so together they check the whole order
+   struct Part
+   {
+      unsigned long long sum;
+      int lo, hi;
+      bool ascending;
+   };
+   vector<Part> parts(slices);
+   parallelFor(slices, threads, [&](int s)
+   {
+      int first, last;
+      splitRange(used, slices, s, first, last);
+      Part& part = parts[s];
+      part.sum = 0;
+      part.ascending = true;
+      for (int i = first; i < last; ++i)
+      {
+         part.sum += elementHash(data[i]);
+         if (i > 0 && data[i] <= data[i - 1])
+            part.ascending = false;
+      }
+      valueRange(data + first, last - first, part.lo, part.hi);
+   });
+
+   fingerprint = 0;
+   ascending = true;
+   minValue = parts[0].lo;
+   maxValue = parts[0].hi;
+   for (int s = 0; s < slices; ++s)
+   {
+      fingerprint += parts[s].sum;
+      ascending = ascending && parts[s].ascending;
+      minValue = min(minValue, parts[s].lo);
+      maxValue = max(maxValue, parts[s].hi);
+   }
+}
+
+IntSet IntSet::parallelUnionWith(const IntSet& otherIntSet, int numThreads) const
+{
+   //the invoking set followed by what otherIntSet adds to it
+   return parallelFilter(this, otherIntSet, *this, false, numThreads);
+}
+
+IntSet IntSet::parallelIntersect(const IntSet& otherIntSet, int numThreads) const
+{
+   return parallelFilter(0, *this, otherIntSet, true, numThreads);
+}
+
+IntSet IntSet::parallelSubtract(const IntSet& otherIntSet, int numThreads) const
+{
+   return parallelFilter(0, *this, otherIntSet, false, numThreads);
+}
+
+bool IntSet::parallelIsSubsetOf(const IntSet& otherIntSet, int numThreads) const
+{
+   if (used == 0)
+      return true;
+   if (used > otherIntSet.used)
+      return false;
+
+   int threads = resolveThreads(numThreads);
+   PartitionedIndex index(otherIntSet.data, otherIntSet.used, threads);
+
+   //every thread polls the shared flag between short runs
+   const int CHECK_EVERY = 4096;
+   atomic<bool> missing(false);
+   int slices = sliceCount(used, threads);
+   parallelFor(slices, threads, [&](int s)
+   {
+      int first, last;
+      splitRange(used, slices, s, first, last);
+      for (int i = first; i < last; i += CHECK_EVERY)
+      {
+         if (missing.load(memory_order_relaxed))
+            return;
+         int stop = last - i > CHECK_EVERY ? i + CHECK_EVERY : last;
+         for (int j = i; j < stop; ++j)
+            if (!index.contains(data[j]))
+            {
+               missing.store(true, memory_order_relaxed);
+               return;
+            }
+      }
+   });
+   return !missing.load();
+}
+
+bool IntSet::parallelEquals(const IntSet& otherIntSet, int numThreads) const
+{
+   //equal sizes plus one-way inclusion is enough for sets
+   return used == otherIntSet.used &&
+          parallelIsSubsetOf(otherIntSet, numThreads);
+}
+
+const int* IntSet::sortedView(vector<int>& scratch) const
+{
+   if (ascending)
+      return data;
+   scratch.assign(data, data + used);
+   sort(scratch.begin(), scratch.end());
+   return scratch.empty() ? data : &scratch[0];
+}
+
+IntSet IntSet::sortedUnionWith(const IntSet& otherIntSet, int numThreads) const
+{
+   vector<int> scratchA, scratchB;
+   const int* a = sortedView(scratchA);
+   const int* b = otherIntSet.sortedView(scratchB);
+
+   IntSet result(used + otherIntSet.used);
+   result.used = sortedUnion(a, used, b, otherIntSet.used, result.data,
+                             numThreads);
+   result.parallelRecomputeStats(numThreads);
+   return result;
+}
+
+IntSet IntSet::sortedIntersect(const IntSet& otherIntSet, int numThreads) const
+{
+   vector<int> scratchA, scratchB;
+   const int* a = sortedView(scratchA);
+   const int* b = otherIntSet.sortedView(scratchB);
+
+   IntSet result(used < otherIntSet.used ? used : otherIntSet.used);
+   result.used = sortedIntersection(a, used, b, otherIntSet.used,
+                                    result.data, numThreads);
+   result.parallelRecomputeStats(numThreads);
+   return result;
+}
@@ -0,0 +1,255 @@
+// FILE: IntSetText.cpp
+//       Implementation file for bulk text loading of IntSet elements
+//       (See IntSetText.h for documentation.)
+
+#include "IntSetText.h"
+#include "Parallel.h"
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+namespace
+{
+   inline bool isSpace(char c)
+   {
+      return c == ' ' || (c >= '\t' && c <= '\r');
+   }
+
+   inline bool isDigit(char c)
+   {
+      return unsigned(c - '0') < 10u;
+   }
+
+   bool fail(TextParseError& error, size_t offset, const char* reason)
+   {
+      error.offset = offset;
+      error.reason = reason;
+      return false;
+   }
+
+   //adds values to set all at once, so a failed load changes nothing
+   bool commit(const vector<int>& values, IntSet& set)
+   {
+      if (!values.empty())
+         set.addAll(&values[0], int(values.size()));
+      return true;
+   }
+
+   //parseInts over text whose first byte is at offset base of the
+   //whole input (error offsets are reported from the input's start)
+   bool parseAt(const char* text, size_t length, size_t base,
+                vector<int>& values, TextParseError& error)
+   {
+      const char* p = text;
+      const char* end = text + length;
+      for (;;)
+      {
+         while (p < end && isSpace(*p))
+            ++p;
+         if (p == end)
+            return true;
+
+         const char* start = p;
+         bool negative = *p == '-';
+         if (*p == '-' || *p == '+')
+            ++p;
+         if (p == end || !isDigit(*p))
+            return fail(error, base + (p - text), "expected a digit");
+
+         //accumulate in 64 bits; anything past 2^31 is out of range
+         //whatever its sign (leading zeros do not count)
+         unsigned long long v = 0;
+         do
+         {
+            v = v * 10 + unsigned(*p - '0');
+            if (v > 2147483648ULL)
+               return fail(error, base + (start - text), "integer out of range");
+            ++p;
+         }
+         while (p < end && isDigit(*p));
+
+         if (p < end && !isSpace(*p))
+            return fail(error, base + (p - text), "unexpected character");
+         if (!negative && v > 2147483647ULL)
+            return fail(error, base + (start - text), "integer out of range");
+         values.push_back(negative ? int(-(long long)v) : int(v));
+      }
+   }
+
+   //splits text at whitespace into about one piece per
+   //PARALLEL_TEXT_BYTES (at least one per thread when that is fewer)
+   //and parses the pieces concurrently; on failure error is that of
+   //the earliest failing piece, which is the first error in the text,
+   //and the pieces after it are dropped
+   bool parsePieces(const char* text, size_t length, int numThreads,
+                    vector< vector<int> >& pieces, TextParseError& error)
+   {
+      numThreads = resolveThreads(numThreads);
+      size_t numPieces = length / PARALLEL_TEXT_BYTES;
+      if (numPieces < size_t(numThreads))
+         numPieces = numThreads;
+
+      //each cut moves forward to whitespace, so no token is split
+      vector<size_t> cuts(numPieces + 1, length);
+      cuts[0] = 0;
+      for (size_t i = 1; i < numPieces; ++i)
+      {
+         size_t cut = length / numPieces * i;
+         if (cut < cuts[i - 1])
+            cut = cuts[i - 1];
+         while (cut < length && !isSpace(text[cut]))
+            ++cut;
+         cuts[i] = cut;
+      }
+
+      pieces.assign(numPieces, vector<int>());
+      vector<TextParseError> errors(numPieces);
+      vector<char> ok(numPieces);
+      parallelFor(int(numPieces), numThreads, [&](int i)
+      {
+         ok[i] = parseAt(text + cuts[i], cuts[i + 1] - cuts[i], cuts[i],
+                         pieces[i], errors[i]);
+      });
+      for (size_t i = 0; i < numPieces; ++i)
+         if (!ok[i])
+         {
+            error = errors[i];
+            pieces.resize(i + 1);
+            return false;
+         }
+      return true;
+   }
+
+   //appends the pieces to values in order, so first occurrences keep
+   //theirs (one addAll afterwards indexes the set once, not per piece)
+   void joinPieces(const vector< vector<int> >& pieces, vector<int>& values)
+   {
+      size_t total = values.size();
+      for (size_t i = 0; i < pieces.size(); ++i)
+         total += pieces[i].size();
+      values.reserve(total);
+      for (size_t i = 0; i < pieces.size(); ++i)
+         values.insert(values.end(), pieces[i].begin(), pieces[i].end());
+   }
+
+   //maps path (or leaves m MAP_FAILED when that is not possible);
+   //false if path cannot be opened at all
+   bool mapText(const char* path, void*& m, size_t& length,
+                TextParseError& error)
+   {
+      m = MAP_FAILED;
+      length = 0;
+      int fd = open(path, O_RDONLY);
+      if (fd < 0)
+         return fail(error, 0, "cannot open file");
+      struct stat st;
+      if (fstat(fd, &st) != 0)
+      {
+         close(fd);
+         return fail(error, 0, "cannot open file");
+      }
+
+      //map regular, non-empty files; anything else is streamed
+      if (S_ISREG(st.st_mode) && st.st_size > 0)
+      {
+         length = size_t(st.st_size);
+         m = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      }
+      close(fd);
+      return true;
+   }
+}
+
+bool parseInts(const char* text, size_t length, vector<int>& values,
+               TextParseError& error)
+{
+   return parseAt(text, length, 0, values, error);
+}
+
+bool parallelParseInts(const char* text, size_t length, vector<int>& values,
+                       TextParseError& error, int numThreads)
+{
+   if (length < PARALLEL_TEXT_BYTES || resolveThreads(numThreads) == 1)
+      return parseAt(text, length, 0, values, error);
+
+   vector< vector<int> > pieces;
+   bool ok = parsePieces(text, length, numThreads, pieces, error);
+   joinPieces(pieces, values);
+   return ok;
+}
+
+bool loadIntSetText(istream& in, IntSet& set, TextParseError& error)
+{
+   //parse each block up to its last whitespace; the partial token
+   //after it is carried to the front of the next block
+   vector<char> buffer(TEXT_BLOCK_BYTES);
+   vector<int> values;
+   size_t carried = 0, base = 0;
+   for (;;)
+   {
+      if (carried == buffer.size())
+         buffer.resize(2 * buffer.size());
+      in.read(&buffer[carried], streamsize(buffer.size() - carried));
+      size_t filled = carried + size_t(in.gcount());
+      if (in.bad())
+         return fail(error, base + filled, "read error");
+
+      bool last = !in;
+      size_t cut = filled;
+      if (!last)
+         while (cut > 0 && !isSpace(buffer[cut - 1]))
+            --cut;
+      if (!parseAt(&buffer[0], cut, base, values, error))
+         return false;
+      if (last)
+         return commit(values, set);
+
+      carried = filled - cut;
+      memmove(&buffer[0], &buffer[cut], carried);
+      base += cut;
+   }
+}
+
+bool loadIntSetText(const char* path, IntSet& set, TextParseError& error)
+{
+   return parallelLoadIntSetText(path, set, error, 1);
+}
+
+bool parallelLoadIntSetText(const char* path, IntSet& set,
+                            TextParseError& error, int numThreads)
+{
+   void* m;
+   size_t length;
+   if (!mapText(path, m, length, error))
+      return false;
+   if (m == MAP_FAILED)
+   {
+      ifstream in(path, ios::binary);
+      if (!in)
+         return fail(error, 0, "cannot open file");
+      return loadIntSetText(in, set, error);
+   }
+
+   const char* text = static_cast<const char*>(m);
+   vector<int> values;
+   bool ok;
+   if (length < PARALLEL_TEXT_BYTES || resolveThreads(numThreads) == 1)
+   {
+      madvise(m, length, MADV_SEQUENTIAL);
+      ok = parseAt(text, length, 0, values, error);
+   }
+   else
+   {
+      madvise(m, length, MADV_WILLNEED);
+      vector< vector<int> > pieces;
+      ok = parsePieces(text, length, numThreads, pieces, error);
+      if (ok)
+         joinPieces(pieces, values);
+   }
+   munmap(m, length);
+   return ok && commit(values, set);
+}
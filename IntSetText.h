@@ -0,0 +1,79 @@
+// FILE: IntSetText.h - fast bulk loading of IntSet elements from text
+//
+// Reads whitespace-separated decimal ints (the DumpData format, or
+// any mix of spaces, tabs and newlines) and adds them to an IntSet
+// through IntSet::addAll, so duplicates are dropped and first
+// occurrences keep their order, as with one add() per value. Files
+// are memory-mapped when possible and streams are read in
+// TEXT_BLOCK_BYTES blocks; the parser is a hand-written loop over the
+// raw bytes (no locale, no per-value stream extraction). The parallel
+// versions cut large inputs at whitespace into pieces of about
+// PARALLEL_TEXT_BYTES, parse the pieces on several threads and then
+// add them in input order, so the result is the same as sequentially.
+//
+// GRAMMAR
+//   A token is an optional '+' or '-' followed by one or more digits,
+//   within the range of int; tokens are separated by whitespace
+//   (' ', '\t', '\n', '\v', '\f', '\r'). Anything else is an error.
+//
+// TYPES
+//   struct TextParseError { std::size_t offset; const char* reason; }
+//     Where (byte offset from the start of the input) and why a load
+//     failed; reason is a static string.
+//
+// FUNCTIONS PROVIDED:
+//   bool parseInts(const char* text, std::size_t length,
+//                  std::vector<int>& values, TextParseError& error)
+//     Post: If text[0..length) follows the grammar, its ints have
+//           been appended to values and true is returned; otherwise
+//           error describes the first problem and false is returned
+//           (values then holds the ints before it).
+//   bool parallelParseInts(const char* text, std::size_t length,
+//                          std::vector<int>& values,
+//                          TextParseError& error, int numThreads = 0)
+//     Post: As for parseInts, but inputs of PARALLEL_TEXT_BYTES or
+//           more are parsed by up to numThreads threads (one per
+//           hardware thread if numThreads <= 0).
+//   bool loadIntSetText(std::istream& in, IntSet& set,
+//                       TextParseError& error)
+//   bool loadIntSetText(const char* path, IntSet& set,
+//                       TextParseError& error)
+//     Post: If the whole input parses, its ints have been added to
+//           set (see IntSet::addAll) and true is returned; otherwise
+//           set is unchanged, error says where parsing (or opening or
+//           reading) failed and false is returned.
+//   bool parallelLoadIntSetText(const char* path, IntSet& set,
+//                               TextParseError& error,
+//                               int numThreads = 0)
+//     Post: As for loadIntSetText, but a mapped file of
+//           PARALLEL_TEXT_BYTES or more is parsed by up to numThreads
+//           threads (one per hardware thread if numThreads <= 0).
+
+#ifndef INT_SET_TEXT_H
+#define INT_SET_TEXT_H
+
+#include "IntSet.h"
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+const std::size_t TEXT_BLOCK_BYTES = 1 << 20;
+const std::size_t PARALLEL_TEXT_BYTES = 4 << 20;
+
+struct TextParseError
+{
+   std::size_t offset;
+   const char* reason;
+};
+
+bool parseInts(const char* text, std::size_t length,
+               std::vector<int>& values, TextParseError& error);
+bool loadIntSetText(std::istream& in, IntSet& set, TextParseError& error);
+bool loadIntSetText(const char* path, IntSet& set, TextParseError& error);
+bool parallelParseInts(const char* text, std::size_t length,
+                       std::vector<int>& values, TextParseError& error,
+                       int numThreads = 0);
+bool parallelLoadIntSetText(const char* path, IntSet& set,
+                            TextParseError& error, int numThreads = 0);
+
+#endif
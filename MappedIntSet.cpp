@@ -0,0 +1,144 @@
+// FILE: MappedIntSet.cpp
+//       Implementation file for the MappedIntSet class
+//       (See MappedIntSet.h for documentation.)
+// INVARIANT for the MappedIntSet class:
+// (1) When open, mapping is a read-only mapping of the whole file of
+//     length bytes, header is a copy of its (validated) header and
+//     elements points at the payload inside the mapping.
+// (2) When open on a file with INTSET_FILE_INDEXED, slots points at
+//     the index table inside the mapping (its layout checked by
+//     checkIntSetIndex) and slotMask is its size - 1; otherwise slots
+//     is 0.
+// (3) When closed, mapping is 0, header.count is 0, slots is 0 and
+//     elements points at no element (begin() == end()).
+
+#include "MappedIntSet.h"
+#include "IntIndex.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+MappedIntSet::MappedIntSet()
+   : mapping(0), length(0), elements(0), slots(0), slotMask(0)
+{
+   memset(&header, 0, sizeof header);
+}
+
+MappedIntSet::~MappedIntSet()
+{
+   close();
+}
+
+bool MappedIntSet::open(const char* path, bool verify)
+{
+   close();
+   int fd = ::open(path, O_RDONLY);
+   if (fd < 0)
+      return false;
+   struct stat st;
+   if (fstat(fd, &st) != 0 || st.st_size < off_t(sizeof(IntSetFileHeader)))
+   {
+      ::close(fd);
+      return false;
+   }
+
+   //the mapping stays valid after the descriptor is closed
+   void* m = mmap(0, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+   ::close(fd);
+   if (m == MAP_FAILED)
+      return false;
+
+   IntSetFileHeader h;
+   const char* base = static_cast<const char*>(m);
+   const int32_t* table = 0;
+   uint32_t slotCount = 0;
+   if (!checkIntSetHeader(base, size_t(st.st_size), h)
+       || (h.flags & INTSET_FILE_PACKED)
+       || ((h.flags & INTSET_FILE_INDEXED)
+           && !checkIntSetIndex(h, base + sizeof h, table, slotCount))
+       || (verify && (h.flags & INTSET_FILE_CHECKSUM)
+           && intSetChecksum(base + sizeof h, size_t(h.payloadBytes)) != h.checksum))
+   {
+      munmap(m, size_t(st.st_size));
+      return false;
+   }
+
+   mapping = m;
+   length = size_t(st.st_size);
+   header = h;
+   elements = reinterpret_cast<const int*>(base + sizeof h);
+   slots = table;
+   slotMask = slotCount - 1;
+   return true;
+}
+
+void MappedIntSet::close()
+{
+   if (mapping != 0)
+      munmap(mapping, length);
+   mapping = 0;
+   length = 0;
+   memset(&header, 0, sizeof header);
+   elements = 0;
+   slots = 0;
+   slotMask = 0;
+}
+
+bool MappedIntSet::isOpen() const
+{
+   return mapping != 0;
+}
+
+bool MappedIntSet::isIndexed() const
+{
+   return slots != 0;
+}
+
+int MappedIntSet::size() const
+{
+   return int(header.count);
+}
+
+bool MappedIntSet::isEmpty() const
+{
+   return header.count == 0;
+}
+
+bool MappedIntSet::contains(int anInt) const
+{
+   if (header.count == 0 || anInt < header.minValue || anInt > header.maxValue)
+      return false;
+   if (slots != 0)
+   {
+      //probes are bounded and slots checked against count, so a
+      //damaged table cannot lead outside the mapping or loop forever
+      uint32_t i = IntIndex::hash(anInt) & slotMask;
+      for (uint32_t probes = 0; probes <= slotMask; ++probes)
+      {
+         uint32_t s = uint32_t(slots[i]);
+         if (s == 0)
+            return false;
+         if (s <= header.count && elements[s - 1] == anInt)
+            return true;
+         i = (i + 1) & slotMask;
+      }
+      return false;
+   }
+   if (header.flags & INTSET_FILE_ASCENDING)
+      return binary_search(begin(), end(), anInt);
+   return find(begin(), end(), anInt) != end();
+}
+
+IntSet MappedIntSet::toIntSet() const
+{
+   //the copy is O(count) anyway, so it gets loadIntSet's checks: an
+   //unverified mapping may hold anything
+   IntSet set;
+   if (mapping != 0)
+      decodeIntSet(mapping, length, set);
+   return set;
+}
@@ -0,0 +1,108 @@
+// FILE: MappedIntSet.h - header file for MappedIntSet class
+// CLASS PROVIDED: MappedIntSet (a read-only set of int values served
+//                 straight from a memory-mapped IntSet file)
+//
+// A MappedIntSet maps a file written by saveIntSet (see IntSetFile.h)
+// into memory and reads the elements where they lie: opening costs
+// one mmap and a header check however large the set is, and pages of
+// the payload are only read from disk when they are first touched.
+// contains() rejects values outside [minimum, maximum] at once. In a
+// file saved with INTSET_FILE_INDEXED it then probes the hash index
+// stored in the file, in place, so lookups are O(1) from the moment
+// open() returns, with no index to build; otherwise it binary-searches
+// files flagged INTSET_FILE_ASCENDING and scans the rest, as
+// IntSet::contains does.
+//
+// CONSTRUCTOR
+//   MappedIntSet()
+//     Post: The invoking MappedIntSet is closed (and empty).
+//
+// MODIFICATION MEMBER FUNCTIONS
+//   bool open(const char* path, bool verify = false)
+//     Post: Any file mapped before has been unmapped. If path names a
+//           valid IntSet file (and, with verify, its checksum
+//           matches), it is mapped and true is returned; otherwise
+//           the invoking MappedIntSet is closed and false is
+//           returned.
+//     Note: verify reads the whole payload once (index included);
+//           without it, a damaged index can make contains() wrong but
+//           never makes it read outside the mapping. Packed files
+//           (INTSET_FILE_PACKED) cannot be read in place and are
+//           refused; load them with loadCompressedIntSet instead.
+//   void close()
+//     Post: The file (if any) has been unmapped; the invoking
+//           MappedIntSet is empty.
+//
+// CONSTANT MEMBER FUNCTIONS (ACCESSORS)
+//   bool isOpen() const
+//   bool isIndexed() const
+//     Post: true is returned if the mapped file has a stored index
+//           (INTSET_FILE_INDEXED) that contains() uses.
+//   int size() const
+//   bool isEmpty() const
+//   bool contains(int anInt) const
+//     Post: As for IntSet (a closed MappedIntSet is empty).
+//   const_iterator begin() const
+//   const_iterator end() const
+//   IntSet::View view() const
+//   template <class F> void forEach(F f) const
+//     Post: As for IntSet: the elements in their stored order, read
+//           from the mapping.
+//   IntSet toIntSet() const
+//     Post: An IntSet holding a copy of the elements is returned. The
+//           copy is made by decodeIntSet, so if the mapped file fails
+//           its checksum or holds elements an IntSet cannot (e.g.
+//           duplicates), an empty IntSet is returned instead.
+//
+// VALUE SEMANTICS
+//   MappedIntSet objects may not be copied or assigned. Iterators and
+//   views are invalidated by open, close and destruction.
+
+#ifndef MAPPED_INT_SET_H
+#define MAPPED_INT_SET_H
+
+#include "IntSet.h"
+#include "IntSetFile.h"
+#include <cstddef>
+#include <cstdint>
+
+class MappedIntSet
+{
+public:
+   typedef const int* const_iterator;
+
+   MappedIntSet();
+   ~MappedIntSet();
+   bool open(const char* path, bool verify = false);
+   void close();
+   bool isOpen() const;
+   bool isIndexed() const;
+   int size() const;
+   bool isEmpty() const;
+   bool contains(int anInt) const;
+   const_iterator begin() const { return elements; }
+   const_iterator end() const { return elements + header.count; }
+   IntSet::View view() const { return IntSet::View(elements, size()); }
+   template <class F> void forEach(F f) const;
+   IntSet toIntSet() const;
+
+private:
+   void*            mapping;   // 0 when closed
+   std::size_t      length;
+   IntSetFileHeader header;    // count is 0 when closed
+   const int*       elements;
+   const std::int32_t* slots;  // the stored index, 0 if none
+   std::uint32_t    slotMask;  // its slot count - 1
+
+   MappedIntSet(const MappedIntSet&);
+   MappedIntSet& operator=(const MappedIntSet&);
+};
+
+template <class F>
+void MappedIntSet::forEach(F f) const
+{
+   for (const_iterator p = begin(); p != end(); ++p)
+      f(*p);
+}
+
+#endif
@@ -0,0 +1,139 @@
+// FILE: MergePath.cpp
+//       Implementation file for merge-path partitioned merging
+//       (See MergePath.h for documentation.)
+//
+// Each piece p covers the merge-grid cut from (ai[p], bj[p]) to
+// (ai[p + 1], bj[p + 1]); when a cut would separate a value of a from
+// an equal value of b, the cut is moved one step along b so both
+// land in the same piece. A piece's output never exceeds its length
+// (ai[p + 1] - ai[p]) + (bj[p + 1] - bj[p]), so every piece can write
+// into its own disjoint region of a scratch buffer in parallel.
+
+#include "MergePath.h"
+#include "Parallel.h"
+#include <cstring>
+#include <vector>
+using namespace std;
+
+namespace
+{
+   //the inner kernels avoid unpredictable branches: both cursors
+   //advance on comparisons and the output cursor on a flag
+   int mergeUnion(const int* a, int i, int ie, const int* b, int j, int je,
+                  int* out)
+   {
+      int k = 0;
+      while (i < ie && j < je)
+      {
+         int x = a[i], y = b[j];
+         out[k++] = x < y ? x : y;
+         i += (x <= y);
+         j += (y <= x);
+      }
+      while (i < ie)
+         out[k++] = a[i++];
+      while (j < je)
+         out[k++] = b[j++];
+      return k;
+   }
+
+   int mergeIntersection(const int* a, int i, int ie, const int* b, int j,
+                         int je, int* out)
+   {
+      int k = 0;
+      while (i < ie && j < je)
+      {
+         int x = a[i], y = b[j];
+         out[k] = x;
+         k += (x == y);
+         i += (x <= y);
+         j += (y <= x);
+      }
+      return k;
+   }
+
+   //cut points for numPieces equal pieces; equal values never split
+   void cutPieces(const int* a, int na, const int* b, int nb, int numPieces,
+                  vector<int>& ai, vector<int>& bj)
+   {
+      int total = na + nb;
+      ai.assign(numPieces + 1, 0);
+      bj.assign(numPieces + 1, 0);
+      for (int p = 1; p < numPieces; ++p)
+      {
+         int diag = int((long long)total * p / numPieces);
+         int i = mergePathSplit(a, na, b, nb, diag);
+         int j = diag - i;
+         if (i > 0 && j < nb && a[i - 1] == b[j])
+            ++j;
+         ai[p] = i;
+         bj[p] = j;
+      }
+      ai[numPieces] = na;
+      bj[numPieces] = nb;
+   }
+
+   typedef int (*MergeKernel)(const int*, int, int, const int*, int, int,
+                              int*);
+
+   int partitionedMerge(const int* a, int na, const int* b, int nb,
+                        int* out, int numThreads, MergeKernel kernel)
+   {
+      int threads = resolveThreads(numThreads);
+      if (threads == 1 || na + nb < MERGE_PATH_GRAIN)
+         return kernel(a, 0, na, b, 0, nb, out);
+      if (threads > (na + nb) / 1024)
+         threads = (na + nb) / 1024;
+
+      vector<int> ai, bj;
+      cutPieces(a, na, b, nb, threads, ai, bj);
+
+      //every piece merges into its own region of the scratch buffer
+      vector<int> scratch(na + nb);
+      vector<int> produced(threads);
+      parallelFor(threads, threads, [&](int p)
+      {
+         produced[p] = kernel(a, ai[p], ai[p + 1], b, bj[p], bj[p + 1],
+                              &scratch[ai[p] + bj[p]]);
+      });
+
+      //close the gaps between the pieces
+      int k = 0;
+      for (int p = 0; p < threads; ++p)
+      {
+         if (produced[p] > 0)
+            memcpy(out + k, &scratch[ai[p] + bj[p]], produced[p] * sizeof(int));
+         k += produced[p];
+      }
+      return k;
+   }
+}
+
+int mergePathSplit(const int* a, int na, const int* b, int nb, int diag)
+{
+   //binary search along the diagonal for the first a[i] that the
+   //merge would emit after position diag
+   int lo = diag > nb ? diag - nb : 0;
+   int hi = diag < na ? diag : na;
+   while (lo < hi)
+   {
+      int mid = lo + (hi - lo) / 2;
+      if (a[mid] <= b[diag - 1 - mid])
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo;
+}
+
+int sortedUnion(const int* a, int na, const int* b, int nb,
+                int* out, int numThreads)
+{
+   return partitionedMerge(a, na, b, nb, out, numThreads, mergeUnion);
+}
+
+int sortedIntersection(const int* a, int na, const int* b, int nb,
+                       int* out, int numThreads)
+{
+   return partitionedMerge(a, na, b, nb, out, numThreads, mergeIntersection);
+}
@@ -0,0 +1,43 @@
+// FILE: MergePath.h - merge-path partitioned merging of sorted arrays
+//
+// The output of merging sorted arrays a and b can be cut into equal
+// pieces by binary-searching along the cross diagonals of the (a, b)
+// merge grid ("merge path"); each piece can then be merged on its own
+// thread with no coordination. Equal values are always kept in the
+// same piece, so the pieces can be used for set union/intersection
+// of duplicate-free inputs.
+//
+// FUNCTIONS PROVIDED:
+//   int mergePathSplit(const int* a, int na, const int* b, int nb,
+//                      int diag)
+//     Pre:  a[0..na) and b[0..nb) are strictly ascending;
+//           0 <= diag <= na + nb.
+//     Post: The number i of elements of a among the first diag
+//           elements of the merge of a and b is returned (so diag - i
+//           come from b), with ties taken from a first.
+//   int sortedUnion(const int* a, int na, const int* b, int nb,
+//                   int* out, int numThreads = 0)
+//   int sortedIntersection(const int* a, int na, const int* b, int nb,
+//                          int* out, int numThreads = 0)
+//     Pre:  a[0..na) and b[0..nb) are strictly ascending; out has
+//           room for na + nb (union) or min(na, nb) (intersection)
+//           values and does not overlap a or b.
+//     Post: The strictly ascending union (intersection) of a and b
+//           has been written to out and its length is returned. The
+//           work is split into equal merge-path pieces over up to
+//           numThreads threads (numThreads <= 0 means one per
+//           hardware thread); inputs with fewer than
+//           MERGE_PATH_GRAIN elements in total use one thread.
+
+#ifndef MERGE_PATH_H
+#define MERGE_PATH_H
+
+const int MERGE_PATH_GRAIN = 65536;
+
+int mergePathSplit(const int* a, int na, const int* b, int nb, int diag);
+int sortedUnion(const int* a, int na, const int* b, int nb,
+                int* out, int numThreads = 0);
+int sortedIntersection(const int* a, int na, const int* b, int nb,
+                       int* out, int numThreads = 0);
+
+#endif
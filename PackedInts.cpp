@@ -0,0 +1,135 @@
+// FILE: PackedInts.cpp
+//       Implementation file for frame-of-reference bit-packing
+//       (See PackedInts.h for documentation.)
+
+#include "PackedInts.h"
+#include <climits>
+using namespace std;
+
+namespace
+{
+   //number of values in block of an n-value encoding
+   inline int blockLength(int n, int block)
+   {
+      int rest = n - block * PACKED_BLOCK_SIZE;
+      return rest < PACKED_BLOCK_SIZE ? rest : PACKED_BLOCK_SIZE;
+   }
+
+   //words holding count w-bit gaps
+   inline size_t packedWords(int count, unsigned w)
+   {
+      return (size_t(count) * w + 31) / 32;
+   }
+
+   inline unsigned bitWidth(uint32_t x)
+   {
+      return x == 0 ? 0 : 32 - unsigned(__builtin_clz(x));
+   }
+}
+
+int packedBlockCount(int n)
+{
+   return (n + PACKED_BLOCK_SIZE - 1) / PACKED_BLOCK_SIZE;
+}
+
+void packSortedInts(const int* sorted, int n, vector<uint32_t>& out)
+{
+   int blocks = packedBlockCount(n);
+   out.assign(1 + 2 * size_t(blocks), 0);
+   out[0] = uint32_t(blocks);
+
+   for (int b = 0; b < blocks; ++b)
+   {
+      const int* v = sorted + b * PACKED_BLOCK_SIZE;
+      int count = blockLength(n, b);
+
+      //gaps are unsigned, so any ascending pair of ints fits
+      uint32_t widest = 0;
+      for (int i = 1; i < count; ++i)
+         widest |= uint32_t(v[i]) - uint32_t(v[i - 1]);
+      unsigned w = bitWidth(widest);
+
+      out[1 + 2 * b] = uint32_t(v[0]);
+      out[2 + 2 * b] = uint32_t(out.size() - (1 + 2 * size_t(blocks)));
+      size_t at = out.size() + 1;
+      out.resize(at + packedWords(count - 1, w), 0);
+      out[at - 1] = w;
+      if (w == 0)
+         continue;
+
+      uint32_t* dst = &out[at];
+      for (int i = 1; i < count; ++i)
+      {
+         uint32_t gap = uint32_t(v[i]) - uint32_t(v[i - 1]);
+         size_t pos = size_t(i - 1) * w;
+         unsigned shift = unsigned(pos & 31);
+         dst[pos >> 5] |= gap << shift;
+         if (shift + w > 32)
+            dst[(pos >> 5) + 1] |= gap >> (32 - shift);
+      }
+   }
+}
+
+bool checkPackedInts(const uint32_t* words, size_t numWords, int n)
+{
+   int blocks = packedBlockCount(n);
+   size_t head = 1 + 2 * size_t(blocks);
+   if (n < 0 || numWords < head || words[0] != uint32_t(blocks))
+      return false;
+   size_t area = numWords - head;
+   for (int b = 0; b < blocks; ++b)
+   {
+      size_t at = words[2 + 2 * b];
+      if (at >= area)
+         return false;
+      uint32_t w = words[head + at];
+      if (w > 32 || at + 1 + packedWords(blockLength(n, b) - 1, w) > area)
+         return false;
+   }
+
+   //the values must come out strictly ascending, within and across
+   //blocks; a gap that carries a value past INT_MAX wraps it round
+   //below its predecessor, so this catches overflow too
+   int values[PACKED_BLOCK_SIZE];
+   long long previous = (long long)INT_MIN - 1;
+   for (int b = 0; b < blocks; ++b)
+   {
+      int count = unpackBlock(words, n, b, values);
+      for (int i = 0; i < count; ++i)
+      {
+         if (values[i] <= previous)
+            return false;
+         previous = values[i];
+      }
+   }
+   return true;
+}
+
+int unpackBlock(const uint32_t* words, int n, int block, int* out)
+{
+   int blocks = packedBlockCount(n);
+   const uint32_t* src = words + 1 + 2 * size_t(blocks) + words[2 + 2 * block];
+   unsigned w = src[0];
+   ++src;
+   uint32_t mask = w == 32 ? ~uint32_t(0) : (uint32_t(1) << w) - 1;
+
+   int count = blockLength(n, block);
+   uint32_t value = words[1 + 2 * block];
+   out[0] = int(value);
+   size_t pos = 0;
+   for (int i = 1; i < count; ++i, pos += w)
+   {
+      //a width of 0 has no packed words to read
+      uint32_t gap = 0;
+      if (w != 0)
+      {
+         unsigned shift = unsigned(pos & 31);
+         gap = src[pos >> 5] >> shift;
+         if (shift + w > 32)
+            gap |= src[(pos >> 5) + 1] << (32 - shift);
+      }
+      value += gap & mask;
+      out[i] = int(value);
+   }
+   return count;
+}
@@ -0,0 +1,68 @@
+// FILE: PackedInts.h - frame-of-reference bit-packing of sorted ints
+//
+// A strictly ascending int array is cut into blocks of
+// PACKED_BLOCK_SIZE values. Each block keeps its first value in a
+// directory and the gaps between consecutive values packed at the
+// smallest bit width that holds the block's largest gap, so ID lists
+// with small gaps shrink to a few bits per value. Any value can be
+// found by binary-searching the directory and decoding one block.
+//
+// ENCODING (32-bit words, host byte order)
+//   word 0                numBlocks
+//   words 1 .. 2b         directory: for each block its first value
+//                         and the offset (in words, from the start of
+//                         the block area) of its packed gaps
+//   block area            per block: one word holding the bit width w
+//                         (0..32), then the block's count - 1 gaps
+//                         packed w bits each, lowest bits first, in
+//                         ceil((count - 1) * w / 32) words
+//   Every block holds PACKED_BLOCK_SIZE values except the last.
+//
+// FUNCTIONS PROVIDED:
+//   void packSortedInts(const int* sorted, int n,
+//                       std::vector<std::uint32_t>& out)
+//     Pre:  sorted[0..n) is strictly ascending.
+//     Post: out holds the encoding of those n values.
+//   int packedBlockCount(int n)
+//     Post: The number of blocks an encoding of n values has is
+//           returned.
+//   bool checkPackedInts(const std::uint32_t* words, std::size_t
+//                        numWords, int n)
+//     Post: true is returned if words[0..numWords) is shaped like an
+//           encoding of n values (block count, directory and block
+//           sizes all consistent), so unpackBlock cannot read outside
+//           it, and decodes to strictly ascending values (no zero
+//           gap, no gap carrying a value past INT_MAX, each block
+//           starting above the end of the one before); otherwise
+//           false.
+//     Note: Every block is decoded once, so this is O(n).
+//   int unpackBlock(const std::uint32_t* words, int n, int block,
+//                   int* out)
+//     Pre:  words is a (checked) encoding of n values and
+//           0 <= block < packedBlockCount(n); out has room for
+//           PACKED_BLOCK_SIZE values.
+//     Post: The values of that block have been written to out in
+//           ascending order and their number is returned.
+//   int packedBlockFirst(const std::uint32_t* words, int block)
+//     Post: The first (smallest) value of that block is returned.
+
+#ifndef PACKED_INTS_H
+#define PACKED_INTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const int PACKED_BLOCK_SIZE = 128;
+
+void packSortedInts(const int* sorted, int n, std::vector<std::uint32_t>& out);
+int packedBlockCount(int n);
+bool checkPackedInts(const std::uint32_t* words, std::size_t numWords, int n);
+int unpackBlock(const std::uint32_t* words, int n, int block, int* out);
+
+inline int packedBlockFirst(const std::uint32_t* words, int block)
+{
+   return int(words[1 + 2 * block]);
+}
+
+#endif
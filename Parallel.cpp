@@ -0,0 +1,136 @@
+// FILE: Parallel.cpp
+//       Implementation file for the thread pool behind parallelFor
+//       (See Parallel.h for documentation.)
+// INVARIANT for the pool:
+// (1) open lists the calls still taking helpers, oldest first; a call
+//     leaves it once it has as many helpers as it asked for or its
+//     caller has run out of tasks, whichever comes first.
+// (2) active of a call is the number of helpers working on it; its
+//     caller returns only once that is 0, so no helper touches a call
+//     after runParallel has returned.
+// (3) error of a call is set at most once, by whichever thread sees
+//     failed go from false to true; it is read only by the caller,
+//     after active has dropped to 0.
+// (4) threads is the number of helper threads started; they are never
+//     stopped (the pool lives until the program exits).
+
+#include "Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+namespace
+{
+   //one runParallel call as the pool sees it
+   struct Call
+   {
+      const function<void(int)>* body;
+      int numTasks;
+      atomic<int> next;    // first task no thread has taken
+      int wanted;          // helpers that may still join
+      int active;          // helpers working on it
+      atomic<bool> failed; // a task has thrown
+      exception_ptr error; // what the first task to throw threw
+   };
+
+   //runs the tasks of call nobody has taken yet; a task that throws
+   //ends the call: its exception is kept for the caller and no thread
+   //takes another task
+   void drain(Call& call)
+   {
+      try
+      {
+         for (int t = call.next++; t < call.numTasks; t = call.next++)
+            (*call.body)(t);
+      }
+      catch (...)
+      {
+         call.next = call.numTasks;
+         if (!call.failed.exchange(true))
+            call.error = current_exception();
+      }
+   }
+
+   class Pool
+   {
+   public:
+      Pool() : threads(0) {}
+      void run(int numTasks, int numThreads, const function<void(int)>& body);
+
+   private:
+      mutex lock;
+      condition_variable work;    // a call was opened
+      condition_variable left;    // a helper left a call
+      vector<Call*> open;
+      int threads;
+
+      Pool(const Pool&);
+      Pool& operator=(const Pool&);
+      void help();
+   };
+
+   void Pool::run(int numTasks, int numThreads, const function<void(int)>& body)
+   {
+      Call call;
+      call.body = &body;
+      call.numTasks = numTasks;
+      call.next = 0;
+      call.wanted = numThreads - 1;
+      call.active = 0;
+      call.failed = false;
+      {
+         lock_guard<mutex> guard(lock);
+         for (; threads < call.wanted; ++threads)
+            thread(&Pool::help, this).detach();
+         open.push_back(&call);
+      }
+      work.notify_all();
+
+      //drain does not throw, so the call always leaves open and no
+      //helper is still on it when the exception is passed on
+      drain(call);
+      {
+         unique_lock<mutex> held(lock);
+         vector<Call*>::iterator at = find(open.begin(), open.end(), &call);
+         if (at != open.end())
+            open.erase(at);
+         left.wait(held, [&]() { return call.active == 0; });
+      }
+      if (call.failed)
+         rethrow_exception(call.error);
+   }
+
+   void Pool::help()
+   {
+      unique_lock<mutex> held(lock);
+      for (;;)
+      {
+         work.wait(held, [&]() { return !open.empty(); });
+         Call* call = open.front();
+         if (--call->wanted == 0)
+            open.erase(open.begin());
+         ++call->active;
+         held.unlock();
+         drain(*call);
+         held.lock();
+         if (--call->active == 0)
+            left.notify_all();
+      }
+   }
+
+   //never destroyed, so exiting does not wait for threads parked in it
+   Pool& pool()
+   {
+      static Pool* shared = new Pool;
+      return *shared;
+   }
+}
+
+void runParallel(int numTasks, int numThreads, const function<void(int)>& body)
+{
+   pool().run(numTasks, numThreads, body);
+}
@@ -0,0 +1,73 @@
+// FILE: Parallel.h - small helpers for splitting work over threads
+//
+// FUNCTIONS PROVIDED:
+//   int resolveThreads(int numThreads)
+//     Post: numThreads is returned if it is >= 1, otherwise the
+//           number of hardware threads (at least 1) is returned.
+//   void parallelFor(int numTasks, int numThreads, Body body)
+//     Pre:  body can be called as body(int) from several threads at
+//           once.
+//     Post: body(t) has been called exactly once for every t in
+//           0 .. numTasks - 1, spread over at most numThreads threads
+//           (the calling thread is one of them), and all calls have
+//           finished.
+//     Note: The other threads come from a pool shared by the whole
+//           program: they are started the first time a call needs
+//           them and then wait for the next call, so a call costs a
+//           wake-up rather than thread creation. Calls may be nested
+//           or made from several threads at once; the calling thread
+//           runs whatever tasks no pool thread has taken, so every
+//           call finishes even when the pool is busy (tasks must
+//           therefore not wait for one another).
+//     Note: If a call of body throws, no task not yet started is
+//           started, the tasks already running finish, and then the
+//           first exception thrown is rethrown on the calling thread
+//           (the pool stays usable).
+//   void runParallel(int numTasks, int numThreads,
+//                    const std::function<void(int)>& body)
+//     Pre:  2 <= numThreads <= numTasks
+//     Post: As for parallelFor (which calls it once it has decided
+//           more than one thread is worth using).
+//   void splitRange(int n, int parts, int part, int& first, int& last)
+//     Post: [first, last) is the part-th of parts near-equal
+//           contiguous slices of [0, n).
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+#include <thread>
+
+inline int resolveThreads(int numThreads)
+{
+   if (numThreads >= 1)
+      return numThreads;
+   int hw = int(std::thread::hardware_concurrency());
+   return hw >= 1 ? hw : 1;
+}
+
+inline void splitRange(int n, int parts, int part, int& first, int& last)
+{
+   first = int((long long)n * part / parts);
+   last = int((long long)n * (part + 1) / parts);
+}
+
+void runParallel(int numTasks, int numThreads,
+                 const std::function<void(int)>& body);
+
+template <class Body>
+void parallelFor(int numTasks, int numThreads, Body body)
+{
+   numThreads = resolveThreads(numThreads);
+   if (numThreads > numTasks)
+      numThreads = numTasks;
+   if (numThreads <= 1)
+   {
+      for (int t = 0; t < numTasks; ++t)
+         body(t);
+      return;
+   }
+   runParallel(numTasks, numThreads, std::function<void(int)>(body));
+}
+
+#endif
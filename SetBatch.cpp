@@ -0,0 +1,120 @@
+// FILE: SetBatch.cpp
+//       Implementation file for the SetBatchExecutor class
+//       (See SetBatch.h for documentation.)
+//
+// DOCUMENTATION for private member (helper) function:
+//   template <class Deliver>
+//   std::vector< std::future<void> > schedule(
+//                      const std::vector<SetJob>& jobs, Deliver deliver)
+//     Post: jobs has been cut into contiguous groups by estimated
+//           cost and one pool task has been submitted per group;
+//           each task calls deliver(i, jobs[i]) for its jobs in
+//           order, deliver evaluating the job and handing the result
+//           on. The futures of the tasks are returned.
+
+#include "SetBatch.h"
+#include "SetPlanner.h"
+#include <exception>
+#include <memory>
+using namespace std;
+
+SetBatchExecutor::SetBatchExecutor(int numThreads) : pool(numThreads)
+{
+}
+
+long long SetBatchExecutor::estimateCost(const SetJob& job)
+{
+   //every operation is one planned pass for the common elements and
+   //then a copy of what it keeps (at most both inputs)
+   const IntSet& lhs = *job.lhs;
+   const IntSet& rhs = *job.rhs;
+   double copy = plannerCosts().mergeElement * (double(lhs.size()) + rhs.size());
+   return (long long)(planCost(lhs.stats(), rhs.stats()) + copy) + 1;
+}
+
+IntSet SetBatchExecutor::evaluate(const SetJob& job)
+{
+   //the sequential operations already pick their kernel per call
+   const IntSet& lhs = *job.lhs;
+   const IntSet& rhs = *job.rhs;
+   switch (job.op)
+   {
+   case SET_UNION:
+      return lhs.unionWith(rhs);
+   case SET_INTERSECT:
+      return lhs.intersect(rhs);
+   case SET_SYMMETRIC_DIFFERENCE:
+      return lhs.symmetricDifference(rhs);
+   default:
+      return lhs.subtract(rhs);
+   }
+}
+
+template <class Deliver>
+vector< future<void> > SetBatchExecutor::schedule(const vector<SetJob>& jobs,
+                                                  Deliver deliver)
+{
+   vector< future<void> > tasks;
+   int n = int(jobs.size());
+   int first = 0;
+   while (first < n)
+   {
+      //pack jobs until the group is worth a task on its own
+      long long cost = 0;
+      int last = first;
+      while (last < n && cost < TASK_COST)
+         cost += estimateCost(jobs[last++]);
+
+      vector<SetJob> group(jobs.begin() + first, jobs.begin() + last);
+      int base = first;
+      tasks.push_back(pool.submit([group, base, deliver]()
+      {
+         for (size_t k = 0; k < group.size(); ++k)
+            deliver(base + int(k), group[k]);
+      }));
+      first = last;
+   }
+   return tasks;
+}
+
+vector<IntSet> SetBatchExecutor::run(const vector<SetJob>& jobs)
+{
+   //every job moves its result into its own slot, so no locking (and
+   //no copying) is needed; waiting on our own tasks rather than the
+   //pool leaves jobs queued by submit() alone, and get() passes on
+   //an exception a job threw
+   vector<IntSet> results(jobs.size());
+   IntSet* out = results.empty() ? 0 : &results[0];
+   vector< future<void> > tasks = schedule(jobs, [out](int i, const SetJob& job)
+   {
+      IntSet result = evaluate(job);
+      out[i] = std::move(result);
+   });
+   for (size_t t = 0; t < tasks.size(); ++t)
+      tasks[t].wait();
+   for (size_t t = 0; t < tasks.size(); ++t)
+      tasks[t].get();
+   return results;
+}
+
+vector< future<IntSet> > SetBatchExecutor::submit(const vector<SetJob>& jobs)
+{
+   shared_ptr< vector< promise<IntSet> > > promises(
+      new vector< promise<IntSet> >(jobs.size()));
+   vector< future<IntSet> > futures;
+   for (size_t i = 0; i < jobs.size(); ++i)
+      futures.push_back((*promises)[i].get_future());
+
+   schedule(jobs, [promises](int i, const SetJob& job)
+   {
+      try
+      {
+         (*promises)[i].set_value(evaluate(job));
+      }
+      catch (...)
+      {
+         (*promises)[i].set_exception(current_exception());
+      }
+   });
+   return futures;
+}
@@ -0,0 +1,93 @@
+// FILE: SetBatch.h - header file for SetBatchExecutor class
+// CLASS PROVIDED: SetBatchExecutor (runs large batches of independent
+//                 IntSet operations on a work-stealing thread pool)
+//
+// A batch is a list of SetJob's, each naming an operation and the two
+// IntSet's it applies to. Jobs are grouped into pool tasks by their
+// estimated cost: cheap jobs are packed together until a task is
+// worth about TASK_COST units of work, while an expensive job gets a
+// task of its own, so big and tiny jobs balance across the workers
+// (idle workers steal whole tasks from busy ones).
+//
+// TYPES
+//   enum SetOp { SET_UNION, SET_INTERSECT, SET_SUBTRACT,
+//                SET_SYMMETRIC_DIFFERENCE }
+//   struct SetJob { SetOp op; const IntSet* lhs; const IntSet* rhs; }
+//     A job computes lhs->unionWith(*rhs), lhs->intersect(*rhs),
+//     lhs->subtract(*rhs) or lhs->symmetricDifference(*rhs).
+//
+// CONSTANTS
+//   static const long long TASK_COST = ____
+//     Estimated work (in nanoseconds, as priced by estimateCost) a
+//     task of packed small jobs is filled up to.
+//
+// CONSTRUCTOR
+//   SetBatchExecutor(int numThreads = 0)
+//     Post: A pool of numThreads workers (one per hardware thread if
+//           numThreads <= 0) has been started.
+//
+// MEMBER FUNCTIONS
+//   std::vector<IntSet> run(const std::vector<SetJob>& jobs)
+//     Pre:  The IntSet's the jobs refer to are not modified until the
+//           call returns.
+//     Post: The results of all jobs are returned, result i belonging
+//           to jobs[i]. If a job threw, every job has still finished
+//           and the exception is rethrown.
+//   std::vector< std::future<IntSet> > submit(
+//                                   const std::vector<SetJob>& jobs)
+//     Pre:  The IntSet's the jobs refer to are not modified until the
+//           corresponding futures are ready.
+//     Post: All jobs have been queued; future i becomes ready with
+//           the result of jobs[i] (or the exception it threw) as soon
+//           as that job has run.
+//   static long long estimateCost(const SetJob& job)
+//     Post: The estimated work of job in nanoseconds, as used for
+//           task packing, is returned: the planner's price for
+//           matching the two sets (see planCost in SetPlanner.h) plus
+//           a merge step per element for building the result.
+//   static IntSet evaluate(const SetJob& job)
+//     Post: The result of job is computed on the calling thread and
+//           returned.
+//
+// VALUE SEMANTICS
+//   SetBatchExecutor objects may not be copied or assigned. The
+//   destructor waits for all submitted jobs to finish.
+
+#ifndef SET_BATCH_H
+#define SET_BATCH_H
+
+#include "IntSet.h"
+#include "WorkStealingPool.h"
+#include <future>
+#include <vector>
+
+enum SetOp { SET_UNION, SET_INTERSECT, SET_SUBTRACT, SET_SYMMETRIC_DIFFERENCE };
+
+struct SetJob
+{
+   SetOp op;
+   const IntSet* lhs;
+   const IntSet* rhs;
+};
+
+class SetBatchExecutor
+{
+public:
+   static const long long TASK_COST = 1 << 18;
+   SetBatchExecutor(int numThreads = 0);
+   std::vector<IntSet> run(const std::vector<SetJob>& jobs);
+   std::vector< std::future<IntSet> > submit(const std::vector<SetJob>& jobs);
+   static long long estimateCost(const SetJob& job);
+   static IntSet evaluate(const SetJob& job);
+
+private:
+   WorkStealingPool pool;
+
+   SetBatchExecutor(const SetBatchExecutor&);
+   SetBatchExecutor& operator=(const SetBatchExecutor&);
+   template <class Deliver>
+   std::vector< std::future<void> > schedule(const std::vector<SetJob>& jobs,
+                                             Deliver deliver);
+};
+
+#endif
@@ -0,0 +1,328 @@
+// FILE: SetExpr.h - lazy, fused set-algebra expressions over IntSet
+//
+// Including this header makes the operators
+//   a | b    union               (like a.unionWith(b))
+//   a & b    intersection        (like a.intersect(b))
+//   a - b    difference          (like a.subtract(b))
+//   a ^ b    symmetric difference (like a.symmetricDifference(b))
+// available on IntSet's and on the expressions they produce. The
+// operators do no work: they return small expression nodes that refer
+// to their operands. Constructing or assigning an IntSet from an
+// expression evaluates the whole tree in one fused pass straight into
+// the destination, so e.g.
+//     IntSet r = ((a | b) & c) - d;
+// never materializes a | b or (a | b) & c. The operators keep the
+// built-in precedence (- before &, & before ^, ^ before |), so
+// a | b & c - d means a | (b & (c - d)): parenthesise.
+//
+// HOW AN EXPRESSION IS EVALUATED
+//   Every node can answer contains(x) for its result and can
+//   enumerate candidates, a superset of its result: a leaf enumerates
+//   its elements; a | b and a ^ b enumerate a's then b's candidates;
+//   a & b enumerates the candidates of whichever side is estimated
+//   to be smaller; a - b enumerates a's. The evaluator keeps each
+//   candidate x for which the root's contains(x) is true, skipping
+//   repeats (only possible below a | or ^). For a & b the smaller
+//   side is probed first and for a | b the larger one, so the
+//   short-circuit fires as often as possible. Leaves larger than
+//   SET_EXPR_INDEX_MIN elements answer contains() from a hash index
+//   (see IntIndex.h) built once per evaluation.
+//
+// RESULT ORDER
+//   Elements appear in the order they are enumerated as candidates,
+//   which for expressions without & is the same order the chained
+//   member functions produce.
+//
+// LIFETIME
+//   Expression nodes hold references to their IntSet operands; an
+//   expression must be evaluated before any IntSet it refers to is
+//   changed or destroyed (i.e. do not keep expressions in variables).
+//   The destination may be one of the operands (a = a & b is fine);
+//   the result is then built aside and moved in.
+
+#ifndef SET_EXPR_H
+#define SET_EXPR_H
+
+#include "IntSet.h"
+#include "IntIndex.h"
+#include <memory>
+#include <utility>
+
+const int SET_EXPR_INDEX_MIN = 32;
+
+// Gives the expression templates the raw access they need to an
+// IntSet without exposing it to everyone else.
+struct SetExprAccess
+{
+   static const int* data(const IntSet& s) { return s.data; }
+   static int size(const IntSet& s) { return s.used; }
+   static void prepare(IntSet& s, int capacity) { s.prepare(capacity); }
+   static void append(IntSet& s, int anInt) { s.append(anInt); }
+   static int* slot(IntSet& s) { return s.data + s.used; }
+   static int used(const IntSet& s) { return s.used; }
+};
+
+template <class Derived>
+struct SetExpr
+{
+   const Derived& self() const
+   {
+      return static_cast<const Derived&>(*this);
+   }
+};
+
+class SetLeaf : public SetExpr<SetLeaf>
+{
+public:
+   static const bool mayRepeat = false;
+
+   explicit SetLeaf(const IntSet& s) : set(&s) {}
+
+   int estimate() const { return set->size(); }
+   bool refersTo(const IntSet* s) const { return set == s; }
+
+   void prepare() const
+   {
+      if (set->size() > SET_EXPR_INDEX_MIN && !index)
+      {
+         index = std::make_shared<IntIndex>();
+         index->build(SetExprAccess::data(*set), set->size());
+      }
+   }
+
+   bool contains(int x) const
+   {
+      return index ? index->contains(x) : set->contains(x);
+   }
+
+   template <class F>
+   void forEachCandidate(F& f) const
+   {
+      const int* d = SetExprAccess::data(*set);
+      for (int i = 0, n = set->size(); i < n; ++i)
+         f(d[i]);
+   }
+
+private:
+   const IntSet* set;
+   mutable std::shared_ptr<IntIndex> index;
+};
+
+template <class L, class R>
+class SetBinaryExpr
+{
+public:
+   SetBinaryExpr(const L& l, const R& r) : lhs(l), rhs(r) {}
+
+   bool refersTo(const IntSet* s) const
+   {
+      return lhs.refersTo(s) || rhs.refersTo(s);
+   }
+
+   void prepare() const
+   {
+      lhs.prepare();
+      rhs.prepare();
+   }
+
+protected:
+   L lhs;
+   R rhs;
+};
+
+template <class L, class R>
+class SetUnionExpr : public SetExpr< SetUnionExpr<L, R> >,
+                     public SetBinaryExpr<L, R>
+{
+public:
+   static const bool mayRepeat = true;
+   using SetBinaryExpr<L, R>::lhs;
+   using SetBinaryExpr<L, R>::rhs;
+
+   SetUnionExpr(const L& l, const R& r) : SetBinaryExpr<L, R>(l, r) {}
+
+   int estimate() const { return lhs.estimate() + rhs.estimate(); }
+
+   bool contains(int x) const
+   {
+      //the larger side is the likelier hit
+      return lhs.estimate() >= rhs.estimate()
+             ? (lhs.contains(x) || rhs.contains(x))
+             : (rhs.contains(x) || lhs.contains(x));
+   }
+
+   template <class F>
+   void forEachCandidate(F& f) const
+   {
+      lhs.forEachCandidate(f);
+      rhs.forEachCandidate(f);
+   }
+};
+
+template <class L, class R>
+class SetIntersectExpr : public SetExpr< SetIntersectExpr<L, R> >,
+                         public SetBinaryExpr<L, R>
+{
+public:
+   static const bool mayRepeat = L::mayRepeat || R::mayRepeat;
+   using SetBinaryExpr<L, R>::lhs;
+   using SetBinaryExpr<L, R>::rhs;
+
+   SetIntersectExpr(const L& l, const R& r) : SetBinaryExpr<L, R>(l, r) {}
+
+   int estimate() const
+   {
+      int a = lhs.estimate(), b = rhs.estimate();
+      return a < b ? a : b;
+   }
+
+   bool contains(int x) const
+   {
+      //the smaller side is the likelier miss
+      return lhs.estimate() <= rhs.estimate()
+             ? (lhs.contains(x) && rhs.contains(x))
+             : (rhs.contains(x) && lhs.contains(x));
+   }
+
+   template <class F>
+   void forEachCandidate(F& f) const
+   {
+      if (lhs.estimate() <= rhs.estimate())
+         lhs.forEachCandidate(f);
+      else
+         rhs.forEachCandidate(f);
+   }
+};
+
+template <class L, class R>
+class SetSubtractExpr : public SetExpr< SetSubtractExpr<L, R> >,
+                        public SetBinaryExpr<L, R>
+{
+public:
+   static const bool mayRepeat = L::mayRepeat;
+   using SetBinaryExpr<L, R>::lhs;
+   using SetBinaryExpr<L, R>::rhs;
+
+   SetSubtractExpr(const L& l, const R& r) : SetBinaryExpr<L, R>(l, r) {}
+
+   int estimate() const { return lhs.estimate(); }
+
+   bool contains(int x) const
+   {
+      return lhs.contains(x) && !rhs.contains(x);
+   }
+
+   template <class F>
+   void forEachCandidate(F& f) const
+   {
+      lhs.forEachCandidate(f);
+   }
+};
+
+template <class L, class R>
+class SetXorExpr : public SetExpr< SetXorExpr<L, R> >,
+                   public SetBinaryExpr<L, R>
+{
+public:
+   static const bool mayRepeat = L::mayRepeat || R::mayRepeat;
+   using SetBinaryExpr<L, R>::lhs;
+   using SetBinaryExpr<L, R>::rhs;
+
+   SetXorExpr(const L& l, const R& r) : SetBinaryExpr<L, R>(l, r) {}
+
+   int estimate() const { return lhs.estimate() + rhs.estimate(); }
+
+   bool contains(int x) const
+   {
+      return lhs.contains(x) != rhs.contains(x);
+   }
+
+   template <class F>
+   void forEachCandidate(F& f) const
+   {
+      lhs.forEachCandidate(f);
+      rhs.forEachCandidate(f);
+   }
+};
+
+// Evaluates expr into out (which must not be referred to by expr).
+template <class E>
+void evaluateSetExpr(const E& expr, IntSet& out)
+{
+   expr.prepare();
+   SetExprAccess::prepare(out, expr.estimate());
+
+   //candidates that may repeat are staged one past the end and
+   //kept only if the index has not seen them yet; estimate() is
+   //exactly the number of candidates, so the staging slot always
+   //lies inside the array
+   IntIndex seen;
+   seen.rebind(SetExprAccess::data(out));
+   auto keep = [&](int x)
+   {
+      if (!expr.contains(x))
+         return;
+      if (E::mayRepeat)
+      {
+         *SetExprAccess::slot(out) = x;
+         if (!seen.insert(SetExprAccess::used(out)))
+            return;
+      }
+      SetExprAccess::append(out, x);
+   };
+   expr.forEachCandidate(keep);
+}
+
+template <class E>
+IntSet::IntSet(const SetExpr<E>& expr)
+   : capacity(1), used(0), fingerprint(0),
+     minValue(0), maxValue(0), ascending(true), delta(0)
+{
+   data = new int[capacity];
+   evaluateSetExpr(expr.self(), *this);
+}
+
+template <class E>
+IntSet& IntSet::operator=(const SetExpr<E>& expr)
+{
+   if (expr.self().refersTo(this))
+   {
+      IntSet result(expr);
+      *this = std::move(result);
+   }
+   else
+      evaluateSetExpr(expr.self(), *this);
+   return *this;
+}
+
+// Operators for every combination of IntSet and expression operands.
+#define SET_EXPR_OPERATOR(OP, NODE)                                       \
+   template <class L, class R>                                            \
+   NODE<L, R> operator OP(const SetExpr<L>& l, const SetExpr<R>& r)       \
+   {                                                                      \
+      return NODE<L, R>(l.self(), r.self());                              \
+   }                                                                      \
+   template <class R>                                                     \
+   NODE<SetLeaf, R> operator OP(const IntSet& l, const SetExpr<R>& r)     \
+   {                                                                      \
+      return NODE<SetLeaf, R>(SetLeaf(l), r.self());                      \
+   }                                                                      \
+   template <class L>                                                     \
+   NODE<L, SetLeaf> operator OP(const SetExpr<L>& l, const IntSet& r)     \
+   {                                                                      \
+      return NODE<L, SetLeaf>(l.self(), SetLeaf(r));                      \
+   }                                                                      \
+   inline NODE<SetLeaf, SetLeaf> operator OP(const IntSet& l,             \
+                                             const IntSet& r)             \
+   {                                                                      \
+      return NODE<SetLeaf, SetLeaf>(SetLeaf(l), SetLeaf(r));              \
+   }
+
+SET_EXPR_OPERATOR(|, SetUnionExpr)
+SET_EXPR_OPERATOR(&, SetIntersectExpr)
+SET_EXPR_OPERATOR(-, SetSubtractExpr)
+SET_EXPR_OPERATOR(^, SetXorExpr)
+
+#undef SET_EXPR_OPERATOR
+
+#endif
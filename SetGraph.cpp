@@ -0,0 +1,214 @@
+// FILE: SetGraph.cpp
+//       Implementation file for the SetGraph class
+//       (See SetGraph.h for documentation.)
+// INVARIANT for the SetGraph class:
+// (1) nodes[n] describes node n; an operation node's operands always
+//     have smaller numbers than the node itself, so increasing node
+//     number is a topological order.
+// (2) leaves maps each wrapped IntSet to its node, and operations
+//     maps each (op, lhs, rhs) triple (with lhs <= rhs for the
+//     symmetric operations) to its node; no two nodes are equal in
+//     this sense.
+// (3) pool is 0 or the pool evaluate(outputs, numThreads) last used;
+//     it is only read and replaced through atomic_load/atomic_store,
+//     so concurrent evaluate() calls each get a whole pool.
+
+#include "SetGraph.h"
+#include "Parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <utility>
+using namespace std;
+
+SetGraph::Node SetGraph::leaf(const IntSet& set)
+{
+   map<const IntSet*, Node>::iterator found = leaves.find(&set);
+   if (found != leaves.end())
+      return found->second;
+
+   Entry e = { &set, SET_UNION, -1, -1 };
+   nodes.push_back(e);
+   return leaves[&set] = Node(nodes.size() - 1);
+}
+
+SetGraph::Node SetGraph::operation(SetOp op, Node a, Node b, bool symmetric)
+{
+   if (symmetric && b < a)
+      swap(a, b);
+
+   tuple<int, Node, Node> key(op, a, b);
+   map<tuple<int, Node, Node>, Node>::iterator found = operations.find(key);
+   if (found != operations.end())
+      return found->second;
+
+   Entry e = { 0, op, a, b };
+   nodes.push_back(e);
+   return operations[key] = Node(nodes.size() - 1);
+}
+
+SetGraph::Node SetGraph::unite(Node a, Node b)
+{
+   return operation(SET_UNION, a, b, true);
+}
+
+SetGraph::Node SetGraph::intersect(Node a, Node b)
+{
+   return operation(SET_INTERSECT, a, b, true);
+}
+
+SetGraph::Node SetGraph::subtract(Node a, Node b)
+{
+   return operation(SET_SUBTRACT, a, b, false);
+}
+
+SetGraph::Node SetGraph::symmetricDifference(Node a, Node b)
+{
+   return operation(SET_SYMMETRIC_DIFFERENCE, a, b, true);
+}
+
+int SetGraph::numNodes() const
+{
+   return int(nodes.size());
+}
+
+vector<IntSet> SetGraph::evaluate(const vector<Node>& outputs, int numThreads) const
+{
+   numThreads = resolveThreads(numThreads);
+   shared_ptr<WorkStealingPool> current = atomic_load(&pool);
+   if (!current || current->numThreads() != numThreads)
+   {
+      current = make_shared<WorkStealingPool>(numThreads);
+      atomic_store(&pool, current);
+   }
+   return evaluate(outputs, *current);
+}
+
+vector<IntSet> SetGraph::evaluate(const vector<Node>& outputs,
+                                  WorkStealingPool& pool) const
+{
+   int n = int(nodes.size());
+
+   //uses: references from needed parents plus requests as an output;
+   //walking down the numbering visits parents before their operands
+   vector<int> uses(n, 0);
+   vector<bool> needed(n, false);
+   for (size_t k = 0; k < outputs.size(); ++k)
+   {
+      needed[outputs[k]] = true;
+      ++uses[outputs[k]];
+   }
+   vector< vector<Node> > parents(n);
+   int operations = 0;
+   for (Node v = n - 1; v >= 0; --v)
+      if (needed[v] && nodes[v].lhs >= 0)
+      {
+         ++operations;
+         Node operand[2] = { nodes[v].lhs, nodes[v].rhs };
+         for (int k = 0; k < 2; ++k)
+         {
+            needed[operand[k]] = true;
+            ++uses[operand[k]];
+            parents[operand[k]].push_back(v);
+         }
+      }
+
+   //per-node countdowns shared by the workers
+   unique_ptr< atomic<int>[] > waiting(new atomic<int>[n]);
+   unique_ptr< atomic<int>[] > remaining(new atomic<int>[n]);
+   vector<const IntSet*> value(n, 0);
+   vector<IntSet*> owned(n, 0);
+   for (Node v = 0; v < n; ++v)
+   {
+      waiting[v].store(nodes[v].lhs >= 0 ? 2 : 0);
+      remaining[v].store(uses[v]);
+      if (nodes[v].lhs < 0)
+         value[v] = nodes[v].set;
+   }
+
+   //the last operation to finish wakes the caller; notifying under
+   //the lock keeps the caller from returning (and taking these
+   //locals with it) before the worker is done with them
+   atomic<int> left(operations);
+   mutex doneLock;
+   condition_variable doneSignal;
+   bool done = operations == 0;
+   exception_ptr failure;
+
+   function<void(Node)> finished;
+   auto release = [&](Node v)
+   {
+      if (remaining[v].fetch_sub(1) == 1 && owned[v])
+      {
+         delete owned[v];
+         owned[v] = 0;
+      }
+   };
+   auto compute = [&](Node v)
+   {
+      //a node whose operand failed is skipped (and fails in turn)
+      const IntSet* lhs = value[nodes[v].lhs];
+      const IntSet* rhs = value[nodes[v].rhs];
+      if (lhs && rhs)
+      {
+         try
+         {
+            SetJob job = { nodes[v].op, lhs, rhs };
+            owned[v] = new IntSet(SetBatchExecutor::evaluate(job));
+            value[v] = owned[v];
+         }
+         catch (...)
+         {
+            lock_guard<mutex> guard(doneLock);
+            if (!failure)
+               failure = current_exception();
+         }
+      }
+      release(nodes[v].lhs);
+      release(nodes[v].rhs);
+      finished(v);
+      if (left.fetch_sub(1) == 1)
+      {
+         lock_guard<mutex> guard(doneLock);
+         done = true;
+         doneSignal.notify_all();
+      }
+   };
+   finished = [&](Node v)
+   {
+      //the second operand to arrive schedules the parent
+      for (size_t k = 0; k < parents[v].size(); ++k)
+      {
+         Node p = parents[v][k];
+         if (waiting[p].fetch_sub(1) == 1)
+            pool.submit([&compute, p]() { compute(p); });
+      }
+   };
+
+   for (Node v = 0; v < n; ++v)
+      if (needed[v] && nodes[v].lhs < 0)
+         finished(v);
+   {
+      unique_lock<mutex> guard(doneLock);
+      doneSignal.wait(guard, [&]() { return done; });
+   }
+
+   //what is left of remaining[v] is the number of times v is an
+   //output: the last of them takes a computed value over
+   vector<IntSet> results(outputs.size());
+   if (!failure)
+      for (size_t k = 0; k < outputs.size(); ++k)
+      {
+         Node v = outputs[k];
+         if (owned[v] && remaining[v].fetch_sub(1) == 1)
+            results[k] = std::move(*owned[v]);
+         else
+            results[k] = *value[v];
+      }
+   for (Node v = 0; v < n; ++v)
+      delete owned[v];
+   if (failure)
+      rethrow_exception(failure);
+   return results;
+}
@@ -0,0 +1,110 @@
+// FILE: SetGraph.h - header file for SetGraph class
+// CLASS PROVIDED: SetGraph (a DAG of set formulas over IntSet leaves,
+//                 evaluated with common-subexpression elimination,
+//                 in parallel, freeing intermediates early)
+//
+// Formulas are built node by node: leaf() wraps an existing IntSet and
+// the operation functions combine two existing nodes. Asking for the
+// same operation on the same operands twice returns the node made the
+// first time (operands of the symmetric operations are put in a
+// canonical order first, so unite(a, b) and unite(b, a) are the same
+// node); leaf() does the same for the same IntSet. Many formulas can
+// therefore share one graph and every shared subexpression is
+// computed once.
+//
+// evaluate() computes only the nodes the requested outputs depend on.
+// Nodes become runnable as soon as both operands are available and
+// run on a work-stealing pool (see WorkStealingPool.h), each one as a
+// SetJob (see SetBatch.h). An intermediate result is freed the moment
+// its last consumer has finished with it, which keeps the peak memory
+// close to what the formulas in flight need.
+//
+// TYPES
+//   typedef int Node
+//     Identifies a node of the invoking SetGraph.
+//
+// CONSTRUCTOR
+//   SetGraph()
+//     Post: The invoking SetGraph has no nodes.
+//
+// MEMBER FUNCTIONS
+//   Node leaf(const IntSet& set)
+//     Pre:  set outlives every evaluate() that uses this node and is
+//           not modified during one.
+//     Post: The node standing for set is returned.
+//   Node unite(Node a, Node b)
+//   Node intersect(Node a, Node b)
+//   Node subtract(Node a, Node b)
+//   Node symmetricDifference(Node a, Node b)
+//     Pre:  a and b are nodes of the invoking SetGraph.
+//     Post: The node standing for a.unionWith(b), a.intersect(b),
+//           a.subtract(b) or a.symmetricDifference(b) is returned.
+//   int numNodes() const
+//     Post: The number of distinct nodes is returned.
+//   std::vector<IntSet> evaluate(const std::vector<Node>& outputs,
+//                                int numThreads = 0) const
+//     Post: The value of every node in outputs is returned, result i
+//           belonging to outputs[i]; up to numThreads threads (one
+//           per hardware thread if numThreads <= 0) have been used.
+//     Note: The threads are those of a pool the SetGraph keeps from
+//           one call to the next (and replaces only when numThreads
+//           changes), so repeated calls start no threads.
+//   std::vector<IntSet> evaluate(const std::vector<Node>& outputs,
+//                                WorkStealingPool& pool) const
+//     Pre:  Not called from inside a task of pool.
+//     Post: As above, the nodes having been computed as tasks of
+//           pool; the call waits for its own tasks only, so pool may
+//           be running other work at the same time.
+//     Note: If computing a node threw, the nodes depending on it are
+//           skipped, every other task still finishes, and the first
+//           exception is rethrown.
+//
+// VALUE SEMANTICS
+//   Assignment and the copy constructor may be used with SetGraph
+//   objects (the copy refers to the same leaf IntSet's and shares the
+//   thread pool).
+
+#ifndef SET_GRAPH_H
+#define SET_GRAPH_H
+
+#include "IntSet.h"
+#include "SetBatch.h"
+#include "WorkStealingPool.h"
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+class SetGraph
+{
+public:
+   typedef int Node;
+
+   Node leaf(const IntSet& set);
+   Node unite(Node a, Node b);
+   Node intersect(Node a, Node b);
+   Node subtract(Node a, Node b);
+   Node symmetricDifference(Node a, Node b);
+   int numNodes() const;
+   std::vector<IntSet> evaluate(const std::vector<Node>& outputs,
+                                int numThreads = 0) const;
+   std::vector<IntSet> evaluate(const std::vector<Node>& outputs,
+                                WorkStealingPool& pool) const;
+
+private:
+   struct Entry
+   {
+      const IntSet* set;   // leaves only
+      SetOp op;            // operations only
+      Node lhs, rhs;       // -1 for leaves
+   };
+
+   std::vector<Entry> nodes;
+   std::map<const IntSet*, Node> leaves;
+   std::map<std::tuple<int, Node, Node>, Node> operations;
+   mutable std::shared_ptr<WorkStealingPool> pool;   // 0 until first used
+
+   Node operation(SetOp op, Node a, Node b, bool symmetric);
+};
+
+#endif
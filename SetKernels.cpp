@@ -0,0 +1,253 @@
+// FILE: SetKernels.cpp
+//       Implementation file for the element-counting kernels
+//       (See SetKernels.h for documentation.)
+
+#include "SetKernels.h"
+#include "IntIndex.h"
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+namespace
+{
+   //per-thread scratch reused from call to call, so kernels run in a
+   //loop do not allocate; bitmaps above KEEP_BITMAP_WORDS words are
+   //given back after each call
+   const size_t KEEP_BITMAP_WORDS = size_t(1) << 16;
+   thread_local IntIndex scratchIndex;
+   thread_local vector<uint64_t> scratchBits;
+
+   uint64_t* zeroedBits(size_t words)
+   {
+      scratchBits.assign(words, 0);
+      return &scratchBits[0];
+   }
+
+   void releaseBits()
+   {
+      if (scratchBits.capacity() > KEEP_BITMAP_WORDS)
+         vector<uint64_t>().swap(scratchBits);
+   }
+
+   //stopAt < 0 means "count everything"
+   inline int limitOf(int stopAt)
+   {
+      return stopAt < 0 ? INT_MAX : stopAt;
+   }
+
+   //one bit per value of [lo, hi]; values outside are ignored
+   void fillBitmap(const int* a, int na, int lo, int hi, uint64_t* bits)
+   {
+      for (int i = 0; i < na; ++i)
+         if (a[i] >= lo && a[i] <= hi)
+         {
+            uint32_t off = uint32_t(a[i]) - uint32_t(lo);
+            bits[off >> 6] |= uint64_t(1) << (off & 63);
+         }
+   }
+
+   //first index >= from of ascending x[0..n) whose value is >= value
+   //(n if none): doubling steps, then a binary search of the last step
+   int gallopTo(const int* x, int n, int from, int value)
+   {
+      int step = 1, hi = from;
+      while (hi < n && x[hi] < value)
+      {
+         from = hi + 1;
+         hi += step;
+         step <<= 1;
+      }
+      if (hi > n)
+         hi = n;
+      while (from < hi)
+      {
+         int mid = from + (hi - from) / 2;
+         if (x[mid] < value)
+            from = mid + 1;
+         else
+            hi = mid;
+      }
+      return from;
+   }
+}
+
+int countCommonScan(const int* a, int na, const int* b, int nb, int stopAt)
+{
+   int limit = limitOf(stopAt);
+   int common = 0;
+   for (int i = 0; i < na && common < limit; ++i)
+      for (int j = 0; j < nb; ++j)
+         if (a[i] == b[j])
+         {
+            ++common;
+            break;
+         }
+   return common;
+}
+
+int countCommonMerge(const int* a, int na, const int* b, int nb, int stopAt)
+{
+   int limit = limitOf(stopAt);
+   int i = 0, j = 0, common = 0;
+   while (i < na && j < nb && common < limit)
+   {
+      int x = a[i], y = b[j];
+      common += (x == y);
+      i += (x <= y);
+      j += (y <= x);
+   }
+   return common;
+}
+
+int countCommonGallop(const int* a, int na, const int* b, int nb, int stopAt)
+{
+   //look each value of the smaller array up in the larger one,
+   //resuming where the previous lookup ended
+   if (na > nb)
+      return countCommonGallop(b, nb, a, na, stopAt);
+   int limit = limitOf(stopAt);
+   int j = 0, common = 0;
+   for (int i = 0; i < na && j < nb && common < limit; ++i)
+   {
+      j = gallopTo(b, nb, j, a[i]);
+      common += (j < nb && b[j] == a[i]);
+   }
+   return common;
+}
+
+int countCommonBitmap(const int* a, int na, const int* b, int nb,
+                      int lo, int hi, int stopAt)
+{
+   int limit = limitOf(stopAt);
+   //the offset arithmetic is unsigned so any int range fits
+   size_t words = (size_t(uint32_t(hi) - uint32_t(lo)) >> 6) + 1;
+   uint64_t* bitsA = zeroedBits(2 * words);
+   uint64_t* bitsB = bitsA + words;
+   fillBitmap(a, na, lo, hi, bitsA);
+   fillBitmap(b, nb, lo, hi, bitsB);
+
+   int common = 0;
+   for (size_t w = 0; w < words && common < limit; ++w)
+      common += __builtin_popcountll(bitsA[w] & bitsB[w]);
+   releaseBits();
+   return common;
+}
+
+int countCommonHash(const int* a, int na, const int* b, int nb, int stopAt)
+{
+   int limit = limitOf(stopAt);
+   scratchIndex.build(a, na);
+   int common = 0;
+   for (int j = 0; j < nb && common < limit; ++j)
+      common += scratchIndex.contains(b[j]);
+   return common;
+}
+
+void markCommonScan(const int* a, int na, const int* b, int nb, char* aHit)
+{
+   for (int i = 0; i < na; ++i)
+   {
+      aHit[i] = 0;
+      for (int j = 0; j < nb; ++j)
+         if (a[i] == b[j])
+         {
+            aHit[i] = 1;
+            break;
+         }
+   }
+}
+
+void markCommonMerge(const int* a, int na, const int* b, int nb, char* aHit)
+{
+   int i = 0, j = 0;
+   while (i < na && j < nb)
+   {
+      int x = a[i], y = b[j];
+      aHit[i] = (x == y);
+      i += (x <= y);
+      j += (y <= x);
+   }
+   while (i < na)
+      aHit[i++] = 0;
+}
+
+void markCommonGallop(const int* a, int na, const int* b, int nb, char* aHit)
+{
+   if (na <= nb)
+   {
+      int j = 0;
+      for (int i = 0; i < na; ++i)
+      {
+         j = gallopTo(b, nb, j, a[i]);
+         aHit[i] = (j < nb && b[j] == a[i]);
+      }
+   }
+   else
+   {
+      //gallop through a with the values of b instead
+      memset(aHit, 0, na);
+      int i = 0;
+      for (int j = 0; j < nb && i < na; ++j)
+      {
+         i = gallopTo(a, na, i, b[j]);
+         if (i < na && a[i] == b[j])
+            aHit[i] = 1;
+      }
+   }
+}
+
+void markCommonBitmap(const int* a, int na, const int* b, int nb,
+                      int lo, int hi, char* aHit)
+{
+   //bitmap of b over [lo, hi], then one probe per value of a
+   size_t words = (size_t(uint32_t(hi) - uint32_t(lo)) >> 6) + 1;
+   uint64_t* bits = zeroedBits(words);
+   fillBitmap(b, nb, lo, hi, bits);
+   for (int i = 0; i < na; ++i)
+   {
+      aHit[i] = 0;
+      if (a[i] >= lo && a[i] <= hi)
+      {
+         uint32_t off = uint32_t(a[i]) - uint32_t(lo);
+         aHit[i] = (bits[off >> 6] >> (off & 63)) & 1;
+      }
+   }
+   releaseBits();
+}
+
+void markCommonHash(const int* a, int na, const int* b, int nb, char* aHit)
+{
+   IntIndex& index = scratchIndex;
+   if (na <= nb)
+   {
+      //index a, stream b past it and flag the hits by position
+      memset(aHit, 0, na);
+      index.build(a, na);
+      for (int j = 0; j < nb; ++j)
+      {
+         int pos = index.find(b[j]);
+         if (pos >= 0)
+            aHit[pos] = 1;
+      }
+   }
+   else
+   {
+      index.build(b, nb);
+      for (int i = 0; i < na; ++i)
+         aHit[i] = index.contains(a[i]);
+   }
+}
+
+void valueRange(const int* a, int na, int& lo, int& hi)
+{
+   lo = hi = a[0];
+   for (int i = 1; i < na; ++i)
+   {
+      if (a[i] < lo)
+         lo = a[i];
+      if (a[i] > hi)
+         hi = a[i];
+   }
+}
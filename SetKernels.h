@@ -0,0 +1,89 @@
+// FILE: SetKernels.h - element-counting and marking kernels over
+//       int arrays
+//
+// Each kernel finds the values two arrays of distinct ints have in
+// common, either counting them or marking which elements of the
+// first array are also in the second; the five families differ only
+// in what they need and what they cost (see SetPlanner.h for how one
+// is chosen):
+//   scan    O(na * nb)                 no preconditions, no memory
+//   merge   O(na + nb)                 both arrays ascending
+//   gallop  O(m log(M / m))            both arrays ascending; m and M
+//                                      the smaller and larger size
+//   bitmap  O(na + nb + span / 64)     span = hi - lo + 1
+//   hash    O(na + nb)                 builds an IntIndex over the
+//                                      smaller array (counting: a)
+//
+// Every counting kernel takes an optional stopAt: when it is >= 0 the
+// kernel may stop as soon as stopAt common values have been found and
+// return any count >= stopAt (so stopAt = 1 answers "is there any
+// common value" with early exit).
+//
+// The bitmap and hash kernels keep their bitmap and IntIndex in
+// per-thread scratch that later calls reuse, so calling a kernel
+// over and over on inputs of similar size allocates no memory (very
+// large bitmaps are released after each call).
+//
+// FUNCTIONS PROVIDED:
+//   int countCommonScan(const int* a, int na, const int* b, int nb,
+//                       int stopAt = -1)
+//     Post: The number of values in both a[0..na) and b[0..nb) is
+//           returned (by scanning b once per value of a).
+//   int countCommonMerge(const int* a, int na, const int* b, int nb,
+//                        int stopAt = -1)
+//     Pre:  Both arrays are strictly ascending.
+//     Post: As for countCommonScan (by one linear merge).
+//   int countCommonGallop(const int* a, int na, const int* b, int nb,
+//                         int stopAt = -1)
+//     Pre:  Both arrays are strictly ascending.
+//     Post: As for countCommonScan (by looking each value of the
+//           smaller array up in the larger one with exponential then
+//           binary search, each search starting where the last ended).
+//   int countCommonBitmap(const int* a, int na, const int* b, int nb,
+//                         int lo, int hi, int stopAt = -1)
+//     Pre:  lo <= hi, and every common value lies in [lo, hi].
+//     Post: As for countCommonScan (by building one bitmap over
+//           [lo, hi] per array and popcounting their AND).
+//   int countCommonHash(const int* a, int na, const int* b, int nb,
+//                       int stopAt = -1)
+//     Post: As for countCommonScan (by indexing a and probing with
+//           b, so a should be the smaller array).
+//   void markCommonScan(const int* a, int na, const int* b, int nb,
+//                       char* aHit)
+//   void markCommonMerge(const int* a, int na, const int* b, int nb,
+//                        char* aHit)
+//   void markCommonGallop(const int* a, int na, const int* b, int nb,
+//                         char* aHit)
+//   void markCommonBitmap(const int* a, int na, const int* b, int nb,
+//                         int lo, int hi, char* aHit)
+//   void markCommonHash(const int* a, int na, const int* b, int nb,
+//                       char* aHit)
+//     Pre:  As for the counting kernel of the same family; aHit has
+//           room for na flags.
+//     Post: aHit[i] is 1 if a[i] occurs in b, otherwise 0.
+//   void valueRange(const int* a, int na, int& lo, int& hi)
+//     Pre:  na >= 1.
+//     Post: lo and hi are the smallest and largest values of a.
+
+#ifndef SET_KERNELS_H
+#define SET_KERNELS_H
+
+int countCommonScan(const int* a, int na, const int* b, int nb,
+                    int stopAt = -1);
+int countCommonMerge(const int* a, int na, const int* b, int nb,
+                     int stopAt = -1);
+int countCommonGallop(const int* a, int na, const int* b, int nb,
+                      int stopAt = -1);
+int countCommonBitmap(const int* a, int na, const int* b, int nb,
+                      int lo, int hi, int stopAt = -1);
+int countCommonHash(const int* a, int na, const int* b, int nb,
+                    int stopAt = -1);
+void markCommonScan(const int* a, int na, const int* b, int nb, char* aHit);
+void markCommonMerge(const int* a, int na, const int* b, int nb, char* aHit);
+void markCommonGallop(const int* a, int na, const int* b, int nb, char* aHit);
+void markCommonBitmap(const int* a, int na, const int* b, int nb,
+                      int lo, int hi, char* aHit);
+void markCommonHash(const int* a, int na, const int* b, int nb, char* aHit);
+void valueRange(const int* a, int na, int& lo, int& hi);
+
+#endif
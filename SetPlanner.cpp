@@ -0,0 +1,189 @@
+// FILE: SetPlanner.cpp
+//       Implementation file for the set-operation planner
+//       (See SetPlanner.h for documentation.)
+
+#include "SetPlanner.h"
+#include "SetKernels.h"
+#include "IntIndex.h"
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+namespace
+{
+   //rough figures for a current x86-64 core, used until (or instead
+   //of) calibration
+   PlannerCosts costs = { 0.35, 1.5, 6.0, 2.0, 0.4, 12.0, 4.0 };
+   once_flag calibrated;
+
+   //bitmaps larger than this many words are never considered
+   const double MAX_BITMAP_WORDS = double(1 << 24);
+
+   volatile int sink;
+
+   //best-of-several wall time of body(), in nanoseconds
+   template <class Body>
+   double timeNs(Body body)
+   {
+      double best = 1e300;
+      for (int rep = 0; rep < 5; ++rep)
+      {
+         chrono::steady_clock::time_point start = chrono::steady_clock::now();
+         body();
+         double ns = double(chrono::duration_cast<chrono::nanoseconds>(
+                        chrono::steady_clock::now() - start).count());
+         if (ns < best)
+            best = ns;
+      }
+      return best > 1 ? best : 1;
+   }
+
+   void runCalibration()
+   {
+      //interleaved ascending inputs with no common value: the
+      //worst case (full scans, no early exits) for every kernel
+      const int N = 4096, SMALL = 128, SPARSE = 16;
+      vector<int> a(N), b(N);
+      for (int i = 0; i < N; ++i)
+      {
+         a[i] = 2 * i;
+         b[i] = 2 * i + 1;
+      }
+
+      PlannerCosts c;
+      c.scanPair = timeNs([&]() { sink = countCommonScan(&a[0], SMALL, &b[0], SMALL); })
+                   / (double(SMALL) * SMALL);
+      c.mergeElement = timeNs([&]() { sink = countCommonMerge(&a[0], N, &b[0], N); })
+                       / (2.0 * N);
+
+      //gallop: a few values spread evenly over b's range
+      vector<int> spread(SMALL);
+      for (int i = 0; i < SMALL; ++i)
+         spread[i] = a[i * (N / SMALL)];
+      c.gallopStep = timeNs([&]() { sink = countCommonGallop(&spread[0], SMALL, &b[0], N); })
+                     / (SMALL * (log2(double(N) / SMALL) + 1));
+
+      //dense bitmap: nearly all element cost; sparse: nearly all word
+      //cost (a few values spread over a wide range)
+      c.bitmapElement = timeNs([&]()
+      {
+         sink = countCommonBitmap(&a[0], N, &b[0], N, 0, 2 * N);
+      }) / (2.0 * N);
+      vector<int> wideA(SPARSE), wideB(SPARSE);
+      for (int i = 0; i < SPARSE; ++i)
+      {
+         wideA[i] = i << 20;
+         wideB[i] = (i << 20) + 1;
+      }
+      double words = double((SPARSE - 1) << 20) / 64;
+      c.bitmapWord = timeNs([&]()
+      {
+         sink = countCommonBitmap(&wideA[0], SPARSE, &wideB[0], SPARSE,
+                                  0, (SPARSE - 1) << 20);
+      }) / words;
+
+      IntIndex index;
+      c.hashBuild = timeNs([&]() { index.build(&a[0], N); }) / N;
+      c.hashProbe = timeNs([&]()
+      {
+         int hits = 0;
+         for (int i = 0; i < N; ++i)
+            hits += index.contains(b[i]);
+         sink = hits;
+      }) / N;
+
+      costs = c;
+   }
+
+   void calibrateOnce()
+   {
+#ifndef INTSET_NO_CALIBRATION
+      call_once(calibrated, runCalibration);
+#endif
+   }
+}
+
+const PlannerCosts& plannerCosts()
+{
+   calibrateOnce();
+   return costs;
+}
+
+void calibratePlanner()
+{
+   calibrateOnce();
+   runCalibration();
+}
+
+namespace
+{
+   //the cheapest kernel for a and b, with its cost in bestCost (see
+   //planCommon for lo and hi)
+   SetAlgorithm cheapest(const SetStats& a, const SetStats& b, int& lo, int& hi,
+                         double& bestCost)
+   {
+      if (a.size == 0 || b.size == 0)
+         return ALGO_NONE;
+      lo = a.minValue > b.minValue ? a.minValue : b.minValue;
+      hi = a.maxValue < b.maxValue ? a.maxValue : b.maxValue;
+      if (lo > hi)
+         return ALGO_NONE;
+
+      const PlannerCosts& c = plannerCosts();
+      double na = a.size, nb = b.size;
+      double small = na < nb ? na : nb, large = na < nb ? nb : na;
+
+      SetAlgorithm best = ALGO_SCAN;
+      bestCost = c.scanPair * na * nb;
+
+      if (a.ascending && b.ascending)
+      {
+         double cost = c.mergeElement * (na + nb);
+         if (cost < bestCost)
+         {
+            best = ALGO_MERGE;
+            bestCost = cost;
+         }
+         cost = c.gallopStep * small * (log2(large / small) + 1);
+         if (cost < bestCost)
+         {
+            best = ALGO_GALLOP;
+            bestCost = cost;
+         }
+      }
+
+      double words = (double(hi) - double(lo) + 1) / 64;
+      if (words <= MAX_BITMAP_WORDS)
+      {
+         double cost = c.bitmapElement * (na + nb) + c.bitmapWord * words;
+         if (cost < bestCost)
+         {
+            best = ALGO_BITMAP;
+            bestCost = cost;
+         }
+      }
+
+      double cost = c.hashBuild * small + c.hashProbe * large;
+      if (cost < bestCost)
+      {
+         best = ALGO_HASH;
+         bestCost = cost;
+      }
+      return best;
+   }
+}
+
+SetAlgorithm planCommon(const SetStats& a, const SetStats& b, int& lo, int& hi)
+{
+   double cost;
+   return cheapest(a, b, lo, hi, cost);
+}
+
+double planCost(const SetStats& a, const SetStats& b)
+{
+   int lo, hi;
+   double cost;
+   return cheapest(a, b, lo, hi, cost) == ALGO_NONE ? 0 : cost;
+}
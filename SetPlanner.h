@@ -0,0 +1,90 @@
+// FILE: SetPlanner.h - cost-based choice of set-operation kernel
+//
+// IntSet's set operations all come down to "which elements of a are
+// also in b". SetKernels.h has five ways to answer that; which one
+// is fastest depends on the sizes, the overlap of the value ranges
+// and whether both inputs are already ascending. IntSet keeps those
+// statistics up to date as it changes (see SetStats), and the planner
+// prices every applicable kernel with a simple cost model and picks
+// the cheapest.
+//
+// COST MODEL (all costs in nanoseconds)
+//   scan    scanPair * na * nb
+//   merge   mergeElement * (na + nb)              (both ascending)
+//   gallop  gallopStep * m * (log2(M / m) + 1)    (both ascending)
+//   bitmap  bitmapElement * (na + nb) + bitmapWord * span / 64
+//   hash    hashBuild * min(na, nb) + hashProbe * max(na, nb)
+//   where m and M are the smaller and larger size and span is the
+//   size of the overlap of the two value ranges.
+//   When the ranges do not overlap no kernel is needed at all.
+//
+// CALIBRATION
+//   The unit costs are measured by a short microbenchmark of the real
+//   kernels the first time a plan is made (a few milliseconds), so
+//   the crossover points fit the machine the program runs on.
+//   Compiling with -DINTSET_NO_CALIBRATION skips the benchmark and
+//   uses the built-in defaults instead.
+//
+// TYPES
+//   struct SetStats { int size; int minValue; int maxValue;
+//                     bool ascending; }
+//     What the planner knows about one input (minValue and maxValue
+//     are meaningful only when size > 0).
+//   enum SetAlgorithm { ALGO_NONE, ALGO_SCAN, ALGO_MERGE, ALGO_GALLOP,
+//                       ALGO_BITMAP, ALGO_HASH }
+//     ALGO_NONE means the inputs cannot have a common element.
+//   struct PlannerCosts
+//     The unit costs of the cost model.
+//
+// FUNCTIONS PROVIDED:
+//   SetAlgorithm planCommon(const SetStats& a, const SetStats& b,
+//                           int& lo, int& hi)
+//     Post: The cheapest kernel for finding the common elements of a
+//           and b is returned; unless ALGO_NONE is returned, [lo, hi]
+//           is the overlap of the two value ranges (for the bitmap
+//           kernel).
+//   double planCost(const SetStats& a, const SetStats& b)
+//     Post: The estimated cost (in nanoseconds, see COST MODEL) of
+//           finding the common elements of a and b with the kernel
+//           planCommon picks is returned; 0 if no kernel is needed.
+//   const PlannerCosts& plannerCosts()
+//     Post: The unit costs in use are returned (calibrating first if
+//           that has not happened yet).
+//   void calibratePlanner()
+//     Pre:  No IntSet operation is running on another thread.
+//     Post: The microbenchmark has been (re)run and its unit costs
+//           are in use.
+
+#ifndef SET_PLANNER_H
+#define SET_PLANNER_H
+
+struct SetStats
+{
+   int  size;
+   int  minValue;
+   int  maxValue;
+   bool ascending;
+};
+
+enum SetAlgorithm
+{
+   ALGO_NONE, ALGO_SCAN, ALGO_MERGE, ALGO_GALLOP, ALGO_BITMAP, ALGO_HASH
+};
+
+struct PlannerCosts
+{
+   double scanPair;
+   double mergeElement;
+   double gallopStep;
+   double bitmapElement;
+   double bitmapWord;
+   double hashBuild;
+   double hashProbe;
+};
+
+SetAlgorithm planCommon(const SetStats& a, const SetStats& b, int& lo, int& hi);
+double planCost(const SetStats& a, const SetStats& b);
+const PlannerCosts& plannerCosts();
+void calibratePlanner();
+
+#endif
@@ -0,0 +1,146 @@
+// FILE: ShardedIntSet.cpp
+//       Implementation file for the ShardedIntSet class
+//       (See ShardedIntSet.h for documentation.)
+// INVARIANT for the ShardedIntSet class:
+// (1) shards[s]->set is read and written only by shards[s]->worker,
+//     and holds exactly the values v with shardOf(v) == s.
+// (2) shards[s]->inbox[c] is pushed to only by the thread using
+//     client number c and popped only by shards[s]->worker.
+// (3) shards[s]->count is stored only by shards[s]->worker, right
+//     after each command, and equals shards[s]->set.size() then.
+
+#include "ShardedIntSet.h"
+using namespace std;
+
+ShardedIntSet::ShardedIntSet(int num_shards, int num_clients)
+   : clients(num_clients < 1 ? 1 : num_clients), stopping(false)
+{
+   if (num_shards < 1)
+      num_shards = 1;
+
+   //build every shard before any worker starts
+   for (int s = 0; s < num_shards; ++s)
+   {
+      Shard* shard = new Shard;
+      shard->count.store(0, memory_order_relaxed);
+      for (int c = 0; c < clients; ++c)
+         shard->inbox.push_back(new SpscQueue<Command>(QUEUE_CAPACITY));
+      shards.push_back(shard);
+   }
+   for (int s = 0; s < num_shards; ++s)
+      shards[s]->worker = thread(&ShardedIntSet::run, this, shards[s]);
+}
+
+ShardedIntSet::~ShardedIntSet()
+{
+   //workers drain what is already queued before they exit
+   stopping.store(true, memory_order_release);
+   for (size_t s = 0; s < shards.size(); ++s)
+   {
+      shards[s]->worker.join();
+      for (int c = 0; c < clients; ++c)
+         delete shards[s]->inbox[c];
+      delete shards[s];
+   }
+}
+
+int ShardedIntSet::numShards() const
+{
+   return int(shards.size());
+}
+
+int ShardedIntSet::numClients() const
+{
+   return clients;
+}
+
+int ShardedIntSet::shardOf(int anInt) const
+{
+   //mix the bits so runs of nearby values spread over all shards
+   unsigned int h = unsigned(anInt) * 2654435761u;
+   h ^= h >> 16;
+   return int(h % unsigned(shards.size()));
+}
+
+int ShardedIntSet::size() const
+{
+   int total = 0;
+   for (size_t s = 0; s < shards.size(); ++s)
+      total += shards[s]->count.load(memory_order_acquire);
+   return total;
+}
+
+future<bool> ShardedIntSet::add(int client, int anInt)
+{
+   return submit(client, OP_ADD, anInt);
+}
+
+future<bool> ShardedIntSet::remove(int client, int anInt)
+{
+   return submit(client, OP_REMOVE, anInt);
+}
+
+future<bool> ShardedIntSet::contains(int client, int anInt)
+{
+   return submit(client, OP_CONTAINS, anInt);
+}
+
+future<bool> ShardedIntSet::submit(int client, Op op, int anInt)
+{
+   Command cmd;
+   cmd.op = op;
+   cmd.value = anInt;
+   future<bool> result = cmd.reply.get_future();
+
+   //back off while the owning worker catches up with this client
+   SpscQueue<Command>* queue = shards[shardOf(anInt)]->inbox[client];
+   while (!queue->tryPush(cmd))
+      this_thread::yield();
+   return result;
+}
+
+void ShardedIntSet::run(Shard* shard)
+{
+   Command cmd;
+   int idleRounds = 0;
+
+   for (;;)
+   {
+      //read the flag before draining so nothing queued ahead of
+      //the destructor can be left behind
+      bool lastRound = stopping.load(memory_order_acquire);
+      int handled = 0;
+
+      for (int c = 0; c < clients; ++c)
+      {
+         SpscQueue<Command>* queue = shard->inbox[c];
+         for (int n = 0; n < BATCH_SIZE && queue->tryPop(cmd); ++n)
+         {
+            bool result;
+            switch (cmd.op)
+            {
+            case OP_ADD:
+               result = shard->set.add(cmd.value);
+               break;
+            case OP_REMOVE:
+               result = shard->set.remove(cmd.value);
+               break;
+            default:
+               result = shard->set.contains(cmd.value);
+            }
+            shard->count.store(shard->set.size(), memory_order_release);
+            cmd.reply.set_value(result);
+            ++handled;
+         }
+      }
+
+      if (handled > 0)
+         idleRounds = 0;
+      else if (lastRound)
+         return;
+      else if (++idleRounds < 64)
+         this_thread::yield();
+      else
+         this_thread::sleep_for(chrono::microseconds(50));
+   }
+}
@@ -0,0 +1,107 @@
+// FILE: ShardedIntSet.h - header file for ShardedIntSet class
+// CLASS PROVIDED: ShardedIntSet (a shared-nothing concurrent set of
+//                 int values split over worker-owned IntSet shards)
+//
+// Each value belongs to exactly one shard (chosen by hashing the
+// value) and each shard is an ordinary IntSet owned by one worker
+// thread; no other thread ever touches a shard's data. Client
+// threads send add/remove/contains requests to the owning worker
+// over a single-producer/single-consumer ring buffer dedicated to
+// that (client, shard) pair and get a std::future<bool> back. A
+// worker drains up to BATCH_SIZE queued commands from each of its
+// queues per round before looking at the next queue.
+//
+// CONSTANTS
+//   static const int QUEUE_CAPACITY = ____
+//     Capacity of each (client, shard) command queue; a client whose
+//     queue is full waits (yielding) until the worker catches up.
+//   static const int BATCH_SIZE = ____
+//     Most commands a worker takes from one queue before moving on.
+//
+// CONSTRUCTOR
+//   ShardedIntSet(int num_shards, int num_clients)
+//     Post: num_shards worker threads (at least 1) have been started,
+//           each owning an empty IntSet shard, and num_clients (at
+//           least 1) client slots have been set up.
+//
+// CONSTANT MEMBER FUNCTIONS (ACCESSORS)
+//   int numShards() const
+//   int numClients() const
+//     Post: The number of shards (client slots) is returned.
+//   int shardOf(int anInt) const
+//     Post: The index of the shard anInt belongs to is returned.
+//   int size() const
+//     Post: The sum of the shard sizes is returned; each worker
+//           publishes its shard's size after every command, so the
+//           value is exact once all returned futures are ready.
+//
+// MEMBER FUNCTIONS (REQUESTS)
+//   std::future<bool> add(int client, int anInt)
+//   std::future<bool> remove(int client, int anInt)
+//   std::future<bool> contains(int client, int anInt)
+//     Pre:  0 <= client < numClients(), and no other thread is using
+//           the same client number at the same time.
+//     Post: The request has been queued to the owning shard; the
+//           future becomes ready with the result the same IntSet
+//           operation would have returned. Requests one client sends
+//           to one shard are applied in the order they were sent.
+//
+// VALUE SEMANTICS
+//   ShardedIntSet objects may not be copied or assigned. The
+//   destructor lets each worker finish the commands already queued
+//   and then joins it.
+
+#ifndef SHARDED_INT_SET_H
+#define SHARDED_INT_SET_H
+
+#include "IntSet.h"
+#include "SpscQueue.h"
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+class ShardedIntSet
+{
+public:
+   static const int QUEUE_CAPACITY = 1024;
+   static const int BATCH_SIZE = 64;
+   ShardedIntSet(int num_shards, int num_clients);
+   ~ShardedIntSet();
+   int numShards() const;
+   int numClients() const;
+   int shardOf(int anInt) const;
+   int size() const;
+   std::future<bool> add(int client, int anInt);
+   std::future<bool> remove(int client, int anInt);
+   std::future<bool> contains(int client, int anInt);
+
+private:
+   enum Op { OP_ADD, OP_REMOVE, OP_CONTAINS };
+
+   struct Command
+   {
+      Op op;
+      int value;
+      std::promise<bool> reply;
+   };
+
+   struct Shard
+   {
+      IntSet set;
+      std::atomic<int> count;
+      std::vector<SpscQueue<Command>*> inbox;   // one per client
+      std::thread worker;
+   };
+
+   std::vector<Shard*> shards;
+   int clients;
+   std::atomic<bool> stopping;
+
+   ShardedIntSet(const ShardedIntSet&);
+   ShardedIntSet& operator=(const ShardedIntSet&);
+   std::future<bool> submit(int client, Op op, int anInt);
+   void run(Shard* shard);
+};
+
+#endif
@@ -0,0 +1,100 @@
+// FILE: SpscQueue.h - header file for SpscQueue class template
+// CLASS TEMPLATE PROVIDED: SpscQueue<T> (a bounded, lock-free ring
+//                          buffer with one producer and one consumer)
+//
+// Exactly one thread may call tryPush and exactly one (possibly
+// different) thread may call tryPop; no locks are taken by either.
+// The producer and consumer indexes live on separate cache lines so
+// the two sides only share the slots themselves.
+//
+// CONSTRUCTOR
+//   SpscQueue(int min_capacity)
+//     Post: The invoking SpscQueue is empty and can hold at least
+//           min_capacity items (the capacity is rounded up to a
+//           power of 2; a min_capacity < 2 is treated as 2).
+//
+// MEMBER FUNCTIONS
+//   bool tryPush(T& item)
+//     Pre:  Called from the producer thread only.
+//     Post: If the queue was not full, item has been moved into it
+//           and true is returned, otherwise false is returned and
+//           item is untouched.
+//   bool tryPop(T& item)
+//     Pre:  Called from the consumer thread only.
+//     Post: If the queue was not empty, the oldest item has been
+//           moved into item and true is returned, otherwise false is
+//           returned.
+//   bool isEmpty() const
+//     Post: True is returned if the queue held no items at the time
+//           of the call (exact only from the consumer thread).
+//
+// VALUE SEMANTICS
+//   SpscQueue objects may not be copied or assigned.
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+template <class T>
+class SpscQueue
+{
+public:
+   SpscQueue(int min_capacity)
+   {
+      size_t cap = 2;
+      while (cap < size_t(min_capacity))
+         cap <<= 1;
+      mask = cap - 1;
+      slots = new T[cap];
+      head.store(0, std::memory_order_relaxed);
+      tail.store(0, std::memory_order_relaxed);
+   }
+
+   ~SpscQueue()
+   {
+      delete [] slots;
+   }
+
+   bool tryPush(T& item)
+   {
+      size_t t = tail.load(std::memory_order_relaxed);
+      if (t - head.load(std::memory_order_acquire) > mask)
+         return false;
+      slots[t & mask] = std::move(item);
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+   }
+
+   bool tryPop(T& item)
+   {
+      size_t h = head.load(std::memory_order_relaxed);
+      if (h == tail.load(std::memory_order_acquire))
+         return false;
+      item = std::move(slots[h & mask]);
+      head.store(h + 1, std::memory_order_release);
+      return true;
+   }
+
+   bool isEmpty() const
+   {
+      return head.load(std::memory_order_acquire) ==
+             tail.load(std::memory_order_acquire);
+   }
+
+private:
+   T*     slots;
+   size_t mask;
+   char   pad0[64];
+   std::atomic<size_t> head;   // next slot to pop (consumer owned)
+   char   pad1[64];
+   std::atomic<size_t> tail;   // next slot to push (producer owned)
+   char   pad2[64];
+
+   SpscQueue(const SpscQueue&);
+   SpscQueue& operator=(const SpscQueue&);
+};
+
+#endif
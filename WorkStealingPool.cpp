@@ -0,0 +1,166 @@
+// FILE: WorkStealingPool.cpp
+//       Implementation file for the WorkStealingPool class
+//       (See WorkStealingPool.h for documentation.)
+// INVARIANT for the WorkStealingPool class:
+// (1) workers[w]->tasks is only touched while holding
+//     workers[w]->lock; its owner pops from the back, thieves from
+//     the front.
+// (2) queued is the number of tasks sitting in all the deques, and
+//     pending is the number of tasks submitted but not yet finished
+//     (queued + running); both are atomic, so submitting and finishing
+//     a task take no pool-wide lock.
+// (3) sleepers is the number of workers inside (or about to enter)
+//     the wait on workAvailable; a worker raises it, holding
+//     stateLock, before it checks queued for the last time. A
+//     submitter raises queued before it reads sleepers (both
+//     sequentially consistent), so either the worker sees the task or
+//     the submitter sees the sleeper and wakes it under stateLock.
+//     stateLock is only taken to sleep, to wake sleepers, and by
+//     wait() and the destructor; stopping is only touched holding it.
+
+#include "WorkStealingPool.h"
+#include "Parallel.h"
+#include <memory>
+using namespace std;
+
+namespace
+{
+   //which pool (if any) and which worker the current thread is
+   thread_local const void* currentPool = 0;
+   thread_local int currentWorker = -1;
+}
+
+WorkStealingPool::WorkStealingPool(int numThreads)
+   : queued(0), pending(0), sleepers(0), nextWorker(0), stopping(false)
+{
+   int n = resolveThreads(numThreads);
+   for (int w = 0; w < n; ++w)
+      workers.push_back(new Worker);
+   for (int w = 0; w < n; ++w)
+      workers[w]->thread = thread(&WorkStealingPool::run, this, w);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+   wait();
+   {
+      lock_guard<mutex> guard(stateLock);
+      stopping = true;
+   }
+   workAvailable.notify_all();
+   //a worker may still be looking into the others' queues until
+   //it exits, so free nothing before every worker has been joined
+   for (size_t w = 0; w < workers.size(); ++w)
+      workers[w]->thread.join();
+   for (size_t w = 0; w < workers.size(); ++w)
+      delete workers[w];
+}
+
+int WorkStealingPool::numThreads() const
+{
+   return int(workers.size());
+}
+
+future<void> WorkStealingPool::submit(const function<void()>& task)
+{
+   //the packaged task keeps an exception the task throws for the
+   //future instead of letting it end the worker thread
+   shared_ptr< packaged_task<void()> > job(new packaged_task<void()>(task));
+   future<void> done = job->get_future();
+   pending.fetch_add(1);
+
+   //a task spawning more work keeps it on its own worker
+   int target = currentPool == this
+                ? currentWorker
+                : int(nextWorker.fetch_add(1) % unsigned(workers.size()));
+   {
+      lock_guard<mutex> guard(workers[target]->lock);
+      workers[target]->tasks.push_back([job]() { (*job)(); });
+   }
+   queued.fetch_add(1);
+
+   //only a sleeping worker needs waking; passing through the lock
+   //keeps one between its last check of queued and its wait from
+   //missing the notification
+   if (sleepers.load() > 0)
+   {
+      {
+         lock_guard<mutex> guard(stateLock);
+      }
+      workAvailable.notify_one();
+   }
+   return done;
+}
+
+void WorkStealingPool::wait()
+{
+   unique_lock<mutex> guard(stateLock);
+   allDone.wait(guard, [this]() { return pending.load() == 0; });
+}
+
+bool WorkStealingPool::takeTask(int self, function<void()>& task)
+{
+   //newest task of our own first...
+   {
+      Worker* mine = workers[self];
+      lock_guard<mutex> guard(mine->lock);
+      if (!mine->tasks.empty())
+      {
+         task = mine->tasks.back();
+         mine->tasks.pop_back();
+         queued.fetch_sub(1);
+         return true;
+      }
+   }
+
+   //...then the oldest task of the others, starting past ourselves
+   int n = int(workers.size());
+   for (int k = 1; k < n; ++k)
+   {
+      Worker* victim = workers[(self + k) % n];
+      lock_guard<mutex> guard(victim->lock);
+      if (!victim->tasks.empty())
+      {
+         task = victim->tasks.front();
+         victim->tasks.pop_front();
+         queued.fetch_sub(1);
+         return true;
+      }
+   }
+   return false;
+}
+
+void WorkStealingPool::run(int self)
+{
+   currentPool = this;
+   currentWorker = self;
+
+   function<void()> task;
+   for (;;)
+   {
+      if (takeTask(self, task))
+      {
+         task();
+         task = function<void()>();
+
+         //the last task out wakes wait(), under the lock so a waiter
+         //between its check of pending and its wait is not missed
+         if (pending.fetch_sub(1) == 1)
+         {
+            lock_guard<mutex> guard(stateLock);
+            allDone.notify_all();
+         }
+         continue;
+      }
+
+      unique_lock<mutex> guard(stateLock);
+      sleepers.fetch_add(1);
+      workAvailable.wait(guard, [this]()
+      {
+         return stopping || queued.load() > 0;
+      });
+      sleepers.fetch_sub(1);
+      if (stopping && queued.load() == 0)
+         return;
+   }
+}
@@ -0,0 +1,81 @@
+// FILE: WorkStealingPool.h - header file for WorkStealingPool class
+// CLASS PROVIDED: WorkStealingPool (a fixed group of worker threads
+//                 that run submitted tasks, stealing from each other
+//                 when their own queue runs dry)
+//
+// Every worker has its own double-ended task queue. A worker takes
+// its newest task first (good cache reuse for tasks it spawned
+// itself) and, when its queue is empty, steals the oldest task from
+// another worker. Tasks submitted from outside the pool are dealt out
+// to the workers' queues round robin; tasks submitted by a running
+// task go to the queue of the worker running it.
+//
+// CONSTRUCTOR
+//   WorkStealingPool(int numThreads = 0)
+//     Post: numThreads workers (one per hardware thread if
+//           numThreads <= 0) have been started and are idle.
+//
+// MEMBER FUNCTIONS
+//   int numThreads() const
+//     Post: The number of workers is returned.
+//   std::future<void> submit(const std::function<void()>& task)
+//     Post: task has been queued and will be run exactly once by
+//           one of the workers. The returned future becomes ready
+//           when task has finished; if task threw, get() on it
+//           rethrows the exception (the worker carries on).
+//   void wait()
+//     Pre:  Not called from inside a task.
+//     Post: Every task submitted before (or during) the call has
+//           finished running.
+//
+// VALUE SEMANTICS
+//   WorkStealingPool objects may not be copied or assigned. The
+//   destructor waits for all queued tasks and then joins the
+//   workers.
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool
+{
+public:
+   WorkStealingPool(int numThreads = 0);
+   ~WorkStealingPool();
+   int numThreads() const;
+   std::future<void> submit(const std::function<void()>& task);
+   void wait();
+
+private:
+   struct Worker
+   {
+      std::mutex lock;
+      std::deque< std::function<void()> > tasks;
+      std::thread thread;
+   };
+
+   std::vector<Worker*> workers;
+   std::atomic<int> queued;       // tasks sitting in the deques
+   std::atomic<int> pending;      // submitted but not yet finished
+   std::atomic<int> sleepers;     // workers waiting for work
+   std::atomic<unsigned> nextWorker;   // round robin for outside submissions
+   std::mutex stateLock;
+   std::condition_variable workAvailable;
+   std::condition_variable allDone;
+   bool stopping;
+
+   WorkStealingPool(const WorkStealingPool&);
+   WorkStealingPool& operator=(const WorkStealingPool&);
+   bool takeTask(int self, std::function<void()>& task);
+   void run(int self);
+};
+
+#endif